@@ -2,6 +2,7 @@
 #define USEFUL_COMPAREFP_H_INCLUDED
 
 #include <cfloat>
+#include <cmath>
 #include <iostream>
 
 // floating point comparison, see the below links for detail
@@ -67,6 +68,21 @@ public:
         return false;
     }
 
+    // the bits reinterpreted so that integer order matches the real order,
+    // i.e. -0.0 and +0.0 map to 0 and adjacent reals differ by 1, the
+    // distance between two keys of the same sign is their ulps difference
+    IntegerSize orderedBits() const
+    {
+        return negative() ? -(m_u.i & ~m_signBitMask) : m_u.i;
+    }
+
+    static raw_type fromOrderedBits(IntegerSize bits)
+    {
+        FloatingPoint fp(0.0);
+        fp.m_u.i = bits < 0 ? (-bits | m_signBitMask) : bits;
+        return fp.m_u.f;
+    }
+
 private:
     union FloatingPointUnion
     {
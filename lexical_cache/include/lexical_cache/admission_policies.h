@@ -0,0 +1,162 @@
+#ifndef LEXICAL_CACHE_ADMISSION_POLICIES_H_INCLUDED
+#define LEXICAL_CACHE_ADMISSION_POLICIES_H_INCLUDED
+
+#include "hash_functions.h"
+
+#include <array>
+#include <cstdint>
+#include <algorithm>
+
+// admission policies of Cache, decide on a miss with a full cache whether the
+// new entry is worth evicting the victim. each one provides a State<N>:
+//
+// - enabled: false if the policy admits everything, Cache then skips
+//   hashing keys for it
+// - record(hash): a key with this hash was looked up, hit or miss
+// - admit(candidate, victim): whether the candidate key replaces the victim
+// - clear(): forget everything
+namespace lexical_cache
+{
+
+struct AdmitAll
+{
+    template <int N>
+    class State
+    {
+    public:
+        static constexpr bool enabled = false;
+
+        void record(uint64_t) {}
+        bool admit(uint64_t, uint64_t) { return true; }
+        void clear() {}
+    };
+};
+
+// TinyLFU: a key is admitted only if it was seen more often than the victim,
+// so one-off keys can't flush out hot ones.
+//
+// frequencies are estimated by a count-min sketch of 4 bit counters, 16 to
+// a word, 4 rows of N rounded up to a power of 2, halved every
+// sample_factor * N records so old popularity fades away. a key's first
+// sighting only goes to the doorkeeper, a bloom filter cleared at the same
+// time, which keeps one-off keys out of the sketch altogether
+template <int sample_factor=10>
+struct TinyLfuAdmission
+{
+    template <int N>
+    class State
+    {
+    public:
+        static constexpr bool enabled = true;
+
+        State()
+        {
+            clear();
+        }
+
+        void record(uint64_t hash)
+        {
+            hash = mix64(hash);
+            if (!doorkeeperInsert(hash)) {
+                for (int row = 0; row < Rows; ++row) {
+                    const int i = index(hash, row);
+                    if (counter(i) < MaxCount) {
+                        m_counters[i / 16] += 1ull << shift(i);
+                    }
+                }
+            }
+            if (++m_records >= SamplePeriod) {
+                age();
+            }
+        }
+
+        bool admit(uint64_t candidate, uint64_t victim) const
+        {
+            return estimate(mix64(candidate)) > estimate(mix64(victim));
+        }
+
+        void clear()
+        {
+            m_counters.fill(0);
+            m_doorkeeper.fill(0);
+            m_records = 0;
+        }
+
+    private:
+        static constexpr int pow2(int n)
+        {
+            return n <= 1 ? 1 : 2 * pow2((n + 1) / 2);
+        }
+
+        static constexpr int Rows = 4;
+        static constexpr int Width = pow2(N < 16 ? 16 : N);
+        static constexpr int DoorkeeperBits = pow2(8 * N < 64 ? 64 : 8 * N);
+        static constexpr long SamplePeriod = static_cast<long>(sample_factor) * N;
+        static constexpr int MaxCount = 15;
+
+        // double hashing, one counter per row
+        static int index(uint64_t hash, int row)
+        {
+            const uint32_t h1 = static_cast<uint32_t>(hash);
+            const uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+            return row * Width + ((h1 + row * h2) & (Width - 1));
+        }
+
+        static int shift(int i) { return i % 16 * 4; }
+
+        int counter(int i) const
+        {
+            return static_cast<int>(m_counters[i / 16] >> shift(i) & MaxCount);
+        }
+
+        int estimate(uint64_t hash) const
+        {
+            int count = MaxCount;
+            for (int row = 0; row < Rows; ++row) {
+                count = std::min(count, counter(index(hash, row)));
+            }
+            return count + (doorkeeperContains(hash) ? 1 : 0);
+        }
+
+        // two bits per key, taken from the other end of the hash
+        bool doorkeeperContains(uint64_t hash) const
+        {
+            const auto b1 = (hash >> 40) & (DoorkeeperBits - 1);
+            const auto b2 = (hash >> 20) & (DoorkeeperBits - 1);
+            return (m_doorkeeper[b1 / 64] >> (b1 % 64) & 1)
+                && (m_doorkeeper[b2 / 64] >> (b2 % 64) & 1);
+        }
+
+        // true if the key was already there
+        bool doorkeeperInsert(uint64_t hash)
+        {
+            if (doorkeeperContains(hash)) {
+                return true;
+            }
+            const auto b1 = (hash >> 40) & (DoorkeeperBits - 1);
+            const auto b2 = (hash >> 20) & (DoorkeeperBits - 1);
+            m_doorkeeper[b1 / 64] |= 1ull << (b1 % 64);
+            m_doorkeeper[b2 / 64] |= 1ull << (b2 % 64);
+            return false;
+        }
+
+        void age()
+        {
+            // every counter at once, the mask drops the bit each one would
+            // shift into its neighbour
+            for (auto& word : m_counters) {
+                word = word >> 1 & 0x7777777777777777ull;
+            }
+            m_doorkeeper.fill(0);
+            m_records = 0;
+        }
+
+        std::array<uint64_t, Rows * Width / 16>   m_counters;
+        std::array<uint64_t, DoorkeeperBits / 64> m_doorkeeper;
+        long                                      m_records;
+    };
+};
+
+}
+
+#endif
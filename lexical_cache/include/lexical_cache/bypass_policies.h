@@ -0,0 +1,196 @@
+#ifndef LEXICAL_CACHE_BYPASS_POLICIES_H_INCLUDED
+#define LEXICAL_CACHE_BYPASS_POLICIES_H_INCLUDED
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+// bypass policies of Cache, decide whether a lookup skips the cache and
+// converts directly, e.g. when the hit ratio is too low to pay for the
+// lookups. each one provides a State, one per direction:
+//
+// - enabled: false if the policy never bypasses, Cache then never times
+// - bypass(): called once per lookup, true if it goes straight to the
+//   conversion
+// - recordHit(), recordMiss(): the lookup's outcome when it isn't bypassed
+// - timed(): whether the current lookup is timed, then Cache also reports its
+//   latency, recordHit(ns) or recordMiss(ns), or recordConversion(ns) if it
+//   was bypassed
+// - timedConversion(): whether the conversion is timed if the current lookup
+//   misses, never when timed(), so the clock reads don't add up in one
+//   sample
+// - bypassing(): whether lookups are bypassed at the moment
+// - clear(): forget everything
+namespace lexical_cache
+{
+
+namespace detail
+{
+
+inline int64_t nowNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(
+            steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+struct NeverBypass
+{
+    class State
+    {
+    public:
+        static constexpr bool enabled = false;
+
+        bool bypass() { return false; }
+        bool timed() const { return false; }
+        bool timedConversion() const { return false; }
+        bool bypassing() const { return false; }
+        void recordHit(int64_t=-1) {}
+        void recordMiss(int64_t=-1) {}
+        void recordConversion(int64_t) {}
+        void clear() {}
+    };
+};
+
+// bypasses the cache while its expected cost is above the conversion's.
+//
+// one lookup in sample_every is timed, about 20ns with steady_clock, and so
+// is the conversion of another one if it misses. the hit, miss and
+// conversion latencies are moving averages of these samples.
+// the hit ratio is counted over windows of window lookups. at the end of a
+// window the expected cost of a lookup,
+//
+//   hitRatio * hitLatency + (1 - hitRatio) * missLatency
+//
+// is compared with the conversion latency, if it's higher the next
+// bypass_windows windows go straight to the conversion. then the cache is
+// probed again for a window, with the entries it had, as the workload may
+// have changed
+template <int window=4096, int sample_every=16, int bypass_windows=16>
+struct AdaptiveBypass
+{
+    static_assert(sample_every > 1 && (sample_every & (sample_every - 1)) == 0,
+            "sample_every has to be a power of 2");
+    static_assert(window >= 8 * sample_every,
+            "a window needs a few samples");
+
+    class State
+    {
+    public:
+        static constexpr bool enabled = true;
+
+        State()
+        {
+            clear();
+        }
+
+        bool bypass()
+        {
+            if (++m_calls == window) {
+                endWindow();
+            }
+            return m_bypassing;
+        }
+
+        bool timed() const
+        {
+            return (m_calls & (sample_every - 1)) == 0;
+        }
+
+        bool timedConversion() const
+        {
+            return (m_calls & (sample_every - 1)) == sample_every / 2;
+        }
+
+        bool bypassing() const { return m_bypassing; }
+
+        void recordHit(int64_t ns=-1)
+        {
+            ++m_hits;
+            if (ns >= 0) {
+                average(m_hitLatency, ns);
+            }
+        }
+
+        void recordMiss(int64_t ns=-1)
+        {
+            ++m_misses;
+            if (ns >= 0) {
+                average(m_missLatency, ns);
+            }
+        }
+
+        void recordConversion(int64_t ns)
+        {
+            average(m_conversionLatency, ns);
+        }
+
+        double hitLatency() const { return m_hitLatency; }
+        double missLatency() const { return m_missLatency; }
+        double conversionLatency() const { return m_conversionLatency; }
+
+        void clear()
+        {
+            m_calls = 0;
+            m_hits = 0;
+            m_misses = 0;
+            m_bypassing = false;
+            m_bypassedWindows = 0;
+            m_hitLatency = -1;
+            m_missLatency = -1;
+            m_conversionLatency = -1;
+        }
+
+    private:
+        // moving average over the last 16 samples or so, -1 before the
+        // first. a sample is at most 4 times the average, a lookup the thread
+        // was preempted in mustn't decide for the next thousands
+        static void average(double& mean, int64_t ns)
+        {
+            if (mean < 0) {
+                mean = ns;
+                return;
+            }
+            mean += (std::min<double>(ns, 4 * mean) - mean) / 16;
+        }
+
+        void endWindow()
+        {
+            m_calls = 0;
+            if (m_bypassing) {
+                m_bypassing = ++m_bypassedWindows < bypass_windows;
+            }
+            else if (m_hits + m_misses > 0 && m_missLatency >= 0
+                    && m_conversionLatency >= 0) {
+                const double hitRatio =
+                    static_cast<double>(m_hits) / (m_hits + m_misses);
+                // no hit timed yet, a hit costs less than a miss anyway
+                const double hitLatency =
+                    m_hitLatency >= 0 ? m_hitLatency : m_missLatency;
+                const double expected = hitRatio * hitLatency
+                    + (1 - hitRatio) * m_missLatency;
+                if (expected > m_conversionLatency) {
+                    m_bypassing = true;
+                    m_bypassedWindows = 0;
+                }
+            }
+            m_hits = 0;
+            m_misses = 0;
+        }
+
+        int                               m_calls;
+        long                              m_hits;
+        long                              m_misses;
+        bool                              m_bypassing;
+        int                               m_bypassedWindows;
+        double                            m_hitLatency;
+        double                            m_missLatency;
+        double                            m_conversionLatency;
+    };
+};
+
+}
+
+#endif
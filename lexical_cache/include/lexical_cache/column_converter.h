@@ -0,0 +1,192 @@
+#ifndef LEXICAL_CACHE_COLUMN_CONVERTER_H_INCLUDED
+#define LEXICAL_CACHE_COLUMN_CONVERTER_H_INCLUDED
+
+#include "lexical_cache.h"
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+
+namespace lexical_cache
+{
+
+// dictionary encodes a column of numeric strings: each distinct string is
+// parsed once, by the cache's stringToReal, and gets a code, the index of its
+// real in dictionary(). each row gets its code and its real, e.g.
+//
+//   rows:         "1.5" "2.25" "1.5" "1.5"
+//   values():     1.5   2.25   1.5   1.5
+//   codes():      0     1      0     0
+//   dictionary(): 1.5   2.25
+//
+// unlike Cache nothing is ever evicted: the strings are hashed with the
+// string indexes' hashBytes into an open addressing table that doubles when
+// half full, and copied into one growing buffer, so the rows can go away
+// after convert(). later convert() calls append rows to the same column, a
+// string keeps its code
+template <
+    typename real_type,
+    typename enable=
+        typename std::enable_if<std::is_floating_point<real_type>::value>::type
+    >
+class ColumnConverter
+{
+public:
+    ColumnConverter()
+    {
+        clear();
+    }
+
+    // throws like castToReal if a row isn't a number, the rows before it
+    // are converted
+    void convert(const std::string_view* rows, size_t count);
+
+    void convert(const std::vector<std::string_view>& rows)
+    {
+        convert(rows.data(), rows.size());
+    }
+
+    // per row
+    const std::vector<real_type>& values() const { return m_values; }
+    const std::vector<uint32_t>& codes() const { return m_codes; }
+
+    // per code
+    const std::vector<real_type>& dictionary() const { return m_dictionary; }
+
+    // the string of code, as it was in the first row holding it
+    std::string_view dictionaryKey(uint32_t code) const
+    {
+        return std::string_view(m_keys.data() + m_offsets[code],
+                m_offsets[code + 1] - m_offsets[code]);
+    }
+
+    size_t rowCount() const { return m_codes.size(); }
+    size_t distinctCount() const { return m_dictionary.size(); }
+
+    void reserve(size_t rows, size_t distinct)
+    {
+        m_values.reserve(rows);
+        m_codes.reserve(rows);
+        m_dictionary.reserve(distinct);
+        m_offsets.reserve(distinct + 1);
+        while (m_buckets.size() < 2 * distinct) {
+            grow();
+        }
+    }
+
+    void clear();
+
+private:
+    struct Bucket
+    {
+        uint32_t m_hash;
+        // -1 if empty
+        int32_t m_code;
+    };
+
+    static constexpr size_t InitialCapacity = 64;
+    static constexpr size_t BatchSize = 64;
+
+    // code of str, a new one if it's not in the dictionary yet
+    uint32_t encode(std::string_view str, uint32_t hash);
+
+    // twice the buckets, the codes are rehashed with their stored hash
+    void grow();
+
+    std::vector<real_type>                m_values;
+    std::vector<uint32_t>                 m_codes;
+    std::vector<real_type>                m_dictionary;
+    // the distinct strings back to back, code's is [m_offsets[code],
+    // m_offsets[code + 1])
+    std::string                           m_keys;
+    std::vector<uint32_t>                 m_offsets;
+    std::vector<Bucket>                   m_buckets;
+};
+
+template <typename real_type, typename enable>
+void ColumnConverter<real_type, enable>::convert(
+        const std::string_view* rows, size_t count)
+{
+    m_values.reserve(m_values.size() + count);
+    m_codes.reserve(m_codes.size() + count);
+
+    // hashed and prefetched a chunk ahead, like Cache::castToRealBatch
+    uint32_t hashes[BatchSize];
+    for (size_t first = 0; first < count; first += BatchSize) {
+        const size_t n = count - first < BatchSize ? count - first : BatchSize;
+        const size_t mask = m_buckets.size() - 1;
+        for (size_t i = 0; i < n; ++i) {
+            const auto& row = rows[first + i];
+            hashes[i] = static_cast<uint32_t>(
+                    hashBytes(row.data(), row.size()));
+            __builtin_prefetch(&m_buckets[hashes[i] & mask]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t code = encode(rows[first + i], hashes[i]);
+            m_codes.push_back(code);
+            m_values.push_back(m_dictionary[code]);
+        }
+    }
+}
+
+template <typename real_type, typename enable>
+void ColumnConverter<real_type, enable>::clear()
+{
+    m_values.clear();
+    m_codes.clear();
+    m_dictionary.clear();
+    m_keys.clear();
+    m_offsets.assign(1, 0);
+    m_buckets.assign(InitialCapacity, Bucket{0, -1});
+}
+
+template <typename real_type, typename enable>
+uint32_t ColumnConverter<real_type, enable>::encode(
+        std::string_view str, uint32_t hash)
+{
+    const size_t mask = m_buckets.size() - 1;
+    size_t i = hash & mask;
+    for (; m_buckets[i].m_code >= 0; i = (i + 1) & mask) {
+        if (m_buckets[i].m_hash == hash
+                && dictionaryKey(m_buckets[i].m_code) == str) {
+            return m_buckets[i].m_code;
+        }
+    }
+
+    // convert first, if str isn't a number nothing is added
+    const real_type real = stringToReal<real_type>(str);
+    const uint32_t code = m_dictionary.size();
+    m_dictionary.push_back(real);
+    m_keys.append(str.data(), str.size());
+    m_offsets.push_back(m_keys.size());
+    m_buckets[i] = Bucket{hash, static_cast<int32_t>(code)};
+
+    if (2 * m_dictionary.size() > m_buckets.size()) {
+        grow();
+    }
+    return code;
+}
+
+template <typename real_type, typename enable>
+void ColumnConverter<real_type, enable>::grow()
+{
+    std::vector<Bucket> buckets(2 * m_buckets.size(), Bucket{0, -1});
+    const size_t mask = buckets.size() - 1;
+    for (const auto& bucket : m_buckets) {
+        if (bucket.m_code < 0) {
+            continue;
+        }
+        size_t i = bucket.m_hash & mask;
+        while (buckets[i].m_code >= 0) {
+            i = (i + 1) & mask;
+        }
+        buckets[i] = bucket;
+    }
+    m_buckets.swap(buckets);
+}
+
+}
+
+#endif
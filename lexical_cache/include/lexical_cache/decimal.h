@@ -0,0 +1,225 @@
+#ifndef LEXICAL_CACHE_DECIMAL_H_INCLUDED
+#define LEXICAL_CACHE_DECIMAL_H_INCLUDED
+
+#include "real_parser.h"
+#include "real_formatter.h"
+
+#include <string_view>
+#include <ostream>
+#include <limits>
+#include <type_traits>
+#include <cstdint>
+
+// exact decimals for Cache, e.g. prices: an integer count of ticks of
+// 10^-Scale, 101.25 is Decimal<int64_t, 2>::fromTicks(10125). strings are
+// parsed straight to ticks and written from them, and Cache looks them up by
+// their ticks, with no tolerance, see exact_index.h
+namespace lexical_cache
+{
+
+template <typename int_type, int Scale>
+class Decimal
+{
+public:
+    static_assert(std::is_integral<int_type>::value
+            && std::is_signed<int_type>::value, "ticks are a signed integer");
+    static_assert(Scale >= 0
+            && Scale <= std::numeric_limits<int_type>::digits10,
+            "10^Scale must fit the ticks");
+
+    using ticks_type = int_type;
+    static constexpr int scale = Scale;
+
+    constexpr Decimal() : m_ticks(0) {}
+
+    static constexpr Decimal fromTicks(int_type ticks)
+    {
+        Decimal decimal;
+        decimal.m_ticks = ticks;
+        return decimal;
+    }
+
+    // ticks per unit, 10^Scale
+    static constexpr int_type unit()
+    {
+        int_type power = 1;
+        for (int i = 0; i < Scale; ++i) {
+            power *= 10;
+        }
+        return power;
+    }
+
+    constexpr int_type ticks() const { return m_ticks; }
+
+    // for arithmetic outside the cache, not exact
+    explicit operator double() const
+    {
+        return static_cast<double>(m_ticks) / unit();
+    }
+
+    constexpr bool operator==(const Decimal& other) const
+    {
+        return m_ticks == other.m_ticks;
+    }
+
+    constexpr bool operator!=(const Decimal& other) const
+    {
+        return m_ticks != other.m_ticks;
+    }
+
+    constexpr bool operator<(const Decimal& other) const
+    {
+        return m_ticks < other.m_ticks;
+    }
+
+private:
+    int_type                              m_ticks;
+};
+
+// tryParseReal for a Decimal: white space and a sign, then digits with at
+// most one '.', no exponent or hex, trailing characters ignored. exact up to
+// Scale decimals, the ones after are rounded half to even like formatFixed.
+// OutOfRange if the ticks don't fit int_type
+template <typename int_type, int Scale>
+ParseError tryParseReal(std::string_view str, Decimal<int_type, Scale>& value)
+{
+    using unsigned_type = typename std::make_unsigned<int_type>::type;
+
+    const char* first = str.data();
+    const char* last = first + str.size();
+    while (first != last && detail::isSpace(*first)) {
+        ++first;
+    }
+    bool negative = false;
+    if (first != last && (*first == '+' || *first == '-')) {
+        negative = *first == '-';
+        ++first;
+    }
+
+    // the largest magnitude, one more than max for a negative one
+    const unsigned_type limit =
+        static_cast<unsigned_type>(std::numeric_limits<int_type>::max())
+        + (negative ? 1 : 0);
+    unsigned_type ticks = 0;
+    const auto append = [&](unsigned digit) {
+        if (ticks > (limit - digit) / 10) {
+            return false;
+        }
+        ticks = ticks * 10 + digit;
+        return true;
+    };
+
+    bool digits = false;
+    for (; first != last && detail::isDigit(*first); ++first) {
+        digits = true;
+        if (!append(*first - '0')) {
+            return ParseError::OutOfRange;
+        }
+    }
+    int decimals = 0;
+    if (first != last && *first == '.') {
+        for (++first; first != last && detail::isDigit(*first)
+                && decimals < Scale; ++first, ++decimals) {
+            digits = true;
+            if (!append(*first - '0')) {
+                return ParseError::OutOfRange;
+            }
+        }
+        if (first != last && detail::isDigit(*first)) {
+            // the first decimal past Scale rounds, the others break a tie
+            digits = true;
+            const char next = *first;
+            bool below = false;
+            for (++first; first != last && detail::isDigit(*first); ++first) {
+                below = below || *first != '0';
+            }
+            if (next > '5' || (next == '5' && (below || (ticks & 1)))) {
+                if (ticks == limit) {
+                    return ParseError::OutOfRange;
+                }
+                ++ticks;
+            }
+        }
+    }
+    if (!digits) {
+        return ParseError::NoConversion;
+    }
+    for (; decimals < Scale; ++decimals) {
+        if (!append(0)) {
+            return ParseError::OutOfRange;
+        }
+    }
+
+    value = Decimal<int_type, Scale>::fromTicks(
+            static_cast<int_type>(negative ? 0 - ticks : ticks));
+    return ParseError::None;
+}
+
+// formatReal for a Decimal: exact, its decimals but the trailing zeros, never
+// in scientific notation, e.g. "101.25", "101.5", "-3"
+template <typename int_type, int Scale>
+int formatReal(const Decimal<int_type, Scale>& real, char* buf, size_t size)
+{
+    return detail::formatTicks(real.ticks(), Scale, -1, buf, size);
+}
+
+// same as formatReal
+template <typename int_type, int Scale>
+int formatPlain(const Decimal<int_type, Scale>& real, char* buf, size_t size)
+{
+    return detail::formatTicks(real.ticks(), Scale, -1, buf, size);
+}
+
+// like formatFixed for a real of the same value: zeros for the decimals
+// past Scale, the ones below rounded half to even
+template <typename int_type, int Scale>
+int formatFixed(const Decimal<int_type, Scale>& real, int decimals,
+        char* buf, size_t size)
+{
+    return detail::formatTicks(real.ticks(), Scale, decimals, buf, size);
+}
+
+template <typename int_type, int Scale>
+std::ostream& operator<<(std::ostream& os,
+        const Decimal<int_type, Scale>& real)
+{
+    char buf[64];
+    formatReal(real, buf, sizeof(buf));
+    return os << buf;
+}
+
+}
+
+namespace std
+{
+
+// an integer's, but a Decimal's extremes, and 0 for the NaN it doesn't have
+template <typename int_type, int Scale>
+class numeric_limits<lexical_cache::Decimal<int_type, Scale>>
+    : public numeric_limits<int_type>
+{
+    using type = lexical_cache::Decimal<int_type, Scale>;
+
+public:
+    static constexpr bool is_integer = Scale == 0;
+
+    static constexpr type min() noexcept
+    {
+        return type::fromTicks(numeric_limits<int_type>::min());
+    }
+
+    static constexpr type lowest() noexcept { return min(); }
+
+    static constexpr type max() noexcept
+    {
+        return type::fromTicks(numeric_limits<int_type>::max());
+    }
+
+    static constexpr type epsilon() noexcept { return type::fromTicks(1); }
+
+    static constexpr type quiet_NaN() noexcept { return type(); }
+};
+
+}
+
+#endif
@@ -0,0 +1,762 @@
+#ifndef LEXICAL_CACHE_DYNAMIC_CACHE_H_INCLUDED
+#define LEXICAL_CACHE_DYNAMIC_CACHE_H_INCLUDED
+
+#include "lexical_cache.h"
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace lexical_cache
+{
+
+// Cache whose capacity is set at run time, and can be changed with
+// resize(), e.g. from a config reload. it may also be capped by a memory
+// budget, in bytes, which counts the strings too, so a cache of long
+// strings holds fewer of them.
+//
+// the entries are Cache's CachedItems, evicted by eviction_policy in the
+// same order as in a Cache of the same capacity: the entries fill the slots
+// in order, and a miss on a full cache replaces the victim in place.
+// shrinking, by resize() or setMemoryBudget(), evicts the policy's victims,
+// so what's left is what the policy would have kept, then the entries over
+// the new size move into the freed slots, keeping the entries in the first
+// slots. growing evicts nothing.
+//
+// capacity and budget are per direction, like Cache's cache_size_N. the
+// storage grows as the entries come, up to the capacity, so a large
+// capacity capped by a small budget doesn't allocate for nothing. the
+// indexes are MapIndex's, they don't depend on the capacity either
+//
+// with ThreadLocal, each thread's instance starts with the capacity and
+// budget the cache was constructed with, resize() and setMemoryBudget()
+// only change the calling thread's
+template <
+    typename real_type,
+    typename lock_policy=NoLock,
+    typename eviction_policy=LruEviction,
+    int inline_str_K=40,
+    typename format_policy=ShortestFormat,
+    typename enable=
+        typename std::enable_if<std::is_floating_point<real_type>::value>::type
+    >
+class DynamicCache
+{
+public:
+    // the entries of a Cache with the same inline_str_K
+    using CachedItem = typename Cache<real_type, 1, NoLock, LruEviction,
+          AdmitAll, inline_str_K>::CachedItem;
+
+    // a default constructed cache holds as many entries as a default Cache
+    explicit DynamicCache(size_t capacity=10, size_t memoryBudget=0)
+        : m_capacity(capacity)
+        , m_memoryBudget(memoryBudget)
+    {
+        assert(capacity > 0);
+    }
+
+    // str doesn't have to be null terminated, see Cache::castToReal
+    real_type castToReal(std::string_view str);
+
+    real_type castToReal(const char* str, size_t len)
+    {
+        return castToReal(std::string_view(str, len));
+    }
+
+    // formatted by format_policy on a miss, see Cache::castToStr.
+    //
+    // unless lock_policy::copy_result, the returned string lives until the
+    // next castToStr or resize call, as the storage may move when it grows
+    // or shrinks, otherwise it's copied to a thread local buffer and lives
+    // until the next castToStr call on this thread
+    const char* castToStr(const real_type& real);
+
+    // same, in a format chosen at run time, see Cache::castToStr
+    const char* castToStr(const real_type& real, const RealFormat& format);
+
+    // at most capacity entries per direction from now on, the coldest ones
+    // are evicted if there are more
+    void resize(size_t capacity);
+
+    // at most bytes() bytes per direction from now on, 0 for no limit. the
+    // coldest entries are evicted if it's over. an entry bigger than the
+    // whole budget is converted but not cached
+    void setMemoryBudget(size_t memoryBudget);
+
+    size_t capacity() const
+    {
+        const auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        return cache.m_capacity;
+    }
+
+    size_t memoryBudget() const
+    {
+        const auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        return cache.m_memoryBudget;
+    }
+
+    // the memory the entries take, CachedItems and overflow strings, what
+    // the budget is compared with. the indexes and the storage not in use
+    // yet aren't counted
+    size_t bytes(const CacheType& t=Both) const;
+
+    size_t size(const CacheType& t=Both) const;
+    bool   empty(const CacheType& t=Both) const;
+    void   clear(const CacheType& t=Both);
+
+    double missRatio() const
+    {
+        const auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        return static_cast<double>(cache.m_cacheMiss)
+            / (cache.m_cacheHit + cache.m_cacheMiss)*100;
+    }
+
+    void resetStats()
+    {
+        auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        cache.m_cacheMiss = 0;
+        cache.m_cacheHit = 0;
+    }
+
+    long hitCount() const
+    {
+        const auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        return cache.m_cacheHit;
+    }
+
+    long missCount() const
+    {
+        const auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        return cache.m_cacheMiss;
+    }
+
+protected:
+    using Guard = std::lock_guard<typename lock_policy::mutex_type>;
+
+    real_type lookupReal(std::string_view str);
+    template <typename format_type>
+    const char* lookupStr(const real_type& real, const format_type& format);
+
+    real_type updateStrCache(std::string_view str);
+    template <typename format_type>
+    const char* updateRealCache(const real_type& fp,
+            const format_type& format);
+
+private:
+    // Cache's ValueCache, sized at run time. the entries are always in the
+    // first size() slots
+    class ValueCache
+    {
+    public:
+        const CachedItem& operator[](int index) const
+        {
+            return m_items[index];
+        }
+
+        const char* str(int index) const
+        {
+            const auto& item = m_items[index];
+            return item.m_length == CachedItem::Overflow
+                ? m_overflow[index].c_str() : item.m_str;
+        }
+
+        std::string_view view(int index) const
+        {
+            const auto& item = m_items[index];
+            return item.m_length == CachedItem::Overflow
+                ? std::string_view(m_overflow[index])
+                : std::string_view(item.m_str, item.m_length);
+        }
+
+        // an entry of a length chars string
+        static size_t entryBytes(size_t length)
+        {
+            return sizeof(CachedItem) + sizeof(std::string)
+                + (length < inline_str_K ? 0 : length + 1);
+        }
+
+        int size() const { return static_cast<int>(m_items.size()); }
+        bool full() const { return m_items.size() == m_items.capacity(); }
+        size_t bytes() const { return m_bytes; }
+
+        // a new empty slot at the end, the storage must not be full
+        int push()
+        {
+            assert(!full());
+            m_items.emplace_back();
+            m_overflow.emplace_back();
+            m_bytes += entryBytes(0);
+            return size() - 1;
+        }
+
+        void assign(int index, std::string_view str, const real_type& real,
+                uint8_t format=0)
+        {
+            m_bytes -= entryBytes(view(index).size());
+            auto& item = m_items[index];
+            item.m_real = real;
+            item.m_format = format;
+            if (str.size() < inline_str_K) {
+                memcpy(item.m_str, str.data(), str.size());
+                item.m_str[str.size()] = '\0';
+                item.m_length = str.size();
+                m_overflow[index].clear();
+            }
+            else {
+                m_overflow[index].assign(str);
+                item.m_length = CachedItem::Overflow;
+            }
+            m_bytes += entryBytes(str.size());
+        }
+
+        // index's entry is evicted, it stays until moved over or truncated
+        void release(int index)
+        {
+            m_bytes -= entryBytes(view(index).size());
+        }
+
+        void move(int from, int to)
+        {
+            m_items[to] = m_items[from];
+            m_overflow[to].swap(m_overflow[from]);
+        }
+
+        void truncate(int size)
+        {
+            m_items.resize(size);
+            m_overflow.resize(size);
+        }
+
+        // room for capacity entries, the entries move, so do their strings
+        void reallocate(size_t capacity)
+        {
+            assert(capacity >= m_items.size());
+            std::vector<CachedItem> items;
+            items.reserve(capacity);
+            items.assign(m_items.begin(), m_items.end());
+            m_items.swap(items);
+            std::vector<std::string> overflow;
+            overflow.reserve(capacity);
+            for (auto& str : m_overflow) {
+                overflow.push_back(std::move(str));
+            }
+            m_overflow.swap(overflow);
+        }
+
+        size_t storageCapacity() const { return m_items.capacity(); }
+
+        void clear()
+        {
+            m_items.clear();
+            m_overflow.clear();
+            m_bytes = 0;
+        }
+
+    private:
+        std::vector<CachedItem>           m_items;
+        std::vector<std::string>          m_overflow;
+        size_t                            m_bytes = 0;
+    };
+
+    using EvictionState =
+        typename eviction_policy::template State<DynamicSize>;
+    using StrIndex = MapIndex::StrIndex<DynamicSize>;
+    using RealIndex = MapIndex::RealIndex<real_type, DynamicSize>;
+
+    // the slot a new entry of bytes goes to: first the coldest entries are
+    // evicted until it fits the budget, then it takes a new slot, or the
+    // victim's if the cache is full. -1 if it's bigger than the budget
+    template <typename index_type, typename key_type>
+    int reserveSlot(ValueCache& values, EvictionState& eviction,
+            index_type& index, key_type keyOf, size_t bytes);
+
+    // evicts the victims until done(live entries, bytes). all the victims
+    // are picked first, then the last entries move into their slots, so
+    // the policy sees the entries where they were
+    template <typename index_type, typename key_type, typename predicate_type>
+    void evictUntil(ValueCache& values, EvictionState& eviction,
+            index_type& index, key_type keyOf, predicate_type done);
+
+    // evicts down to capacity entries and budget bytes, releases the
+    // storage over capacity
+    template <typename index_type, typename key_type>
+    void shrink(ValueCache& values, EvictionState& eviction,
+            index_type& index, key_type keyOf);
+
+    // the string index points into the storage, it's rebuilt when the
+    // storage moves
+    template <typename index_type, typename key_type>
+    void reindex(const ValueCache& values, index_type& index,
+            key_type keyOf);
+
+    auto realsKey() const
+    {
+        return [this](int slot) { return m_reals.view(slot); };
+    }
+
+    auto stringsKey() const
+    {
+        return [this](int slot) { return m_strings[slot].m_real; };
+    }
+
+    size_t                                m_capacity;
+    size_t                                m_memoryBudget;
+    // the slots evictUntil freed
+    std::vector<int>                      m_evicted;
+
+    ValueCache                            m_reals;
+    ValueCache                            m_strings;
+    EvictionState                         m_realsEviction;
+    EvictionState                         m_stringsEviction;
+    // castToStr result when it's too big for the budget, formatted here
+    // first on every miss, its length decides what's evicted
+    std::string                           m_formatted;
+
+    StrIndex                              m_strToReal;
+    RealIndex                             m_realToStr;
+
+    mutable typename lock_policy::mutex_type m_mutex;
+    // ThreadLocal keeps the object's instances in m_mutex
+    friend lock_policy;
+
+    long                                  m_cacheHit = 0;
+    long                                  m_cacheMiss = 0;
+};
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+real_type
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::castToReal(std::string_view str)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    return cache.lookupReal(str);
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+const char*
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::castToStr(const real_type& real)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    if (!lock_policy::copy_result) {
+        return cache.lookupStr(real, format_policy());
+    }
+
+    static thread_local std::string result;
+    result.assign(cache.lookupStr(real, format_policy()));
+    return result.c_str();
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+const char*
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::castToStr(const real_type& real, const RealFormat& format)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    if (!lock_policy::copy_result) {
+        return cache.lookupStr(real, format);
+    }
+
+    static thread_local std::string result;
+    result.assign(cache.lookupStr(real, format));
+    return result.c_str();
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+void
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::resize(size_t capacity)
+{
+    assert(capacity > 0);
+
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    cache.m_capacity = capacity;
+    cache.shrink(cache.m_reals, cache.m_realsEviction, cache.m_strToReal,
+            cache.realsKey());
+    cache.shrink(cache.m_strings, cache.m_stringsEviction,
+            cache.m_realToStr, cache.stringsKey());
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+void
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::setMemoryBudget(size_t memoryBudget)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    cache.m_memoryBudget = memoryBudget;
+    cache.shrink(cache.m_reals, cache.m_realsEviction, cache.m_strToReal,
+            cache.realsKey());
+    cache.shrink(cache.m_strings, cache.m_stringsEviction,
+            cache.m_realToStr, cache.stringsKey());
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+real_type
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::lookupReal(std::string_view str)
+{
+    auto existing = m_strToReal.find(str);
+    if (existing >= 0) {
+        ++m_cacheHit;
+        m_realsEviction.touch(existing);
+        return m_reals[existing].m_real;
+    }
+    return updateStrCache(str);
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+template <typename format_type>
+const char*
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::lookupStr(const real_type& real, const format_type& format)
+{
+    const uint8_t key = format.key();
+    auto existing = m_realToStr.find(real, [this, key](int slot) {
+            return m_strings[slot].m_format == key;
+        });
+    if (existing >= 0) {
+        ++m_cacheHit;
+        m_stringsEviction.touch(existing);
+        return m_strings.str(existing);
+    }
+    return updateRealCache(real, format);
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+real_type
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::updateStrCache(std::string_view str)
+{
+    ++m_cacheMiss;
+
+    // convert first, if str isn't a number nothing is evicted
+    const real_type fp = stringToReal<real_type>(str);
+
+    const int index = reserveSlot(m_reals, m_realsEviction, m_strToReal,
+            realsKey(), ValueCache::entryBytes(str.size()));
+    if (index < 0) {
+        return fp;
+    }
+    m_reals.assign(index, str, fp);
+    m_strToReal.insert(m_reals.view(index), index);
+    return fp;
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+template <typename format_type>
+const char*
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::updateRealCache(const real_type& fp, const format_type& format)
+{
+    ++m_cacheMiss;
+
+    realToString(fp, m_formatted, format);
+    const int index = reserveSlot(m_strings, m_stringsEviction, m_realToStr,
+            stringsKey(), ValueCache::entryBytes(m_formatted.size()));
+    if (index < 0) {
+        return m_formatted.c_str();
+    }
+    m_strings.assign(index, m_formatted, fp, format.key());
+    m_realToStr.insert(fp, index);
+    return m_strings.str(index);
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+template <typename index_type, typename key_type>
+int
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::reserveSlot(ValueCache& values, EvictionState& eviction, index_type& index, key_type keyOf, size_t bytes)
+{
+    if (m_memoryBudget > 0) {
+        if (bytes > m_memoryBudget) {
+            return -1;
+        }
+        const size_t budget = m_memoryBudget - bytes;
+        evictUntil(values, eviction, index, keyOf,
+                [budget](int, size_t used) { return used <= budget; });
+    }
+
+    if (static_cast<size_t>(values.size()) < m_capacity) {
+        if (values.full()) {
+            values.reallocate(std::min(m_capacity,
+                        std::max<size_t>(16, 2 * values.storageCapacity())));
+            reindex(values, index, keyOf);
+        }
+        const int slot = values.push();
+        eviction.resize(slot + 1);
+        eviction.insert(slot);
+        return slot;
+    }
+
+    const int slot = eviction.victim();
+    index.erase(keyOf(slot), slot);
+    eviction.replace(slot);
+    return slot;
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+template <typename index_type, typename key_type, typename predicate_type>
+void
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::evictUntil(ValueCache& values, EvictionState& eviction, index_type& index, key_type keyOf, predicate_type done)
+{
+    m_evicted.clear();
+    const int size = values.size();
+    while (!done(size - static_cast<int>(m_evicted.size()), values.bytes())) {
+        const int victim = eviction.victim();
+        index.erase(keyOf(victim), victim);
+        eviction.erase(victim);
+        values.release(victim);
+        m_evicted.push_back(victim);
+    }
+    if (m_evicted.empty()) {
+        return;
+    }
+
+    // the entries left over the new size fill the freed slots under it
+    std::sort(m_evicted.begin(), m_evicted.end());
+    const int newSize = size - static_cast<int>(m_evicted.size());
+    int last = size - 1;
+    for (const int slot : m_evicted) {
+        if (slot >= newSize) {
+            break;
+        }
+        while (std::binary_search(m_evicted.begin(), m_evicted.end(), last)) {
+            --last;
+        }
+        index.erase(keyOf(last), last);
+        eviction.move(last, slot);
+        values.move(last, slot);
+        index.insert(keyOf(slot), slot);
+        --last;
+    }
+    values.truncate(newSize);
+    eviction.resize(newSize);
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+template <typename index_type, typename key_type>
+void
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::shrink(ValueCache& values, EvictionState& eviction, index_type& index, key_type keyOf)
+{
+    const size_t capacity = m_capacity;
+    const size_t budget = m_memoryBudget;
+    evictUntil(values, eviction, index, keyOf,
+            [capacity, budget](int size, size_t used) {
+                return static_cast<size_t>(size) <= capacity
+                    && (budget == 0 || used <= budget);
+            });
+    if (values.storageCapacity() > m_capacity) {
+        values.reallocate(m_capacity);
+        reindex(values, index, keyOf);
+    }
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+template <typename index_type, typename key_type>
+void
+DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::reindex(const ValueCache& values, index_type& index, key_type keyOf)
+{
+    index.clear();
+    for (int slot = 0; slot < values.size(); ++slot) {
+        index.insert(keyOf(slot), slot);
+    }
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+size_t DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::bytes(const CacheType& t) const
+{
+    const auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+
+    if (t == String2Real) {
+        return cache.m_reals.bytes();
+    }
+    else if (t == Real2String) {
+        return cache.m_strings.bytes();
+    }
+    else {
+        return cache.m_reals.bytes() + cache.m_strings.bytes();
+    }
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+size_t DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::size(const CacheType& t) const
+{
+    const auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+
+    if (t == String2Real) {
+        return cache.m_strToReal.size();
+    }
+    else if (t == Real2String) {
+        return cache.m_realToStr.size();
+    }
+    else {
+        return cache.m_strToReal.size() + cache.m_realToStr.size();
+    }
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+bool DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::empty(const CacheType& t) const
+{
+    const auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+
+    if (t == String2Real) {
+        return cache.m_strToReal.empty();
+    }
+    else if (t == Real2String) {
+        return cache.m_realToStr.empty();
+    }
+    else {
+        return cache.m_strToReal.empty() && cache.m_realToStr.empty();
+    }
+}
+
+template <
+    typename real_type,
+    typename lock_policy,
+    typename eviction_policy,
+    int inline_str_K,
+    typename format_policy,
+    typename enable
+    >
+void DynamicCache<real_type, lock_policy, eviction_policy, inline_str_K, format_policy, enable>::clear(const CacheType& t)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+
+    if (t == String2Real || t == Both) {
+        cache.m_strToReal.clear();
+        cache.m_reals.clear();
+        cache.m_realsEviction.clear();
+        cache.m_realsEviction.resize(0);
+    }
+
+    if (t == Real2String || t == Both) {
+        cache.m_realToStr.clear();
+        cache.m_strings.clear();
+        cache.m_stringsEviction.clear();
+        cache.m_stringsEviction.resize(0);
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,354 @@
+#ifndef LEXICAL_CACHE_EVICTION_POLICIES_H_INCLUDED
+#define LEXICAL_CACHE_EVICTION_POLICIES_H_INCLUDED
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <assert.h>
+
+// eviction policies of Cache, each one provides a State<N> tracking the N
+// slots of a cache:
+//
+// - insert(slot): a free slot now holds a new entry
+// - touch(slot): slot was hit
+// - victim(): the slot to evict, only called when all N slots are in use.
+//   the entry may still be kept, e.g. if the admission policy rejects its
+//   replacement
+// - replace(slot): the victim's entry was replaced by a new one
+// - clear(): all slots are free again
+// - forEachByAge(size, f): calls f(slot) on the size slots in use, the next
+//   victim first, in the order they'd be evicted if nothing else happened.
+//   inserting them in that order into an empty State gives the same order
+//
+// State<DynamicSize> tracks a number of slots set at run time, for
+// DynamicCache, which keeps its entries in the first slots and also calls:
+//
+// - erase(slot): slot's entry was evicted, victim() won't return it again.
+//   the slot is only free once moved over or resized away
+// - move(from, to): the entry in from moved to the erased slot to, it keeps
+//   its place in the eviction order, as far as the policy allows
+// - resize(n): the slots are [0, n), the ones removed must be free
+//
+// all operations are O(1), amortised for CLOCK and SIEVE
+namespace lexical_cache
+{
+
+constexpr int DynamicSize = 0;
+
+namespace detail
+{
+
+// per slot state, a vector when the slots are only known at run time
+template <typename T, int N>
+using SlotArray = typename std::conditional<N == DynamicSize,
+      std::vector<T>, std::array<T, N>>::type;
+
+// intrusive doubly linked list over slot indices, front is the newest
+template <int N>
+class SlotList
+{
+public:
+    SlotList()
+    {
+        clear();
+    }
+
+    void pushFront(int slot)
+    {
+        m_prev[slot] = -1;
+        m_next[slot] = m_head;
+        if (m_head >= 0) {
+            m_prev[m_head] = slot;
+        }
+        else {
+            m_tail = slot;
+        }
+        m_head = slot;
+    }
+
+    void unlink(int slot)
+    {
+        if (m_prev[slot] >= 0) {
+            m_next[m_prev[slot]] = m_next[slot];
+        }
+        else {
+            m_head = m_next[slot];
+        }
+        if (m_next[slot] >= 0) {
+            m_prev[m_next[slot]] = m_prev[slot];
+        }
+        else {
+            m_tail = m_prev[slot];
+        }
+    }
+
+    // from's links now point at to, from's are left as they were
+    void move(int from, int to)
+    {
+        m_prev[to] = m_prev[from];
+        m_next[to] = m_next[from];
+        if (m_prev[to] >= 0) {
+            m_next[m_prev[to]] = to;
+        }
+        else {
+            m_head = to;
+        }
+        if (m_next[to] >= 0) {
+            m_prev[m_next[to]] = to;
+        }
+        else {
+            m_tail = to;
+        }
+    }
+
+    void resize(int n)
+    {
+        m_prev.resize(n);
+        m_next.resize(n);
+    }
+
+    int head() const { return m_head; }
+    int tail() const { return m_tail; }
+    int prev(int slot) const { return m_prev[slot]; }
+    int next(int slot) const { return m_next[slot]; }
+
+    void clear()
+    {
+        m_head = -1;
+        m_tail = -1;
+    }
+
+private:
+    SlotArray<int, N>                     m_prev;
+    SlotArray<int, N>                     m_next;
+    int                                   m_head;
+    int                                   m_tail;
+};
+
+}
+
+// least recently used, a hit moves the entry to the front of the list
+struct LruEviction
+{
+    template <int N>
+    class State
+    {
+    public:
+        void insert(int slot) { m_list.pushFront(slot); }
+
+        void touch(int slot)
+        {
+            if (m_list.head() != slot) {
+                m_list.unlink(slot);
+                m_list.pushFront(slot);
+            }
+        }
+
+        int victim()
+        {
+            assert(m_list.tail() >= 0);
+            return m_list.tail();
+        }
+
+        void replace(int slot) { touch(slot); }
+
+        void clear() { m_list.clear(); }
+
+        template <typename F>
+        void forEachByAge(int, F f) const
+        {
+            for (int slot = m_list.tail(); slot >= 0; slot = m_list.prev(slot)) {
+                f(slot);
+            }
+        }
+
+        void resize(int n) { m_list.resize(n); }
+        void erase(int slot) { m_list.unlink(slot); }
+        void move(int from, int to) { m_list.move(from, to); }
+
+    private:
+        detail::SlotList<N>               m_list;
+    };
+};
+
+// second chance, a hit only sets the referenced bit, the hand clears the bits
+// it passes and evicts the first entry without one
+struct ClockEviction
+{
+    template <int N>
+    class State
+    {
+    public:
+        State()
+        {
+            clear();
+        }
+
+        void insert(int slot) { m_referenced[slot] = false; }
+        void touch(int slot) { m_referenced[slot] = true; }
+
+        int victim()
+        {
+            for (;;) {
+                const int slot = m_hand;
+                m_hand = (m_hand + 1) % static_cast<int>(m_referenced.size());
+                if (!m_referenced[slot]) {
+                    return slot;
+                }
+                m_referenced[slot] = false;
+            }
+        }
+
+        void replace(int slot) { insert(slot); }
+
+        void clear()
+        {
+            std::fill(m_referenced.begin(), m_referenced.end(), false);
+            m_hand = 0;
+        }
+
+        // the hand's order, the referenced ones on its second round
+        template <typename F>
+        void forEachByAge(int size, F f) const
+        {
+            const int n = static_cast<int>(m_referenced.size());
+            for (const bool referenced : {false, true}) {
+                for (int i = 0; i < n; ++i) {
+                    const int slot = (m_hand + i) % n;
+                    if (slot < size && m_referenced[slot] == referenced) {
+                        f(slot);
+                    }
+                }
+            }
+        }
+
+        void resize(int n)
+        {
+            m_referenced.resize(n, false);
+            if (m_hand >= n) {
+                m_hand = 0;
+            }
+        }
+
+        // the hand passes it once more, by then the victims have been
+        // found and the slots compacted
+        void erase(int slot) { m_referenced[slot] = true; }
+
+        void move(int from, int to)
+        {
+            m_referenced[to] = m_referenced[from];
+            if (m_hand == from) {
+                m_hand = to;
+            }
+        }
+
+    private:
+        detail::SlotArray<bool, N>        m_referenced;
+        int                               m_hand;
+    };
+};
+
+// SIEVE, like CLOCK but the entries are kept in insertion order and the
+// hand moves from the oldest towards the newest, so new entries that are
+// never hit again are evicted quickly and hits never reorder anything
+struct SieveEviction
+{
+    template <int N>
+    class State
+    {
+    public:
+        State()
+        {
+            clear();
+        }
+
+        void insert(int slot)
+        {
+            m_visited[slot] = false;
+            m_list.pushFront(slot);
+        }
+
+        void touch(int slot) { m_visited[slot] = true; }
+
+        int victim()
+        {
+            int slot = m_hand >= 0 ? m_hand : m_list.tail();
+            assert(slot >= 0);
+            while (m_visited[slot]) {
+                m_visited[slot] = false;
+                slot = m_list.prev(slot) >= 0
+                    ? m_list.prev(slot) : m_list.tail();
+            }
+            m_hand = m_list.prev(slot);
+            return slot;
+        }
+
+        void replace(int slot)
+        {
+            m_list.unlink(slot);
+            insert(slot);
+        }
+
+        void clear()
+        {
+            m_list.clear();
+            std::fill(m_visited.begin(), m_visited.end(), false);
+            m_hand = -1;
+        }
+
+        // from the hand towards the newest then from the oldest, the
+        // visited ones on the hand's second round
+        template <typename F>
+        void forEachByAge(int, F f) const
+        {
+            const int start = m_hand >= 0 ? m_hand : m_list.tail();
+            if (start < 0) {
+                return;
+            }
+            for (const bool visited : {false, true}) {
+                int slot = start;
+                do {
+                    if (m_visited[slot] == visited) {
+                        f(slot);
+                    }
+                    slot = m_list.prev(slot) >= 0
+                        ? m_list.prev(slot) : m_list.tail();
+                } while (slot != start);
+            }
+        }
+
+        void resize(int n)
+        {
+            m_list.resize(n);
+            m_visited.resize(n, false);
+        }
+
+        // the hand moves on to the next newer entry
+        void erase(int slot)
+        {
+            if (m_hand == slot) {
+                m_hand = m_list.prev(slot);
+            }
+            m_list.unlink(slot);
+        }
+
+        void move(int from, int to)
+        {
+            m_list.move(from, to);
+            m_visited[to] = m_visited[from];
+            if (m_hand == from) {
+                m_hand = to;
+            }
+        }
+
+    private:
+        detail::SlotList<N>               m_list;
+        detail::SlotArray<bool, N>        m_visited;
+        int                               m_hand;
+    };
+};
+
+}
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef LEXICAL_CACHE_EXACT_INDEX_H_INCLUDED
+#define LEXICAL_CACHE_EXACT_INDEX_H_INCLUDED
+
+#include "flat_table.h"
+#include "hash_functions.h"
+#include "value_traits.h"
+
+#include <unordered_map>
+#include <cstdint>
+
+namespace lexical_cache
+{
+
+// real -> index lookup for the exact types of ValueTraits, integers and
+// Decimal: a real only matches the entries of equal key, so a lookup probes
+// its own bucket and compares integers, where UlpBucketIndex probes a few
+// neighbouring buckets and compares each candidate within a tolerance. same
+// interface, a bucket is a key
+template <typename real_type>
+class ExactIndex
+{
+public:
+    using bucket_type = long long;
+
+    struct Entry
+    {
+        real_type m_real;
+        int m_index;
+    };
+
+    using container_type = std::unordered_multimap<bucket_type, Entry>;
+    using const_iterator = typename container_type::const_iterator;
+
+    // index of an entry equal to real, -1 if none
+    int find(const real_type& real) const
+    {
+        return find(real, [](int) { return true; });
+    }
+
+    // same, among the entries whose index passes accept(index)
+    template <typename predicate_type>
+    int find(const real_type& real, predicate_type accept) const
+    {
+        auto range = m_buckets.equal_range(bucketOf(real));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (accept(it->second.m_index)) {
+                return it->second.m_index;
+            }
+        }
+        return -1;
+    }
+
+    void prefetch(const real_type&) const {}
+
+    void insert(const real_type& real, int index)
+    {
+        m_buckets.emplace(bucketOf(real), Entry{real, index});
+    }
+
+    bool erase(const real_type& real, int index)
+    {
+        auto range = m_buckets.equal_range(bucketOf(real));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.m_index == index) {
+                m_buckets.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t size() const { return m_buckets.size(); }
+    bool   empty() const { return m_buckets.empty(); }
+    void   clear() { m_buckets.clear(); }
+
+    const_iterator begin() const { return m_buckets.begin(); }
+    const_iterator end() const { return m_buckets.end(); }
+
+    template <typename visitor_type>
+    void forEach(visitor_type visit) const
+    {
+        for (const auto& entry : m_buckets) {
+            visit(entry.first, entry.second.m_real, entry.second.m_index);
+        }
+    }
+
+    template <typename visitor_type>
+    void forEachBucket(const real_type& real, visitor_type visit) const
+    {
+        visit(bucketOf(real));
+    }
+
+    static bucket_type bucketOf(const real_type& real)
+    {
+        return static_cast<bucket_type>(ValueTraits<real_type>::key(real));
+    }
+
+private:
+    container_type                        m_buckets;
+};
+
+// ExactIndex over a FlatTable for at most N entries, like
+// FlatUlpBucketIndex: one run of contiguous entries per lookup, no
+// allocation
+template <typename real_type, int N>
+class FlatExactIndex
+{
+public:
+    using bucket_type = typename ExactIndex<real_type>::bucket_type;
+
+    int find(const real_type& real) const
+    {
+        return find(real, [](int) { return true; });
+    }
+
+    template <typename predicate_type>
+    int find(const real_type& real, predicate_type accept) const
+    {
+        const bucket_type key = bucketOf(real);
+        int found = -1;
+        m_table.find(hashOf(key), [&](const Entry& entry) {
+                if (bucketOf(entry.m_real) == key && accept(entry.m_slot)) {
+                    found = entry.m_slot;
+                    return true;
+                }
+                return false;
+            });
+        return found;
+    }
+
+    void prefetch(const real_type& real) const
+    {
+        m_table.prefetch(hashOf(bucketOf(real)));
+    }
+
+    void insert(const real_type& real, int index)
+    {
+        m_table.insert(Entry{hashOf(bucketOf(real)), index, real});
+    }
+
+    bool erase(const real_type& real, int index)
+    {
+        return m_table.erase(hashOf(bucketOf(real)), index);
+    }
+
+    size_t size() const { return m_table.size(); }
+    bool   empty() const { return m_table.empty(); }
+    void   clear() { m_table.clear(); }
+
+    template <typename visitor_type>
+    void forEach(visitor_type visit) const
+    {
+        m_table.forEach([&](const Entry& entry) {
+                visit(bucketOf(entry.m_real), entry.m_real, entry.m_slot);
+            });
+    }
+
+    template <typename visitor_type>
+    void forEachBucket(const real_type& real, visitor_type visit) const
+    {
+        visit(bucketOf(real));
+    }
+
+    static bucket_type bucketOf(const real_type& real)
+    {
+        return ExactIndex<real_type>::bucketOf(real);
+    }
+
+private:
+    struct Entry
+    {
+        uint32_t m_hash;
+        int m_slot;
+        real_type m_real;
+    };
+
+    static uint32_t hashOf(bucket_type key)
+    {
+        // consecutive ids and ticks mustn't share a run
+        return static_cast<uint32_t>(mix64(static_cast<uint64_t>(key)));
+    }
+
+    detail::FlatTable<Entry, N>           m_table;
+};
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef LEXICAL_CACHE_FLAT_TABLE_H_INCLUDED
+#define LEXICAL_CACHE_FLAT_TABLE_H_INCLUDED
+
+#include <array>
+#include <cstdint>
+#include <assert.h>
+
+namespace lexical_cache
+{
+
+namespace detail
+{
+
+constexpr int pow2AtLeast(int n)
+{
+    return n <= 1 ? 1 : 2 * pow2AtLeast((n + 1) / 2);
+}
+
+// open addressing hash table of at most N entries in a fixed array, at most
+// half full. entry_type has a uint32_t m_hash and an int m_slot, the cache
+// slot it points to, -1 marks an empty bucket.
+//
+// linear probing, and erase shifts the rest of the run back rather than
+// leaving a tombstone, so runs stay short however many times entries are
+// replaced, and nothing is ever allocated
+template <typename entry_type, int N>
+class FlatTable
+{
+public:
+    static_assert(N > 0, "table can't be empty");
+
+    FlatTable()
+    {
+        clear();
+    }
+
+    // calls visit(entry) on every entry with this hash until it returns true
+    template <typename visitor_type>
+    bool find(uint32_t hash, visitor_type visit) const
+    {
+        for (int i = hash & Mask; m_entries[i].m_slot >= 0; i = (i + 1) & Mask) {
+            if (m_entries[i].m_hash == hash && visit(m_entries[i])) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // pulls the first bucket of hash's probe sequence into the cpu cache,
+    // for batches of lookups
+    void prefetch(uint32_t hash) const
+    {
+        __builtin_prefetch(&m_entries[hash & Mask]);
+    }
+
+    void insert(const entry_type& entry)
+    {
+        assert(m_size < N);
+        int i = entry.m_hash & Mask;
+        while (m_entries[i].m_slot >= 0) {
+            i = (i + 1) & Mask;
+        }
+        m_entries[i] = entry;
+        ++m_size;
+    }
+
+    bool erase(uint32_t hash, int slot)
+    {
+        int i = hash & Mask;
+        while (m_entries[i].m_slot >= 0
+                && (m_entries[i].m_hash != hash || m_entries[i].m_slot != slot)) {
+            i = (i + 1) & Mask;
+        }
+        if (m_entries[i].m_slot < 0) {
+            return false;
+        }
+
+        // move back every entry of the run that may fill the hole, i.e.
+        // whose home bucket isn't between the hole and itself
+        for (int j = (i + 1) & Mask; m_entries[j].m_slot >= 0; j = (j + 1) & Mask) {
+            const int home = m_entries[j].m_hash & Mask;
+            if (((j - home) & Mask) >= ((j - i) & Mask)) {
+                m_entries[i] = m_entries[j];
+                i = j;
+            }
+        }
+        m_entries[i].m_slot = -1;
+        --m_size;
+        return true;
+    }
+
+    template <typename visitor_type>
+    void forEach(visitor_type visit) const
+    {
+        for (const auto& entry : m_entries) {
+            if (entry.m_slot >= 0) {
+                visit(entry);
+            }
+        }
+    }
+
+    size_t size() const { return m_size; }
+    bool   empty() const { return m_size == 0; }
+
+    void clear()
+    {
+        for (auto& entry : m_entries) {
+            entry.m_slot = -1;
+        }
+        m_size = 0;
+    }
+
+private:
+    static constexpr int Capacity = pow2AtLeast(2 * N);
+    static constexpr int Mask = Capacity - 1;
+
+    std::array<entry_type, Capacity>      m_entries;
+    int                                   m_size;
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef LEXICAL_CACHE_FORMAT_POLICIES_H_INCLUDED
+#define LEXICAL_CACHE_FORMAT_POLICIES_H_INCLUDED
+
+#include "real_formatter.h"
+
+#include <type_traits>
+#include <assert.h>
+#include <cstdint>
+#include <cstdio>
+
+// format policies of the caches, how castToStr converts a real on a miss.
+// each one provides:
+//
+// - format(real, buf, size): like snprintf, writes at most size - 1 chars
+//   and a null to buf, returns the length of the whole string
+// - key(): tells the formats apart, a cache holding strings of several
+//   formats only hits on the one asked for
+//
+// RealFormat picks one of them at run time
+namespace lexical_cache
+{
+
+// the most decimals of FixedFormat and RealFormat::fixed
+constexpr int MaxFixedDecimals = 32;
+
+namespace detail
+{
+
+enum FormatKey : uint8_t
+{
+    ShortestKey = 0,
+    PlainKey = 1,
+    LegacyKey = 2,
+    FixedKey = 3, // + decimals
+};
+
+}
+
+// the shortest string that parses back to the same real, e.g. "0.1", "100",
+// "1e+20", see real_formatter.h. locale independent and never allocates
+struct ShortestFormat
+{
+    template <typename real_type>
+    static int format(const real_type& real, char* buf, size_t size)
+    {
+        return formatReal(real, buf, size);
+    }
+
+    static constexpr uint8_t key() { return detail::ShortestKey; }
+};
+
+// the shortest digits, never in scientific notation, unlike "%g", e.g.
+// "0.1", "100", "100000000000000000000", "0.00000015", see formatPlain
+struct PlainFormat
+{
+    template <typename real_type>
+    static int format(const real_type& real, char* buf, size_t size)
+    {
+        return formatPlain(real, buf, size);
+    }
+
+    static constexpr uint8_t key() { return detail::PlainKey; }
+};
+
+// decimals digits after the point, rounded like printf's "%.*f", e.g.
+// "0.10", "100.00" with 2. for prices quoted to a tick
+template <int decimals>
+struct FixedFormat
+{
+    static_assert(decimals >= 0 && decimals <= MaxFixedDecimals,
+            "0 to MaxFixedDecimals decimals");
+
+    template <typename real_type>
+    static int format(const real_type& real, char* buf, size_t size)
+    {
+        return formatFixed(real, decimals, buf, size);
+    }
+
+    static constexpr uint8_t key() { return detail::FixedKey + decimals; }
+};
+
+// std::to_string's "%f": six decimals, e.g. "0.100000", "100.000000". small
+// reals lose their digits, and the decimal point is the locale's. integers
+// are its "%d", Decimal six exact decimals
+struct LegacyFormat
+{
+    template <typename real_type>
+    static int format(const real_type& real, char* buf, size_t size)
+    {
+        using type = typename std::remove_cv<real_type>::type;
+
+        if constexpr (std::is_same<long double, type>::value) {
+            return snprintf(buf, size, "%Lf", real);
+        }
+        else if constexpr (std::is_floating_point<type>::value) {
+            return snprintf(buf, size, "%f", static_cast<double>(real));
+        }
+        else if constexpr (std::is_integral<type>::value) {
+            return formatReal(real, buf, size);
+        }
+        else {
+            return formatFixed(real, 6, buf, size);
+        }
+    }
+
+    static constexpr uint8_t key() { return detail::LegacyKey; }
+};
+
+// a format chosen at run time, e.g. the decimals of each instrument:
+//
+//   cache.castToStr(price, RealFormat::fixed(instrument.decimals()));
+class RealFormat
+{
+public:
+    static RealFormat shortest() { return RealFormat(detail::ShortestKey); }
+    static RealFormat plain() { return RealFormat(detail::PlainKey); }
+    static RealFormat legacy() { return RealFormat(detail::LegacyKey); }
+
+    static RealFormat fixed(int decimals)
+    {
+        assert(decimals >= 0 && decimals <= MaxFixedDecimals);
+        return RealFormat(detail::FixedKey + decimals);
+    }
+
+    // the format of a policy
+    template <typename format_policy>
+    static RealFormat of() { return RealFormat(format_policy::key()); }
+
+    uint8_t key() const { return m_key; }
+
+    template <typename real_type>
+    int format(const real_type& real, char* buf, size_t size) const
+    {
+        switch (m_key) {
+        case detail::ShortestKey:
+            return ShortestFormat::format(real, buf, size);
+        case detail::PlainKey:
+            return PlainFormat::format(real, buf, size);
+        case detail::LegacyKey:
+            return LegacyFormat::format(real, buf, size);
+        default:
+            return formatFixed(real, m_key - detail::FixedKey, buf, size);
+        }
+    }
+
+    bool operator==(const RealFormat& other) const
+    {
+        return m_key == other.m_key;
+    }
+
+    bool operator!=(const RealFormat& other) const
+    {
+        return m_key != other.m_key;
+    }
+
+private:
+    explicit RealFormat(int key) : m_key(static_cast<uint8_t>(key)) {}
+
+    uint8_t m_key;
+};
+
+}
+
+#endif
@@ -2,10 +2,24 @@
 #define LEXICAL_CACHE_HASH_FUNCTIONS_H_INCLUDED
 
 #include <string>
+#include <cstdint>
 
 namespace lexical_cache
 {
 
+    // the murmur3 finalizer, every bit of h affects every bit of the result.
+    // for hashes whose low bits are poor, and for keys that are already
+    // integers, like ulp buckets, before they index a power of 2 table
+    inline uint64_t mix64(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
     struct BKDRHash
     {
         size_t operator() (const std::string& str) const
@@ -0,0 +1,91 @@
+#ifndef LEXICAL_CACHE_INDEX_POLICIES_H_INCLUDED
+#define LEXICAL_CACHE_INDEX_POLICIES_H_INCLUDED
+
+#include "str_index.h"
+#include "ulp_bucket_index.h"
+#include "exact_index.h"
+
+#include <type_traits>
+
+// index policies of Cache, the backends of its string -> slot and real ->
+// slot indexes. each one provides StrIndex<N> and RealIndex<real_type, N>,
+// indexing the N slots of a cache, see str_index.h and ulp_bucket_index.h.
+// the reals of an exact type, see value_traits.h, get the exact index of the
+// same backend, see exact_index.h
+namespace lexical_cache
+{
+
+namespace detail
+{
+
+template <typename real_type, typename fuzzy_index, typename exact_index>
+using RealIndexOf = typename std::conditional<
+    ValueTraits<real_type>::exact, exact_index, fuzzy_index>::type;
+
+}
+
+// node based std::unordered_map and std::unordered_multimap
+struct MapIndex
+{
+    template <int N>
+    using StrIndex = MapStrIndex<CstrHash>;
+
+    template <typename real_type, int N>
+    using RealIndex = detail::RealIndexOf<real_type,
+          UlpBucketIndex<real_type>, ExactIndex<real_type>>;
+};
+
+// google::dense_hash_map for strings, reals as MapIndex
+struct DenseIndex
+{
+    template <int N>
+    using StrIndex = DenseStrIndex<N, CstrHash>;
+
+    template <typename real_type, int N>
+    using RealIndex = detail::RealIndexOf<real_type,
+          UlpBucketIndex<real_type>, ExactIndex<real_type>>;
+};
+
+// fixed open addressing tables, no allocation at all
+struct FlatIndex
+{
+    template <int N>
+    using StrIndex = FlatStrIndex<N>;
+
+    template <typename real_type, int N>
+    using RealIndex = detail::RealIndexOf<real_type,
+          FlatUlpBucketIndex<real_type, N>, FlatExactIndex<real_type, N>>;
+};
+
+namespace detail
+{
+
+// the tag array for the small caches it's made for, the flat table otherwise
+template <int N, bool small=(N <= 64)>
+struct AutoStrIndex
+{
+    using type = FlatStrIndex<N>;
+};
+
+template <int N>
+struct AutoStrIndex<N, true>
+{
+    using type = TagStrIndex<N>;
+};
+
+}
+
+// FlatIndex, with a SIMD tag array for strings when N <= 64
+struct AutoIndex
+{
+    template <int N>
+    using StrIndex = typename detail::AutoStrIndex<N>::type;
+
+    template <typename real_type, int N>
+    using RealIndex = detail::RealIndexOf<real_type,
+          FlatUlpBucketIndex<real_type, N>, FlatExactIndex<real_type, N>>;
+};
+
+}
+
+#endif
@@ -2,18 +2,37 @@
 #define LEXICAL_CACHE_H_INCLUDED
 
 #include "hash_functions.h"
+#include "ulp_bucket_index.h"
+#include "index_policies.h"
+#include "value_traits.h"
+#include "real_parser.h"
+#include "lock_policies.h"
+#include "eviction_policies.h"
+#include "admission_policies.h"
+#include "format_policies.h"
+#include "bypass_policies.h"
+#include "stats_policies.h"
+#include "snapshot.h"
 
 #include <sparsehash/dense_hash_map>
 #include <comparefp/comparefp.h>
 
 #include <unordered_map>
 #include <map>
+#include <vector>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <limits>
 #include <chrono>
 #include <tuple>
 #include <array>
+#include <algorithm>
 #include <iostream>
+#include <cstring>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
 #include <assert.h>
 
 // NOTES: sort by time, so I can kick out the oldest one
@@ -43,48 +62,120 @@
 // search for either string or double when reading,
 // when overflow, heaptify by time and then evict heap root
 // the two caches have to be the same, unless use 2 containers
-// q1: do i have cache line efficiency here:
-// not sure, double and time will be fixed size, but string can be of
-// any size because of small string optimization, so have to use char[]
-//
-// futher potential improvements:
-// 1. do i have to construct a new string every time? can I reuse the cached 
-//    memory?
-// 2. thread safety, should provide a mutex policy, what about thread local?
-//
-// 3. should collect stats about cost of string <-> real conversion with mutex
-//    locking, if the cost outweights the benefit, then simply return a
-//    conversion everytime.
 //
 namespace lexical_cache
 {
 
-using timestamp_type = int;
-
-// TODO: handle wrap
-inline timestamp_type updateTimestamp(timestamp_type& t)
-{
-    return ++t;
-}
-
 enum CacheType {
     String2Real = 0,
     Real2String,
     Both,
 };
 
+// the conversion done on a cache miss, same results as std::stod and friends
+// in the "C" locale, but much faster, see real_parser.h
+template <typename real_type>
+real_type stringToReal(std::string_view str)
+{
+    return parseReal<real_type>(str);
+}
+
+// same without exceptions, see tryParseReal
+template <typename real_type>
+ParseError tryStringToReal(std::string_view str, real_type& real)
+{
+    return tryParseReal(str, real);
+}
+
+// what Cache::tryCastToReal returns, a real or why there's none, like
+// std::expected<real_type, ParseError>
+template <typename real_type>
+class CastResult
+{
+public:
+    CastResult(const real_type& value, ParseError error=ParseError::None)
+        : m_value(value)
+        , m_error(error)
+    {
+    }
+
+    bool hasValue() const { return m_error == ParseError::None; }
+    explicit operator bool() const { return hasValue(); }
+    ParseError error() const { return m_error; }
+
+    // throws what castToReal would have if there's no value
+    const real_type& value() const
+    {
+        if (!hasValue()) {
+            throwParseError(m_error);
+        }
+        return m_value;
+    }
+
+    real_type valueOr(const real_type& fallback) const
+    {
+        return hasValue() ? m_value : fallback;
+    }
+
+    // unchecked
+    const real_type& operator*() const { return m_value; }
+
+private:
+    real_type                             m_value;
+    ParseError                            m_error;
+};
+
+// the conversion done on a real cache miss, see format_policies.h. writes
+// into buf, returns the length snprintf would have written
+template <typename format_policy=ShortestFormat, typename real_type>
+int realToString(const real_type& real, char* buf, size_t size)
+{
+    return format_policy::format(real, buf, size);
+}
+
+// same, into str, however long the result, format is a format policy or a
+// RealFormat
+template <typename real_type, typename format_type>
+void realToString(const real_type& real, std::string& str,
+        const format_type& format)
+{
+    char buf[ShortestRealLength];
+    const int n = format.format(real, buf, sizeof(buf));
+    if (n < static_cast<int>(sizeof(buf))) {
+        str.assign(buf, n);
+        return;
+    }
+    str.resize(n + 1);
+    format.format(real, &str[0], n + 1);
+    str.resize(n);
+}
+
+template <typename format_policy=ShortestFormat, typename real_type>
+void realToString(const real_type& real, std::string& str)
+{
+    realToString(real, str, format_policy());
+}
+
 struct CstrHash
 {
     inline size_t operator() (const char* s) const {
         if (!s) {
             return 0;
         }
+        return (*this)(std::string_view(s));
+    }
+
+    inline size_t operator() (std::string_view str) const {
         size_t hash = 1;
         // the below loop is the equivalent functionality of the duffy device
 //        for (; *s; ++s) {
 //            hash = hash * 5 + *s;                                               
 //        }
-        auto count = strlen(s);
+        auto s = str.data();
+        auto count = str.size();
+        if (count == 0) {
+            return hash;
+        }
         auto n = (count + 3)/4;
         switch (count % 4) {
             case 0: do { hash = hash * 5 + *s; ++s;
@@ -102,28 +193,58 @@ struct CstrHash
         }
         return ::strcmp(s1, s2) == 0;
     }
+
+    inline bool operator() (std::string_view s1, std::string_view s2) const {
+        return s1 == s2;
+    }
 };
 
 template <
     typename real_type,
     int cache_size_N=10,
+    typename lock_policy=NoLock,
+    typename eviction_policy=LruEviction,
+    typename admission_policy=AdmitAll,
+    int inline_str_K=40,
+    typename index_policy=AutoIndex,
+    typename format_policy=ShortestFormat,
+    typename bypass_policy=NeverBypass,
+    typename stats_policy=DefaultStats<lock_policy>,
     typename enable=
-        typename std::enable_if<std::is_floating_point<real_type>::value>::type
+        typename std::enable_if<ValueTraits<real_type>::supported>::type
     >
 class Cache
 {
 public:
-    struct CachedItem
+    static_assert(inline_str_K > 0 && inline_str_K < 255,
+            "the inline string length has to fit in a byte");
+
+    // one cache line for the default inline_str_K, the string is inline and
+    // null terminated when shorter than inline_str_K, otherwise m_length is
+    // Overflow and the string is in the ValueCache's overflow arena
+    struct alignas(64) CachedItem
     {
+        static constexpr uint8_t Overflow = 255;
+
         CachedItem()
-            : m_real(NAN)
-            , m_time(0)
+            : m_real(std::numeric_limits<real_type>::quiet_NaN())
+            , m_length(0)
+            , m_format(0)
+            , m_error(0)
         {
+            m_str[0] = '\0';
         }
 
-        std::string m_str;
+        ParseError error() const { return static_cast<ParseError>(m_error); }
+
         real_type m_real;
-        timestamp_type m_time;
+        uint8_t m_length;
+        // the key of the format m_str is in, see RealFormat, Real2String only
+        uint8_t m_format;
+        // the ParseError of m_str, String2Real only, a negative entry unless
+        // it's 0
+        uint8_t m_error;
+        char m_str[inline_str_K];
     };
 
     Cache()
@@ -132,171 +253,1013 @@ public:
 
     ~Cache() = default;
 
-    // all copy and move operations using default
+    // all copy and move operations using default, they are deleted by the
+    // lock policies holding a mutex
 
-    real_type castToReal(const std::string& str);
+    // str doesn't have to be null terminated, a std::string is only built on
+    // a miss, e.g. str can point straight into a receive buffer. throws like
+    // parseReal if str isn't a number
+    real_type castToReal(std::string_view str);
+
+    // castToReal without exceptions. a string that isn't a number is cached
+    // too, as a negative entry, so a stream of the same bad input, "N/A" or
+    // "-", costs a lookup each rather than a parse and an unwinding
+    CastResult<real_type> tryCastToReal(std::string_view str);
+
+    real_type castToReal(const char* str, size_t len)
+    {
+        return castToReal(std::string_view(str, len));
+    }
+
+    // formatted by format_policy on a miss, the shortest string that parses
+    // back to real by default.
+    //
+    // unless lock_policy::copy_result, the returned string lives in the cache
+    // until it's evicted (until the next castToStr call if the admission
+    // policy didn't cache it or the bypass policy skipped the cache),
+    // otherwise it's copied to a thread local buffer and lives until the next
+    // castToStr call on this thread
     const char* castToStr(const real_type& real);
 
+    // same, in a format chosen at run time, e.g. RealFormat::fixed(2). each
+    // format has its own entries, a real only hits on a string in format
+    const char* castToStr(const real_type& real, const RealFormat& format);
+
+    // castToReal on count strings under a single lock, same results. the
+    // keys are hashed and their index buckets prefetched first, then the hits
+    // are resolved, then the misses converted, so a batch waits for memory
+    // once rather than once per key. the eviction policy sees the hits before
+    // the misses.
+    //
+    // a string that isn't a number doesn't stop the batch: all of it is
+    // looked up and cached first, then castToRealBatch throws like parseReal
+    // for the first such string. out holds the other strings' reals either
+    // way
+    void castToRealBatch(const std::string_view* strs, size_t count,
+            real_type* out);
+
+    // same without exceptions, an error per string: out[i] is strs[i]'s real
+    // and errors[i] ParseError::None, or out[i] is NaN and errors[i] why
+    // strs[i] isn't a number. returns the number of such strings
+    size_t tryCastToRealBatch(const std::string_view* strs, size_t count,
+            real_type* out, ParseError* errors);
+
+    // same for castToStr, the strings are copied to out, a miss late in the
+    // batch may evict the slot an earlier result was in
+    void castToStrBatch(const real_type* reals, size_t count,
+            std::string* out);
+    void castToStrBatch(const real_type* reals, size_t count,
+            std::string* out, const RealFormat& format);
+
     size_t size(const CacheType& t=Both) const;
     bool   empty(const CacheType& t=Both) const;
     void   clear(const CacheType& t=Both);
 
-    double missRatio() const
+    // writes the entries of both directions to path, in the order they'd
+    // be evicted, see snapshot.h. the file is written next to path then
+    // renamed over it, so path is always a whole snapshot. false if it
+    // couldn't be written. with ThreadLocal it's the calling thread's cache
+    bool saveSnapshot(const std::string& path) const;
+
+    // replaces the entries with path's, in one pass, each direction's
+    // eviction order as it was saved. if there are more than cache_size_N
+    // the ones that would be evicted first are dropped. false, and the
+    // cache unchanged, if path can't be read, is corrupt or isn't a
+    // snapshot of real_type's. like after clear(), the admission and bypass
+    // policies start afresh
+    bool loadSnapshot(const std::string& path);
+
+    // same on a stream sparsehash's serialize() would take, e.g. a FILE*
+    template <typename OUTPUT>
+    bool writeSnapshot(OUTPUT* fp) const;
+    template <typename INPUT>
+    bool readSnapshot(INPUT* fp);
+
+    // hits, misses, insertions and evictions of each direction, and their
+    // latencies if stats_policy is timed, see stats_policies.h. all 0 with
+    // NoStats
+    CacheStats stats() const
     {
-        return static_cast<double>(m_cacheMiss) / (m_cacheHit + m_cacheMiss)*100;
+        const auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        return cache.statsUnlocked();
+    }
+
+    double missRatio(const CacheType& t=Both) const
+    {
+        return counts(t).missRatio();
     }
 
     void resetStats()
     {
-        m_cacheMiss = 0.0;
-        m_cacheHit = 0.0;
+        auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        cache.m_realsStats.clear();
+        cache.m_stringsStats.clear();
+    }
+
+    long hitCount(const CacheType& t=Both) const
+    {
+        return counts(t).m_hits;
+    }
+
+    long missCount(const CacheType& t=Both) const
+    {
+        return counts(t).m_misses;
+    }
+
+    // misses that were not cached because the admission policy preferred
+    // the victim
+    long rejectedCount(const CacheType& t=Both) const
+    {
+        return counts(t).m_rejected;
     }
 
-    friend std::ostream& operator << (std::ostream& os, const Cache& cache)
+    // lookups converted directly, without the cache, see bypass_policies.h
+    long bypassedCount(const CacheType& t=Both) const
     {
+        return counts(t).m_bypassed;
+    }
+
+    // whether t's lookups are bypassed at the moment
+    bool bypassing(const CacheType& t) const
+    {
+        const auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        return t == String2Real ? cache.m_realsBypass.bypassing()
+            : cache.m_stringsBypass.bypassing();
+    }
+
+    friend std::ostream& operator << (std::ostream& os, const Cache& self)
+    {
+        const auto& cache = lock_policy::select(self);
+        Guard lock(cache.m_mutex);
+
         os << "Real cached: \n";
-        for (const auto& r : cache.m_reals) {
-            os << "real: " << r.m_real
-               << ", timestamp: " << r.m_time 
-               << ", string: \"" << r.m_str << "\""
+        for (int i = 0; i < cache_size_N; ++i) {
+            os << "real: " << cache.m_reals[i].m_real
+               << ", string: \"" << cache.m_reals.str(i) << "\""
                << "\n";
         }
         os << "String2Real index: \n";
-        for (const auto& r : cache.m_strToReal) {
-            os << "string: \"" << r.first << "\""
-               << ", index: " << r.second
+        cache.m_strToReal.forEach([&os](std::string_view str, int index) {
+            os << "string: \"" << str << "\""
+               << ", index: " << index
                << "\n";
-        }
+        });
         os << "String cached: \n";
-        for (const auto& r : cache.m_strings) {
-            os << "real: " << r.m_real
-               << ", timestamp: " << r.m_time 
-               << ", string: \"" << r.m_str << "\""
+        for (int i = 0; i < cache_size_N; ++i) {
+            os << "real: " << cache.m_strings[i].m_real
+               << ", string: \"" << cache.m_strings.str(i) << "\""
                << "\n";
         }
-        os << "String2Real index: \n";
-        for (const auto& r : cache.m_realToStr) {
-            os << "real: \"" << r.first << "\""
-               << ", index: " << r.second
+        os << "Real2String index: \n";
+        cache.m_realToStr.forEach(
+                [&os](long long bucket, const real_type& real, int index) {
+            os << "real: \"" << real << "\""
+               << ", bucket: " << bucket
+               << ", index: " << index
                << "\n";
-        }
-        if (cache.m_enableStats) {
-            os << "cache miss ratio: " << cache.missRatio()
-               << "%\n";
+        });
+        if (StatsState::enabled) {
+            const auto stats = cache.statsUnlocked();
+            printStats(os, "String2Real", stats.m_strToReal);
+            printStats(os, "Real2String", stats.m_realToStr);
         }
         return os;
     }
 
 protected:
+    using Guard = std::lock_guard<typename lock_policy::mutex_type>;
+
+    CastResult<real_type> lookupReal(std::string_view str);
+    void clearUnlocked(const CacheType& t);
+    // entries are in eviction order, the last ones are kept
+    void loadEntries(
+            const std::vector<detail::SnapshotEntry<real_type>>& reals,
+            const std::vector<detail::SnapshotEntry<real_type>>& strings);
+    template <typename format_type>
+    const char* lookupStr(const real_type& real, const format_type& format);
+
+    // the keys of a batch are hashed on the stack, BatchSize at a time
+    static constexpr int BatchSize = 64;
+
+    // returns the number of errors
+    int lookupRealBatch(const std::string_view* strs, int count,
+            real_type* out, ParseError* errors);
+    template <typename format_type>
+    void lookupStrBatch(const real_type* reals, int count, std::string* out,
+            const format_type& format);
+
+    // slot of the string of real in format, -1 if none
+    template <typename format_type>
+    int findStr(const real_type& real, const format_type& format) const
+    {
+        const uint8_t key = format.key();
+        return m_realToStr.find(real, [this, key](int slot) {
+                return m_strings[slot].m_format == key;
+            });
+    }
+
+    CacheStats statsUnlocked() const
+    {
+        CacheStats stats;
+        stats.m_strToReal = m_realsStats.snapshot();
+        stats.m_realToStr = m_stringsStats.snapshot();
+        return stats;
+    }
+
+    // t's counters, without copying the latency histograms
+    DirectionCounts counts(const CacheType& t) const
+    {
+        const auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        DirectionCounts counts;
+        if (t != Real2String) {
+            counts.merge(cache.m_realsStats.counts());
+        }
+        if (t != String2Real) {
+            counts.merge(cache.m_stringsStats.counts());
+        }
+        return counts;
+    }
+
+    static void printStats(std::ostream& os, const char* direction,
+            const DirectionStats& stats)
+    {
+        os << direction << " miss ratio: " << stats.missRatio() << "%"
+           << ", hits: " << stats.m_hits
+           << ", misses: " << stats.m_misses
+           << ", inserts: " << stats.m_inserts
+           << ", evictions: " << stats.m_evictions;
+        if (AdmissionState::enabled) {
+            os << ", admissions rejected: " << stats.m_rejected;
+        }
+        if (BypassState::enabled) {
+            os << ", bypassed: " << stats.m_bypassed;
+        }
+        if (StatsState::timed) {
+            os << ", hit p50/p99: "
+               << stats.m_hitLatency.percentile(0.5) << "/"
+               << stats.m_hitLatency.percentile(0.99)
+               << " ticks, miss p50/p99: "
+               << stats.m_missLatency.percentile(0.5) << "/"
+               << stats.m_missLatency.percentile(0.99) << " ticks";
+        }
+        os << "\n";
+    }
+
+    // ticks since start if stats_policy times lookups, -1 otherwise
+    static int64_t ticksSince(uint64_t start)
+    {
+        return StatsState::timed
+            ? static_cast<int64_t>(detail::readTicks() - start) : -1;
+    }
+
+    // the conversions of a miss or a bypassed lookup, timed when the bypass
+    // policy asks for it
+    CastResult<real_type> convertReal(std::string_view str, bool timed);
+    template <typename format_type>
+    void convertStr(int index, const real_type& real,
+            const format_type& format, bool timed);
+    template <typename format_type>
+    const char* bypassStr(const real_type& real, const format_type& format);
+
     // only called when str is not in internal cache
-    real_type updateStrCache(const std::string& str); //370ns
-    const char* updateRealCache(const real_type& fp); //600ns
+    CastResult<real_type> updateStrCache(std::string_view str); //370ns with std::stod
+    // item's real, or its error if it's a negative entry
+    static CastResult<real_type> result(const CachedItem& item)
+    {
+        return CastResult<real_type>(item.m_real, item.error());
+    }
+    template <typename format_type>
+    const char* updateRealCache(const real_type& fp,
+            const format_type& format); //600ns with to_string
 
 private:
-    using ValueCache = std::array<CachedItem, cache_size_N>;
+    // CachedItems and their overflow arena: a string per slot, which keeps
+    // its capacity when the slot is reused, so once warmed up long strings
+    // don't allocate either
+    class ValueCache
+    {
+    public:
+        const CachedItem& operator[](int index) const
+        {
+            return m_items[index];
+        }
+
+        const char* str(int index) const
+        {
+            const auto& item = m_items[index];
+            return item.m_length == CachedItem::Overflow
+                ? m_overflow[index].c_str() : item.m_str;
+        }
+
+        void prefetch(int index) const
+        {
+            __builtin_prefetch(&m_items[index]);
+        }
+
+        std::string_view view(int index) const
+        {
+            const auto& item = m_items[index];
+            return item.m_length == CachedItem::Overflow
+                ? std::string_view(m_overflow[index])
+                : std::string_view(item.m_str, item.m_length);
+        }
+
+        void assign(int index, std::string_view str, const real_type& real,
+                uint8_t format=0, uint8_t error=0)
+        {
+            auto& item = m_items[index];
+            item.m_real = real;
+            item.m_format = format;
+            item.m_error = error;
+            if (str.size() < inline_str_K) {
+                memcpy(item.m_str, str.data(), str.size());
+                item.m_str[str.size()] = '\0';
+                item.m_length = str.size();
+            }
+            else {
+                m_overflow[index].assign(str);
+                item.m_length = CachedItem::Overflow;
+            }
+        }
+
+        // formats real straight into the slot, no temporary string
+        template <typename format_type>
+        void assign(int index, const real_type& real,
+                const format_type& format)
+        {
+            auto& item = m_items[index];
+            item.m_real = real;
+            item.m_format = format.key();
+            item.m_error = 0;
+            const int n = format.format(real, item.m_str, inline_str_K);
+            if (n < inline_str_K) {
+                item.m_length = n;
+            }
+            else {
+                realToString(real, m_overflow[index], format);
+                item.m_length = CachedItem::Overflow;
+            }
+        }
+
+        void clear()
+        {
+            m_items.fill(CachedItem());
+        }
+
+    private:
+        std::array<CachedItem, cache_size_N>  m_items;
+        std::array<std::string, cache_size_N> m_overflow;
+    };
+
+    using EvictionState =
+        typename eviction_policy::template State<cache_size_N>;
+    using AdmissionState =
+        typename admission_policy::template State<cache_size_N>;
+    using BypassState = typename bypass_policy::State;
+    using StatsState = typename stats_policy::State;
+    using StrIndex =
+        typename index_policy::template StrIndex<cache_size_N>;
+    using RealIndex =
+        typename index_policy::template RealIndex<real_type, cache_size_N>;
 
     ValueCache                            m_reals;
     ValueCache                            m_strings;
+    EvictionState                         m_realsEviction;
+    EvictionState                         m_stringsEviction;
+    AdmissionState                        m_realsAdmission;
+    AdmissionState                        m_stringsAdmission;
+    BypassState                           m_realsBypass;
+    BypassState                           m_stringsBypass;
+    StatsState                            m_realsStats;
+    StatsState                            m_stringsStats;
+    // castToStr result when the admission policy doesn't cache it, or when
+    // it's bypassed
+    std::string                           m_rejected;
 
-    // test shows searching in unordered map is faster than a sorted array
-    std::unordered_map<const char*, int,
-        CstrHash, CstrHash>               m_strToReal;
-    std::unordered_map<real_type, int>    m_realToStr;
+    StrIndex                              m_strToReal;
+    // reals are matched with a tolerance, see UlpBucketIndex
+    RealIndex                             m_realToStr;
 
-    timestamp_type                        m_latestTime = 100;
-    bool                                  m_enableStats = true;
-    long                                  m_cacheHit = 0;
-    long                                  m_cacheMiss = 0;
+    mutable typename lock_policy::mutex_type m_mutex;
+    // ThreadLocal keeps the object's instances in m_mutex
+    friend lock_policy;
 };
 
 template <
     typename real_type,
     int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
     typename enable
     >
 real_type
-Cache<real_type, cache_size_N, enable>::castToReal(const std::string& str)
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::castToReal(std::string_view str)
+{
+    // the exception is only built here, after the lock is released
+    return tryCastToReal(str).value();
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+CastResult<real_type>
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::tryCastToReal(std::string_view str)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    return cache.lookupReal(str);
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+const char*
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::castToStr(const real_type& real)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    if (!lock_policy::copy_result) {
+        return cache.lookupStr(real, format_policy());
+    }
+
+    static thread_local std::string result;
+    result.assign(cache.lookupStr(real, format_policy()));
+    return result.c_str();
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+const char*
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::castToStr(const real_type& real, const RealFormat& format)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    if (!lock_policy::copy_result) {
+        return cache.lookupStr(real, format);
+    }
+
+    static thread_local std::string result;
+    result.assign(cache.lookupStr(real, format));
+    return result.c_str();
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+void
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::castToRealBatch(const std::string_view* strs, size_t count, real_type* out)
+{
+    auto& cache = lock_policy::select(*this);
+    ParseError error = ParseError::None;
+    {
+        Guard lock(cache.m_mutex);
+        ParseError errors[BatchSize];
+        for (size_t first = 0; first < count; first += BatchSize) {
+            const size_t left = count - first;
+            const int n = left < BatchSize ? static_cast<int>(left) : BatchSize;
+            if (cache.lookupRealBatch(strs + first, n, out + first, errors) > 0
+                    && error == ParseError::None) {
+                error = *std::find_if(errors, errors + n, [](ParseError e) {
+                        return e != ParseError::None;
+                    });
+            }
+        }
+    }
+    if (error != ParseError::None) {
+        throwParseError(error);
+    }
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+size_t
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::tryCastToRealBatch(const std::string_view* strs, size_t count, real_type* out, ParseError* errors)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    size_t failures = 0;
+    for (size_t first = 0; first < count; first += BatchSize) {
+        const size_t left = count - first;
+        failures += cache.lookupRealBatch(strs + first,
+                left < BatchSize ? static_cast<int>(left) : BatchSize,
+                out + first, errors + first);
+    }
+    return failures;
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+void
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::castToStrBatch(const real_type* reals, size_t count, std::string* out)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    for (size_t first = 0; first < count; first += BatchSize) {
+        const size_t left = count - first;
+        cache.lookupStrBatch(reals + first,
+                left < BatchSize ? static_cast<int>(left) : BatchSize,
+                out + first, format_policy());
+    }
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+void
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::castToStrBatch(const real_type* reals, size_t count, std::string* out, const RealFormat& format)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    for (size_t first = 0; first < count; first += BatchSize) {
+        const size_t left = count - first;
+        cache.lookupStrBatch(reals + first,
+                left < BatchSize ? static_cast<int>(left) : BatchSize,
+                out + first, format);
+    }
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+CastResult<real_type>
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::lookupReal(std::string_view str)
 {
-    // not much advantage compared with stod, even with 100% cache hit, which
-    // means I need a faster hash map
     // need to test with boost::lexical_cast
-    auto existing = m_strToReal.find(str.c_str());
-    if (existing != m_strToReal.end()) {
-        ++m_cacheHit;
-        return m_reals[existing->second].m_real;
+    int64_t start = -1;
+    if (BypassState::enabled) {
+        if (m_realsBypass.bypass()) {
+            m_realsStats.recordBypassed();
+            return convertReal(str, m_realsBypass.timed());
+        }
+        if (m_realsBypass.timed()) {
+            start = detail::nowNs();
+        }
+    }
+    const uint64_t ticks = StatsState::timed ? detail::readTicks() : 0;
+
+    if (AdmissionState::enabled) {
+        m_realsAdmission.record(CstrHash()(str));
+    }
+
+    auto existing = m_strToReal.find(str);
+    if (existing >= 0) {
+        m_realsEviction.touch(existing);
+        const auto real = result(m_reals[existing]);
+        m_realsStats.recordHit(ticksSince(ticks));
+        if (BypassState::enabled) {
+            m_realsBypass.recordHit(start < 0 ? -1 : detail::nowNs() - start);
+        }
+        return real;
+    }
+
+    const auto real = this->updateStrCache(str);
+    m_realsStats.recordMiss(ticksSince(ticks));
+    if (BypassState::enabled) {
+        m_realsBypass.recordMiss(start < 0 ? -1 : detail::nowNs() - start);
+    }
+    return real;
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+CastResult<real_type>
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::convertReal(std::string_view str, bool timed)
+{
+    real_type real{};
+    if (!BypassState::enabled || !timed) {
+        const ParseError error = tryStringToReal(str, real);
+        return CastResult<real_type>(real, error);
+    }
+    const auto start = detail::nowNs();
+    const ParseError error = tryStringToReal(str, real);
+    m_realsBypass.recordConversion(detail::nowNs() - start);
+    return CastResult<real_type>(real, error);
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+template <typename format_type>
+void
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::convertStr(int index, const real_type& real, const format_type& format, bool timed)
+{
+    if (!BypassState::enabled || !timed) {
+        m_strings.assign(index, real, format);
+        return;
     }
+    const auto start = detail::nowNs();
+    m_strings.assign(index, real, format);
+    m_stringsBypass.recordConversion(detail::nowNs() - start);
+}
 
-    return this->updateStrCache(str);
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+template <typename format_type>
+const char*
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::bypassStr(const real_type& real, const format_type& format)
+{
+    m_stringsStats.recordBypassed();
+    if (!m_stringsBypass.timed()) {
+        realToString(real, m_rejected, format);
+        return m_rejected.c_str();
+    }
+    const auto start = detail::nowNs();
+    realToString(real, m_rejected, format);
+    m_stringsBypass.recordConversion(detail::nowNs() - start);
+    return m_rejected.c_str();
 }
 
 template <
     typename real_type,
     int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
     typename enable
     >
+template <typename format_type>
 const char*
-Cache<real_type, cache_size_N, enable>::castToStr(const real_type& real)
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::lookupStr(const real_type& real, const format_type& format)
 {
-    auto existing = std::find_if(m_realToStr.begin(), m_realToStr.end(),
-            [&real](const auto& item) {
-                return useful::almostEqual(item.first, real);
-            });
-    if (existing != m_realToStr.end()) {
-        ++m_cacheHit;
-        return m_strings[existing->second].m_str.c_str();
+    int64_t start = -1;
+    if (BypassState::enabled) {
+        if (m_stringsBypass.bypass()) {
+            return bypassStr(real, format);
+        }
+        if (m_stringsBypass.timed()) {
+            start = detail::nowNs();
+        }
+    }
+    const uint64_t ticks = StatsState::timed ? detail::readTicks() : 0;
+
+    if (AdmissionState::enabled) {
+        m_stringsAdmission.record(m_realToStr.bucketOf(real));
+    }
+
+    auto existing = findStr(real, format);
+    if (existing >= 0) {
+        m_stringsEviction.touch(existing);
+        const char* str = m_strings.str(existing);
+        m_stringsStats.recordHit(ticksSince(ticks));
+        if (BypassState::enabled) {
+            m_stringsBypass.recordHit(
+                    start < 0 ? -1 : detail::nowNs() - start);
+        }
+        return str;
     }
 
-    return this->updateRealCache(real);
+    const char* str = this->updateRealCache(real, format);
+    m_stringsStats.recordMiss(ticksSince(ticks));
+    if (BypassState::enabled) {
+        m_stringsBypass.recordMiss(start < 0 ? -1 : detail::nowNs() - start);
+    }
+    return str;
 }
 
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+int
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::lookupRealBatch(const std::string_view* strs, int count, real_type* out, ParseError* errors)
+{
+    int failures = 0;
+    const auto store = [out, errors, &failures](int i,
+            const CastResult<real_type>& result) {
+        out[i] = result.valueOr(std::numeric_limits<real_type>::quiet_NaN());
+        errors[i] = result.error();
+        failures += !result.hasValue();
+    };
+
+    // the bypass policy decides per key, but can't time a key of a batch,
+    // it only gets the conversions of misses
+    constexpr int Bypassed = -2;
+    int slots[BatchSize];
+    uint64_t hashes[BatchSize];
+    for (int i = 0; i < count; ++i) {
+        if (BypassState::enabled && m_realsBypass.bypass()) {
+            m_realsStats.recordBypassed();
+            store(i, convertReal(strs[i], m_realsBypass.timed()));
+            slots[i] = Bypassed;
+            continue;
+        }
+        hashes[i] = m_strToReal.hash(strs[i]);
+        m_strToReal.prefetch(hashes[i]);
+        slots[i] = -1;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (slots[i] == Bypassed) {
+            continue;
+        }
+        slots[i] = m_strToReal.find(strs[i], hashes[i]);
+        if (slots[i] >= 0) {
+            m_reals.prefetch(slots[i]);
+        }
+    }
+
+    int misses[BatchSize];
+    int missCount = 0;
+    for (int i = 0; i < count; ++i) {
+        if (slots[i] == Bypassed) {
+            continue;
+        }
+        if (AdmissionState::enabled) {
+            m_realsAdmission.record(CstrHash()(strs[i]));
+        }
+        if (slots[i] >= 0) {
+            m_realsStats.recordHit();
+            m_realsEviction.touch(slots[i]);
+            m_realsBypass.recordHit();
+            store(i, result(m_reals[slots[i]]));
+        }
+        else {
+            misses[missCount++] = i;
+        }
+    }
+
+    for (int j = 0; j < missCount; ++j) {
+        const int i = misses[j];
+        // an earlier miss of the batch may have cached the same string
+        auto existing = j > 0 ? m_strToReal.find(strs[i], hashes[i]) : -1;
+        if (existing >= 0) {
+            m_realsStats.recordHit();
+            m_realsEviction.touch(existing);
+            m_realsBypass.recordHit();
+            store(i, result(m_reals[existing]));
+        }
+        else {
+            store(i, this->updateStrCache(strs[i]));
+            m_realsStats.recordMiss();
+            m_realsBypass.recordMiss();
+        }
+    }
+    return failures;
+}
 
 template <
     typename real_type,
     int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
     typename enable
     >
-real_type
-Cache<real_type, cache_size_N, enable>::updateStrCache(const std::string& str)
+template <typename format_type>
+void
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::lookupStrBatch(const real_type* reals, int count, std::string* out, const format_type& format)
+{
+    constexpr int Bypassed = -2;
+    int slots[BatchSize];
+    for (int i = 0; i < count; ++i) {
+        if (BypassState::enabled && m_stringsBypass.bypass()) {
+            out[i].assign(bypassStr(reals[i], format));
+            slots[i] = Bypassed;
+            continue;
+        }
+        m_realToStr.prefetch(reals[i]);
+        slots[i] = -1;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (slots[i] == Bypassed) {
+            continue;
+        }
+        slots[i] = findStr(reals[i], format);
+        if (slots[i] >= 0) {
+            m_strings.prefetch(slots[i]);
+        }
+    }
+
+    int misses[BatchSize];
+    int missCount = 0;
+    for (int i = 0; i < count; ++i) {
+        if (slots[i] == Bypassed) {
+            continue;
+        }
+        if (AdmissionState::enabled) {
+            m_stringsAdmission.record(m_realToStr.bucketOf(reals[i]));
+        }
+        if (slots[i] >= 0) {
+            m_stringsStats.recordHit();
+            m_stringsEviction.touch(slots[i]);
+            m_stringsBypass.recordHit();
+            out[i].assign(m_strings.view(slots[i]));
+        }
+        else {
+            misses[missCount++] = i;
+        }
+    }
+
+    for (int j = 0; j < missCount; ++j) {
+        const int i = misses[j];
+        // an earlier miss of the batch may have cached an almost equal real
+        auto existing = j > 0 ? findStr(reals[i], format) : -1;
+        if (existing >= 0) {
+            m_stringsStats.recordHit();
+            m_stringsEviction.touch(existing);
+            m_stringsBypass.recordHit();
+            out[i].assign(m_strings.view(existing));
+        }
+        else {
+            out[i].assign(this->updateRealCache(reals[i], format));
+            m_stringsStats.recordMiss();
+            m_stringsBypass.recordMiss();
+        }
+    }
+}
+
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+CastResult<real_type>
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::updateStrCache(std::string_view str)
 {
-    ++m_cacheMiss;
+    // if str isn't a number it's cached too, with the error
+    const auto fp = convertReal(str, m_realsBypass.timedConversion());
 
     auto index = 0;
-    if (m_strToReal.size() >= cache_size_N) {
-        auto oldest = std::min_element(
-                m_reals.begin(),
-                m_reals.end(),
-                [](const auto& lhs, const auto& rhs) {
-                    return lhs.m_time < rhs.m_time; }
-                );
-        assert(oldest != m_reals.end());
-        
-        index = oldest - m_reals.begin();
-        m_strToReal.erase(oldest->m_str.c_str());
+    const bool replaced = m_strToReal.size() >= cache_size_N;
+    if (replaced) {
+        index = m_realsEviction.victim();
+        if (AdmissionState::enabled && !m_realsAdmission.admit(
+                    CstrHash()(str),
+                    CstrHash()(m_reals.view(index)))) {
+            m_realsStats.recordRejected();
+            return fp;
+        }
+        m_strToReal.erase(m_reals.view(index), index);
+        m_realsStats.recordEviction();
     }
     else {
         index = m_strToReal.size();
     }
 
-    real_type fp(0.0);
-    if (std::is_same<float,
-            typename std::remove_cv<real_type>::type>::value) {
-        fp = std::stof(str);
-    }
-    else if (std::is_same<double,
-            typename std::remove_cv<real_type>::type>::value) {
-        fp = std::stod(str);
+    m_reals.assign(index, str, *fp, 0, static_cast<uint8_t>(fp.error()));
+    if (replaced) {
+        m_realsEviction.replace(index);
     }
     else {
-        fp = std::stold(str);
+        m_realsEviction.insert(index);
     }
 
-    m_reals[index].m_str = str;
-    m_reals[index].m_real = fp;
-    m_reals[index].m_time = updateTimestamp(m_latestTime);
-
-    m_strToReal.emplace(
-            m_reals[index].m_str.c_str(), index
-            );
+    m_strToReal.insert(m_reals.view(index), index);
+    m_realsStats.recordInsert();
 
     return fp;
 }
@@ -304,90 +1267,323 @@ Cache<real_type, cache_size_N, enable>::updateStrCache(const std::string& str)
 template <
     typename real_type,
     int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
     typename enable
     >
+template <typename format_type>
 const char*
-Cache<real_type, cache_size_N, enable>::updateRealCache(const real_type& fp)
+Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::updateRealCache(const real_type& fp, const format_type& format)
 {
-    ++m_cacheMiss;
-
     auto index = 0;
-    if (m_realToStr.size() >= cache_size_N) {
-        auto oldest = std::min_element(
-                m_strings.begin(),
-                m_strings.end(),
-                [](const auto& lhs, const auto& rhs) {
-                    return lhs.m_time < rhs.m_time; }
-                );
-        
-        index = oldest - m_strings.begin();
-        m_realToStr.erase(oldest->m_real);
+    const bool replaced = m_realToStr.size() >= cache_size_N;
+    if (replaced) {
+        index = m_stringsEviction.victim();
+        if (AdmissionState::enabled && !m_stringsAdmission.admit(
+                    m_realToStr.bucketOf(fp),
+                    m_realToStr.bucketOf(m_strings[index].m_real))) {
+            m_stringsStats.recordRejected();
+            realToString(fp, m_rejected, format);
+            return m_rejected.c_str();
+        }
+        m_realToStr.erase(m_strings[index].m_real, index);
+        m_stringsStats.recordEviction();
     }
     else {
         index = m_realToStr.size();
     }
 
-    m_strings[index].m_str = std::to_string(fp);
-    m_strings[index].m_real = fp;
-    m_strings[index].m_time = updateTimestamp(m_latestTime);
+    convertStr(index, fp, format, m_stringsBypass.timedConversion());
+    if (replaced) {
+        m_stringsEviction.replace(index);
+    }
+    else {
+        m_stringsEviction.insert(index);
+    }
 
-    m_realToStr.emplace(fp, index);
+    m_realToStr.insert(fp, index);
+    m_stringsStats.recordInsert();
 
-    return m_strings[index].m_str.c_str();
+    return m_strings.str(index);
 }
 
 
 template <
     typename real_type,
     int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
     typename enable
     >
-size_t Cache<real_type, cache_size_N, enable>::size(const CacheType& t) const
+size_t Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::size(const CacheType& t) const
 {
+    const auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+
     if (t == String2Real) {
-        return m_strToReal.size();
+        return cache.m_strToReal.size();
     }
     else if (t == Real2String) {
-        return m_realToStr.size();
+        return cache.m_realToStr.size();
     }
     else {
-        return m_strToReal.size() + m_realToStr.size();
+        return cache.m_strToReal.size() + cache.m_realToStr.size();
     }
 }
 
 template <
     typename real_type,
     int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
     typename enable
     >
-bool Cache<real_type, cache_size_N, enable>::empty(const CacheType& t) const
+bool Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::empty(const CacheType& t) const
 {
+    const auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+
     if (t == String2Real) {
-        return m_strToReal.empty();
+        return cache.m_strToReal.empty();
     }
     else if (t == Real2String) {
-        return m_realToStr.empty();
+        return cache.m_realToStr.empty();
     }
     else {
-        return m_strToReal.empty() && m_realToStr.empty();
+        return cache.m_strToReal.empty() && cache.m_realToStr.empty();
     }
 }
 
 template <
     typename real_type,
     int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
     typename enable
     >
-void Cache<real_type, cache_size_N, enable>::clear(const CacheType& t)
+void Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::clear(const CacheType& t)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    cache.clearUnlocked(t);
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+void Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::clearUnlocked(const CacheType& t)
 {
     if (t == String2Real || t == Both) {
         m_strToReal.clear();
         m_reals.clear();
+        m_realsEviction.clear();
+        m_realsAdmission.clear();
+        m_realsBypass.clear();
     }
 
     if (t == Real2String || t == Both) {
         m_realToStr.clear();
         m_strings.clear();
+        m_stringsEviction.clear();
+        m_stringsAdmission.clear();
+        m_stringsBypass.clear();
+    }
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+bool Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::saveSnapshot(const std::string& path) const
+{
+    const std::string tmp = path + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    const bool written = writeSnapshot(fp);
+    if (fclose(fp) != 0 || !written
+            || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+bool Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::loadSnapshot(const std::string& path)
+{
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    const bool loaded = readSnapshot(fp);
+    fclose(fp);
+    return loaded;
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+template <typename OUTPUT>
+bool Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::writeSnapshot(OUTPUT* fp) const
+{
+    const auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+
+    detail::ChecksumStream<OUTPUT> out(fp);
+    if (!detail::writeSnapshotHeader<real_type>(&out)
+            || !detail::writeSnapshotEntries<real_type>(&out, cache.m_reals,
+                cache.m_realsEviction, cache.m_strToReal.size())
+            || !detail::writeSnapshotEntries<real_type>(&out, cache.m_strings,
+                cache.m_stringsEviction, cache.m_realToStr.size())) {
+        return false;
+    }
+    return google::sparsehash_internal::write_bigendian_number(
+            fp, out.checksum(), 8);
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+template <typename INPUT>
+bool Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::readSnapshot(INPUT* fp)
+{
+    // all of it is read and checked before the cache is touched
+    detail::ChecksumStream<INPUT> in(fp);
+    std::vector<detail::SnapshotEntry<real_type>> reals;
+    std::vector<detail::SnapshotEntry<real_type>> strings;
+    if (!detail::readSnapshotHeader<real_type>(&in)
+            || !detail::readSnapshotEntries(&in, reals)
+            || !detail::readSnapshotEntries(&in, strings)) {
+        return false;
+    }
+    uint64_t checksum;
+    if (!google::sparsehash_internal::read_bigendian_number(
+                fp, &checksum, 8) || checksum != in.checksum()) {
+        return false;
+    }
+
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    cache.loadEntries(reals, strings);
+    return true;
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    typename lock_policy,
+    typename eviction_policy,
+    typename admission_policy,
+    int inline_str_K,
+    typename index_policy,
+    typename format_policy,
+    typename bypass_policy,
+    typename stats_policy,
+    typename enable
+    >
+void Cache<real_type, cache_size_N, lock_policy, eviction_policy, admission_policy, inline_str_K, index_policy, format_policy, bypass_policy, stats_policy, enable>::loadEntries(
+        const std::vector<detail::SnapshotEntry<real_type>>& reals,
+        const std::vector<detail::SnapshotEntry<real_type>>& strings)
+{
+    clearUnlocked(Both);
+
+    // slot i holds the i-th kept entry, the eviction policy sees them
+    // oldest first, as they were saved
+    const size_t firstReal = reals.size() > cache_size_N
+        ? reals.size() - cache_size_N : 0;
+    for (size_t i = firstReal; i < reals.size(); ++i) {
+        const int index = static_cast<int>(i - firstReal);
+        m_reals.assign(index, reals[i].m_str, reals[i].m_real,
+                reals[i].m_format, reals[i].m_error);
+        m_realsEviction.insert(index);
+        m_strToReal.insert(m_reals.view(index), index);
+    }
+
+    const size_t firstString = strings.size() > cache_size_N
+        ? strings.size() - cache_size_N : 0;
+    for (size_t i = firstString; i < strings.size(); ++i) {
+        const int index = static_cast<int>(i - firstString);
+        m_strings.assign(index, strings[i].m_str, strings[i].m_real,
+                strings[i].m_format, strings[i].m_error);
+        m_stringsEviction.insert(index);
+        m_realToStr.insert(strings[i].m_real, index);
     }
 }
 
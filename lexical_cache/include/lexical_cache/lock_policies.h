@@ -0,0 +1,197 @@
+#ifndef LEXICAL_CACHE_LOCK_POLICIES_H_INCLUDED
+#define LEXICAL_CACHE_LOCK_POLICIES_H_INCLUDED
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// thread safety policies of Cache, each one provides:
+//
+// - mutex_type: locked around every call, must be a BasicLockable
+// - select(cache): the Cache instance a call operates on
+// - copy_result: whether castToStr has to copy the string out of the cache
+//   before unlocking, because another thread may evict it afterwards
+namespace lexical_cache
+{
+
+// single threaded use, costs nothing
+struct NoLock
+{
+    struct mutex_type
+    {
+        void lock() {}
+        void unlock() {}
+    };
+
+    static constexpr bool copy_result = false;
+
+    template <typename cache_type>
+    static cache_type& select(cache_type& cache)
+    {
+        return cache;
+    }
+};
+
+struct MutexLock
+{
+    using mutex_type = std::mutex;
+
+    static constexpr bool copy_result = true;
+
+    template <typename cache_type>
+    static cache_type& select(cache_type& cache)
+    {
+        return cache;
+    }
+};
+
+// test and test-and-set, only spins on a read so waiting threads don't
+// bounce the cache line between them, yields if the owner seems descheduled
+class SpinMutex
+{
+public:
+    void lock()
+    {
+        while (m_locked.exchange(true, std::memory_order_acquire)) {
+            int spins = 0;
+            while (m_locked.load(std::memory_order_relaxed)) {
+                if (++spins < MaxSpins) {
+                    pause();
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+
+    bool try_lock()
+    {
+        return !m_locked.load(std::memory_order_relaxed)
+            && !m_locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock()
+    {
+        m_locked.store(false, std::memory_order_release);
+    }
+
+private:
+    static constexpr int MaxSpins = 64;
+
+    static void pause()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+    std::atomic<bool>                     m_locked{false};
+};
+
+struct SpinLock
+{
+    using mutex_type = SpinMutex;
+
+    static constexpr bool copy_result = true;
+
+    template <typename cache_type>
+    static cache_type& select(cache_type& cache)
+    {
+        return cache;
+    }
+};
+
+// every thread transparently works on its own instance of each Cache
+// object, so no locking is needed. size(), stats etc. are those of the
+// calling thread's instance. an instance starts as a copy of the object,
+// which never holds entries itself, i.e. empty, with the configuration it
+// was constructed with. the object owns its instances, they live until
+// it's destroyed rather than until their thread exits
+struct ThreadLocal
+{
+    // locks nothing, it's where the object keeps its threads' instances
+    class mutex_type
+    {
+    public:
+        mutex_type()
+            : m_id(nextId())
+        {
+        }
+
+        // a copy is another object, without instances yet
+        mutex_type(const mutex_type&)
+            : mutex_type()
+        {
+        }
+
+        mutex_type& operator = (const mutex_type&) { return *this; }
+
+        void lock() {}
+        void unlock() {}
+
+    private:
+        friend struct ThreadLocal;
+
+        static uint64_t nextId()
+        {
+            static std::atomic<uint64_t> next{1};
+            return next.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // never reused, unlike the object's address
+        const uint64_t                    m_id;
+        // only taken on a thread's first call
+        std::mutex                        m_instancesMutex;
+        std::vector<std::shared_ptr<void>> m_instances;
+    };
+
+    static constexpr bool copy_result = false;
+
+    template <typename cache_type>
+    static cache_type& select(cache_type& cache)
+    {
+        using instance_type = typename std::remove_const<cache_type>::type;
+        // const and non const callers must get the same instance
+        return instance<instance_type>(cache, cache.m_mutex);
+    }
+
+private:
+    template <typename cache_type>
+    static cache_type& instance(const cache_type& cache, mutex_type& owner)
+    {
+        // a thread mostly works on one object, the map is only searched
+        // when it changes. the entries of destroyed objects stay, but as
+        // ids aren't reused they are never found again
+        static thread_local uint64_t lastId = 0;
+        static thread_local cache_type* last = nullptr;
+        static thread_local std::unordered_map<uint64_t, cache_type*> local;
+        if (lastId == owner.m_id) {
+            return *last;
+        }
+
+        auto& slot = local[owner.m_id];
+        if (slot == nullptr) {
+            auto created = std::make_shared<cache_type>(cache);
+            std::lock_guard<std::mutex> lock(owner.m_instancesMutex);
+            owner.m_instances.push_back(created);
+            slot = created.get();
+        }
+        lastId = owner.m_id;
+        last = slot;
+        return *slot;
+    }
+};
+
+}
+
+#endif
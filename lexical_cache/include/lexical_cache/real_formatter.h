@@ -0,0 +1,652 @@
+#ifndef LEXICAL_CACHE_REAL_FORMATTER_H_INCLUDED
+#define LEXICAL_CACHE_REAL_FORMATTER_H_INCLUDED
+
+#include "real_parser.h"
+#include "ryu_table.h"
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <type_traits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// locale independent real -> string conversion, the shortest string that
+// parses back to the same real.
+//
+// the digits come from Ryu ("Ryu: Fast Float-to-String Conversion", Adams
+// 2018): the interval of decimals rounding to the real is computed with 128
+// bit multiplications by tabulated powers of 5 (see ryu_table.h), then digits
+// are dropped while both ends of the interval still differ. float and double
+// share the double tables. the layout is std::to_chars' without a format:
+// fixed or scientific, whichever is shorter, fixed on a tie. long double goes
+// to std::to_chars.
+//
+// formatPlain writes the same digits, always in fixed notation. formatFixed
+// writes a given number of decimals like printf's "%.*f", from the real
+// scaled to an integer, written two digits at a time. integers are written
+// two digits at a time too, with zeros for decimals
+namespace lexical_cache
+{
+
+namespace detail
+{
+
+// a real as m_digits * 10^m_exponent
+struct DecimalReal
+{
+    uint64_t m_digits;
+    int m_exponent;
+};
+
+// ceil(log2(5^e)), 1 for e == 0
+inline int pow5Bits(int e)
+{
+    return ((e * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e))
+inline int log10Pow2(int e)
+{
+    return (e * 78913) >> 18;
+}
+
+// floor(log10(5^e))
+inline int log10Pow5(int e)
+{
+    return (e * 732923) >> 20;
+}
+
+// value != 0
+inline bool multipleOfPow5(uint64_t value, int p)
+{
+    int count = 0;
+    for (; value % 5 == 0; value /= 5) {
+        ++count;
+    }
+    return count >= p;
+}
+
+inline bool multipleOfPow2(uint64_t value, int p)
+{
+    return (value & ((1ull << p) - 1)) == 0;
+}
+
+// (m * mul) >> j, mul a {high, low} table entry, j >= 64
+inline uint64_t mulShift(uint64_t m, const uint64_t* mul, int j)
+{
+    const auto high = static_cast<unsigned __int128>(m) * mul[0];
+    const auto low = static_cast<unsigned __int128>(m) * mul[1];
+    return static_cast<uint64_t>(((low >> 64) + high) >> (j - 64));
+}
+
+// the shortest decimal in the rounding interval of the finite, non zero real
+// with these biased exponent and mantissa bits, the closest one if there are
+// several
+template <typename real_type>
+DecimalReal shortestDecimal(uint64_t mantissa, int power2)
+{
+    using Format = BinaryFormat<real_type>;
+    constexpr int MantissaBits = Format::MantissaBits;
+    constexpr int Bias = -Format::MinExponent;
+
+    // the real is m2 * 2^e2, minus 2 so the interval bounds are integers
+    int e2 = 0;
+    uint64_t m2 = 0;
+    if (power2 == 0) {
+        e2 = 1 - Bias - MantissaBits - 2;
+        m2 = mantissa;
+    }
+    else {
+        e2 = power2 - Bias - MantissaBits - 2;
+        m2 = (1ull << MantissaBits) | mantissa;
+    }
+    // round to even: the bounds belong to the interval when m2 is even
+    const bool acceptBounds = (m2 & 1) == 0;
+
+    // the interval is [mv - 1 - mmShift, mv + 2] * 2^e2, closer below at
+    // powers of 2
+    const uint64_t mv = 4 * m2;
+    const int mmShift = mantissa != 0 || power2 <= 1;
+
+    // vr, vp and vm are mv and the bounds times 2^e2 in decimal, shifted to
+    // e10 and truncated
+    uint64_t vr = 0;
+    uint64_t vp = 0;
+    uint64_t vm = 0;
+    int e10 = 0;
+    bool vmTrailingZeros = false;
+    bool vrTrailingZeros = false;
+    if (e2 >= 0) {
+        const int q = log10Pow2(e2) - (e2 > 3);
+        e10 = q;
+        const int k = RyuPow5InvBits + pow5Bits(q) - 1;
+        const int i = -e2 + q + k;
+        const uint64_t* mul = &RyuPow5InvTable[2 * q];
+        vr = mulShift(mv, mul, i);
+        vp = mulShift(mv + 2, mul, i);
+        vm = mulShift(mv - 1 - mmShift, mul, i);
+        // only a multiple of 5^q truncates exactly, and no mantissa is one
+        // above 5^21
+        if (q <= 21) {
+            if (mv % 5 == 0) {
+                vrTrailingZeros = multipleOfPow5(mv, q);
+            }
+            else if (acceptBounds) {
+                vmTrailingZeros = multipleOfPow5(mv - 1 - mmShift, q);
+            }
+            else {
+                vp -= multipleOfPow5(mv + 2, q);
+            }
+        }
+    }
+    else {
+        const int q = log10Pow5(-e2) - (-e2 > 1);
+        e10 = q + e2;
+        const int i = -e2 - q;
+        const int k = pow5Bits(i) - RyuPow5Bits;
+        const int j = q - k;
+        const uint64_t* mul = &RyuPow5Table[2 * i];
+        vr = mulShift(mv, mul, j);
+        vp = mulShift(mv + 2, mul, j);
+        vm = mulShift(mv - 1 - mmShift, mul, j);
+        if (q <= 1) {
+            // mv has at least 2 trailing zero bits, enough for q <= 1
+            vrTrailingZeros = true;
+            if (acceptBounds) {
+                vmTrailingZeros = mmShift == 1;
+            }
+            else {
+                --vp;
+            }
+        }
+        else if (q < 63) {
+            vrTrailingZeros = multipleOfPow2(mv, q);
+        }
+    }
+
+    // drop digits while the interval still holds a shorter decimal
+    int removed = 0;
+    uint64_t digits = 0;
+    if (vmTrailingZeros || vrTrailingZeros) {
+        // rare: the dropped digits may be exact zeros, which matter for the
+        // lower bound and for rounding ties to even
+        int lastRemoved = 0;
+        while (vp / 10 > vm / 10) {
+            vmTrailingZeros &= vm % 10 == 0;
+            vrTrailingZeros &= lastRemoved == 0;
+            lastRemoved = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        if (vmTrailingZeros) {
+            while (vm % 10 == 0) {
+                vrTrailingZeros &= lastRemoved == 0;
+                lastRemoved = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                ++removed;
+            }
+        }
+        if (vrTrailingZeros && lastRemoved == 5 && vr % 2 == 0) {
+            // exactly halfway, round to even
+            lastRemoved = 4;
+        }
+        digits = vr + ((vr == vm && (!acceptBounds || !vmTrailingZeros))
+                || lastRemoved >= 5);
+    }
+    else {
+        bool roundUp = false;
+        if (vp / 100 > vm / 100) {
+            roundUp = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            roundUp = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        digits = vr + (vr == vm || roundUp);
+    }
+
+    return DecimalReal{digits, e10 + removed};
+}
+
+inline constexpr char DigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+inline int decimalLength(uint64_t value)
+{
+    int length = 1;
+    for (uint64_t power = 10; length < 20 && value >= power; power *= 10) {
+        ++length;
+    }
+    return length;
+}
+
+// the decimal digits of value, ending right before end
+inline void writeDigits(uint64_t value, char* end)
+{
+    while (value >= 100) {
+        end -= 2;
+        memcpy(end, &DigitPairs[2 * (value % 100)], 2);
+        value /= 100;
+    }
+    if (value >= 10) {
+        memcpy(end - 2, &DigitPairs[2 * value], 2);
+    }
+    else {
+        end[-1] = static_cast<char>('0' + value);
+    }
+}
+
+// writes the decimal digits of value to buf, returns their count
+inline int writeInteger(unsigned __int128 value, char* buf)
+{
+    constexpr uint64_t Pow10_19 = 10000000000000000000ull;
+    if (value <= ~0ull) {
+        const int n = decimalLength(static_cast<uint64_t>(value));
+        writeDigits(static_cast<uint64_t>(value), buf + n);
+        return n;
+    }
+    // the low 19 digits, zero padded
+    const int n = writeInteger(value / Pow10_19, buf);
+    memset(buf + n, '0', 19);
+    writeDigits(static_cast<uint64_t>(value % Pow10_19), buf + n + 19);
+    return n + 19;
+}
+
+// writes the shortest representation of real to buf, not null terminated,
+// returns its length. with plain, always in fixed notation, e.g. "1e+20" is
+// "100000000000000000000": needs PlainRealLength chars, and returns -1 for
+// integers from 2^128 up, which aren't written. otherwise at most
+// ShortestRealLength - 1 chars
+template <typename real_type, bool plain = false>
+int formatShortest(real_type real, char* buf)
+{
+    using Format = BinaryFormat<real_type>;
+    using bits_type = typename Format::bits_type;
+    constexpr int MantissaBits = Format::MantissaBits;
+
+    bits_type bits;
+    memcpy(&bits, &real, sizeof(bits));
+    const uint64_t mantissa = bits & ((bits_type(1) << MantissaBits) - 1);
+    const int power2 = (bits >> MantissaBits) & Format::InfinitePower;
+
+    char* p = buf;
+    if (bits >> (sizeof(bits_type) * 8 - 1)) {
+        *p++ = '-';
+    }
+    if (power2 == Format::InfinitePower) {
+        memcpy(p, mantissa ? "nan" : "inf", 3);
+        return p + 3 - buf;
+    }
+    if (power2 == 0 && mantissa == 0) {
+        *p = '0';
+        return p + 1 - buf;
+    }
+
+    const auto decimal = shortestDecimal<real_type>(mantissa, power2);
+    const int n = decimalLength(decimal.m_digits);
+    const int e = decimal.m_exponent;
+    // the scientific exponent
+    const int x = e + n - 1;
+
+    const int fixedLength = e >= 0 ? n + e : (x >= 0 ? n + 1 : n + 1 - x);
+    const int scientificLength =
+        n + (n > 1 ? 1 : 0) + 2 + (x <= -100 || x >= 100 ? 3 : 2);
+
+    if (plain || fixedLength <= scientificLength) {
+        if (e >= 0) {
+            // the real is an integer, written exactly rather than its
+            // shortest digits padded with zeros, like std::to_chars
+            const int shift = power2 + Format::MinExponent - MantissaBits;
+            if (plain && shift + MantissaBits >= 128) {
+                return -1;
+            }
+            unsigned __int128 integer = (1ull << MantissaBits) | mantissa;
+            integer = shift >= 0 ? integer << shift : integer >> -shift;
+            p += writeInteger(integer, p);
+        }
+        else if (x >= 0) {
+            // the integer part moves one char left to make room for the point
+            writeDigits(decimal.m_digits, p + n + 1);
+            memmove(p, p + 1, x + 1);
+            p[x + 1] = '.';
+            p += n + 1;
+        }
+        else {
+            p[0] = '0';
+            p[1] = '.';
+            memset(p + 2, '0', -x - 1);
+            p += 1 - x;
+            writeDigits(decimal.m_digits, p + n);
+            p += n;
+        }
+        return p - buf;
+    }
+
+    writeDigits(decimal.m_digits, p + n + 1);
+    p[0] = p[1];
+    if (n > 1) {
+        p[1] = '.';
+        p += n + 1;
+    }
+    else {
+        ++p;
+    }
+    *p++ = 'e';
+    *p++ = x < 0 ? '-' : '+';
+    const int absX = std::abs(x);
+    if (absX >= 100) {
+        *p++ = static_cast<char>('0' + absX / 100);
+    }
+    memcpy(p, &DigitPairs[2 * (absX % 100)], 2);
+    return p + 2 - buf;
+}
+
+// writes real with exactly decimals digits after the point, rounded half to
+// even on its exact value like printf's "%.*f", not null terminated, returns
+// its length, or -1 if |real| * 10^decimals isn't below 2^52, when nothing
+// is written. buf needs 40 chars.
+//
+// |real| * 10^decimals is rounded to an integer and written with the digit
+// pairs: the product p is inexact, but p + err is, err being the fma's
+// remainder. below 2^52, p's fraction is exact and p's ulp is at most 0.5,
+// so the fraction alone decides the rounding unless it's exactly 0.5
+inline int formatFixed(double real, int decimals, char* buf)
+{
+#if FLT_EVAL_METHOD == 0
+    using Format = BinaryFormat<double>;
+    constexpr double Limit = 4503599627370496.0; // 2^52
+    static constexpr uint64_t Pow10[] = {
+        1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+        10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+        100000000000ull, 1000000000000ull, 10000000000000ull,
+        100000000000000ull, 1000000000000000ull};
+
+    if (decimals > Format::MaxExactPow10) {
+        return -1;
+    }
+    const double a = std::fabs(real);
+    const double scale = Format::exactPow10(decimals);
+    const double p = a * scale;
+    if (!(p < Limit)) {
+        return -1;
+    }
+
+    // a * scale == p + err exactly. an fma rounds once, so err is exact
+    // whether or not the compiler contracts anything around it
+    const double err = std::fma(a, scale, -p);
+
+    const double fl = std::floor(p);
+    const double fraction = p - fl;
+    uint64_t scaled = static_cast<uint64_t>(fl);
+    if (fraction > 0.5 || (fraction == 0.5
+                && (err > 0 || (err == 0 && (scaled & 1))))) {
+        ++scaled;
+    }
+
+    // scaled is at most 2^52, below 10^16
+    uint64_t integer = 0;
+    uint64_t fractional = scaled;
+    if (decimals < 16) {
+        integer = scaled / Pow10[decimals];
+        fractional = scaled % Pow10[decimals];
+    }
+
+    char* out = buf;
+    if (std::signbit(real)) {
+        *out++ = '-';
+    }
+    out += decimalLength(integer);
+    writeDigits(integer, out);
+    if (decimals > 0) {
+        *out++ = '.';
+        memset(out, '0', decimals);
+        out += decimals;
+        writeDigits(fractional, out);
+    }
+    return out - buf;
+#else
+    return -1;
+#endif
+}
+
+// writes ticks / 10^scale, i.e. an integer when scale is 0, with decimals
+// digits after the point, rounded half to even like formatFixed if there are
+// fewer than scale. all of scale's but the trailing zeros if decimals is -1.
+// not null terminated, returns the length. buf needs 22 + max(scale,
+// decimals) chars, scale is at most 19
+template <typename int_type>
+int formatTicks(int_type ticks, int scale, int decimals, char* buf)
+{
+    using unsigned_type = typename std::make_unsigned<int_type>::type;
+    const auto pow10 = [](int e) {
+        unsigned_type power = 1;
+        while (e-- > 0) {
+            power *= 10;
+        }
+        return power;
+    };
+
+    unsigned_type magnitude = static_cast<unsigned_type>(ticks);
+    int n = 0;
+    if constexpr (std::is_signed<int_type>::value) {
+        if (ticks < 0) {
+            buf[n++] = '-';
+            magnitude = 0 - magnitude;
+        }
+    }
+    if (decimals < 0) {
+        for (decimals = scale; decimals > 0 && magnitude % 10 == 0;
+                --decimals) {
+            magnitude /= 10;
+        }
+        scale = decimals;
+    }
+    else if (decimals < scale) {
+        const unsigned_type divisor = pow10(scale - decimals);
+        const unsigned_type quotient = magnitude / divisor;
+        const unsigned_type remainder = magnitude % divisor;
+        magnitude = quotient + (remainder > divisor / 2
+                || (remainder == divisor / 2 && (quotient & 1)));
+        scale = decimals;
+    }
+
+    const unsigned_type unit = pow10(scale);
+    n += writeInteger(magnitude / unit, buf + n);
+    if (decimals > 0) {
+        buf[n++] = '.';
+        memset(buf + n, '0', decimals);
+        if (scale > 0) {
+            writeDigits(magnitude % unit, buf + n + scale);
+        }
+        n += decimals;
+    }
+    return n;
+}
+
+// copies the first n chars of str to buf like snprintf, returns n
+inline int truncate(const char* str, int n, char* buf, size_t size)
+{
+    if (size > 0) {
+        const size_t copied = static_cast<size_t>(n) < size ? n : size - 1;
+        memcpy(buf, str, copied);
+        buf[copied] = '\0';
+    }
+    return n;
+}
+
+// like snprintf for std::to_chars(first, last, real, args...)
+template <typename real_type, typename... Args>
+int toChars(const real_type& real, char* buf, size_t size,
+        const Args&... args)
+{
+    char local[512];
+    const auto result =
+        std::to_chars(local, local + sizeof(local), real, args...);
+    if (result.ec == std::errc()) {
+        return truncate(local, result.ptr - local, buf, size);
+    }
+
+    // thousands of digits, a huge long double or many decimals
+    std::string str(64, '\0');
+    for (;;) {
+        str.resize(str.size() * 4);
+        const auto big =
+            std::to_chars(&str[0], &str[0] + str.size(), real, args...);
+        if (big.ec == std::errc()) {
+            return truncate(str.data(), big.ptr - str.data(), buf, size);
+        }
+    }
+}
+
+// formatTicks, cut to size - 1 chars and null terminated like snprintf
+template <typename int_type>
+int formatTicks(int_type ticks, int scale, int decimals, char* buf,
+        size_t size)
+{
+    char local[64];
+    const int length = 22 + std::max(scale, decimals);
+    if (length <= static_cast<int>(sizeof(local))) {
+        char* out = size >= static_cast<size_t>(length) ? buf : local;
+        const int n = formatTicks(ticks, scale, decimals, out);
+        if (out == buf) {
+            buf[n] = '\0';
+            return n;
+        }
+        return truncate(local, n, buf, size);
+    }
+    std::string str(length, '\0');
+    return truncate(str.data(), formatTicks(ticks, scale, decimals, &str[0]),
+            buf, size);
+}
+
+}
+
+// enough for any float, double or long double, e.g.
+// "-2.2250738585072014e-308" and its null
+constexpr int ShortestRealLength = 32;
+
+// enough for a plain float or double below 2^128 and its null, e.g.
+// "-0.000...00049406564584124654", 1 + 2 + 323 + 17
+constexpr int PlainRealLength = 344;
+
+// like snprintf: writes the shortest string that parses back to real, cut to
+// size - 1 chars and null terminated, and returns its full length. e.g.
+// "0.1", "100", "1e+20", "1.5e-07", like std::to_chars(first, last, real)
+template <typename real_type>
+int formatReal(const real_type& real, char* buf, size_t size)
+{
+    using type = typename std::remove_cv<real_type>::type;
+
+    if constexpr (std::is_same<type, float>::value
+            || std::is_same<type, double>::value) {
+        if (size >= ShortestRealLength) {
+            const int n = detail::formatShortest<type>(real, buf);
+            buf[n] = '\0';
+            return n;
+        }
+        char local[ShortestRealLength];
+        const int n = detail::formatShortest<type>(real, local);
+        return detail::truncate(local, n, buf, size);
+    }
+    else if constexpr (std::is_integral<type>::value) {
+        return detail::formatTicks(real, 0, -1, buf, size);
+    }
+    else {
+        return detail::toChars(real, buf, size);
+    }
+}
+
+// like formatReal, but never in scientific notation: "1e+20" is
+// "100000000000000000000", "1.5e-07" is "0.00000015", like
+// std::to_chars(first, last, real, std::chars_format::fixed)
+template <typename real_type>
+int formatPlain(const real_type& real, char* buf, size_t size)
+{
+    using type = typename std::remove_cv<real_type>::type;
+
+    if constexpr (std::is_same<type, float>::value
+            || std::is_same<type, double>::value) {
+        char local[PlainRealLength];
+        char* out = size >= PlainRealLength ? buf : local;
+        const int n = detail::formatShortest<type, true>(real, out);
+        if (n < 0) {
+            return detail::toChars(real, buf, size, std::chars_format::fixed);
+        }
+        if (out == buf) {
+            buf[n] = '\0';
+            return n;
+        }
+        return detail::truncate(local, n, buf, size);
+    }
+    else if constexpr (std::is_integral<type>::value) {
+        return detail::formatTicks(real, 0, -1, buf, size);
+    }
+    else {
+        return detail::toChars(real, buf, size, std::chars_format::fixed);
+    }
+}
+
+// like snprintf(buf, size, "%.*f", decimals, real), rounded half to even on
+// the exact value of real, e.g. 2 decimals give "0.10", "-1.00", "2.68" for
+// 2.675 (2.67499999...). inf and nan are "inf", "-inf", "nan", "-nan"
+template <typename real_type>
+int formatFixed(const real_type& real, int decimals, char* buf, size_t size)
+{
+    using type = typename std::remove_cv<real_type>::type;
+
+    if constexpr (std::is_same<type, float>::value
+            || std::is_same<type, double>::value) {
+        if (!std::isfinite(real)) {
+            const char* str = std::isnan(real)
+                ? (std::signbit(real) ? "-nan" : "nan")
+                : (real < 0 ? "-inf" : "inf");
+            return detail::truncate(str, strlen(str), buf, size);
+        }
+        char local[40];
+        char* out = size >= sizeof(local) ? buf : local;
+        const int n = detail::formatFixed(real, decimals, out);
+        if (n < 0) {
+            return detail::toChars(static_cast<double>(real), buf, size,
+                    std::chars_format::fixed, decimals);
+        }
+        if (out == buf) {
+            buf[n] = '\0';
+            return n;
+        }
+        return detail::truncate(local, n, buf, size);
+    }
+    else if constexpr (std::is_integral<type>::value) {
+        return detail::formatTicks(real, 0, decimals, buf, size);
+    }
+    else {
+        return detail::toChars(real, buf, size, std::chars_format::fixed,
+                decimals);
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,521 @@
+#ifndef LEXICAL_CACHE_REAL_PARSER_H_INCLUDED
+#define LEXICAL_CACHE_REAL_PARSER_H_INCLUDED
+
+#include "pow5_table.h"
+
+#include <charconv>
+#include <string_view>
+#include <stdexcept>
+#include <type_traits>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <cfloat>
+
+// locale independent string -> real conversion, correctly rounded.
+//
+// short plain decimals like "1234.5678" are converted 8 digits at a time with
+// SWAR (SIMD within a register) arithmetic, see parseShortDecimal. other
+// plain decimals of up to 19 significant digits are parsed here: Clinger's
+// fast path when the mantissa and the power of 10 are both exact, otherwise
+// the Eisel-Lemire algorithm, a 64 x 128 bit multiplication by a tabulated
+// power of 5 (see pow5_table.h and "Number Parsing at a Gigabyte per
+// Second", Lemire 2021). everything else, longer mantissas, hex, inf, nan
+// and long double, goes to std::from_chars. integers are accumulated digit
+// by digit, see tryParseInteger
+namespace lexical_cache
+{
+
+namespace detail
+{
+
+template <typename real_type>
+struct BinaryFormat;
+
+template <>
+struct BinaryFormat<double>
+{
+    using bits_type = uint64_t;
+
+    static constexpr int MantissaBits = 52;
+    static constexpr int MinExponent = -1023;
+    static constexpr int InfinitePower = 0x7ff;
+    // only these powers of 10 can produce an exact tie
+    static constexpr int MinRoundToEven = -4;
+    static constexpr int MaxRoundToEven = 23;
+    // w * 10^q is 0 below, infinite above, for any 19 digit w
+    static constexpr int MinPow10 = -342;
+    static constexpr int MaxPow10 = 308;
+    // Clinger's fast path
+    static constexpr int MaxExactPow10 = 22;
+    static constexpr uint64_t MaxExactMantissa = 1ull << 53;
+
+    static double exactPow10(int e)
+    {
+        static constexpr double powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        return powers[e];
+    }
+};
+
+template <>
+struct BinaryFormat<float>
+{
+    using bits_type = uint32_t;
+
+    static constexpr int MantissaBits = 23;
+    static constexpr int MinExponent = -127;
+    static constexpr int InfinitePower = 0xff;
+    static constexpr int MinRoundToEven = -17;
+    static constexpr int MaxRoundToEven = 10;
+    static constexpr int MinPow10 = -64;
+    static constexpr int MaxPow10 = 38;
+    static constexpr int MaxExactPow10 = 10;
+    static constexpr uint64_t MaxExactMantissa = 1ull << 24;
+
+    static float exactPow10(int e)
+    {
+        static constexpr float powers[] = {
+            1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+        return powers[e];
+    }
+};
+
+enum class ParseResult
+{
+    Parsed,
+    OutOfRange,
+    // not a plain decimal of at most 19 significant digits
+    NotHandled,
+};
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// the "C" locale's isspace()
+inline bool isSpace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// the biased binary exponent and the mantissa, without its implicit bit, of
+// the real nearest to w * 10^q, w != 0. InfinitePower if it overflows
+template <typename real_type>
+void eiselLemire(uint64_t w, int q, uint64_t& mantissa, int& power2)
+{
+    using Format = BinaryFormat<real_type>;
+    constexpr int MantissaBits = Format::MantissaBits;
+
+    if (q < Format::MinPow10) {
+        mantissa = 0;
+        power2 = 0;
+        return;
+    }
+    if (q > Format::MaxPow10) {
+        mantissa = 0;
+        power2 = Format::InfinitePower;
+        return;
+    }
+
+    const int lz = __builtin_clzll(w);
+    w <<= lz;
+
+    // the high bits of w * 5^q, exact enough to round to MantissaBits + 3
+    // bits, see Mushtak and Lemire, "Fast Number Parsing Without Fallback"
+    const int index = 2 * (q - Pow5TableMin);
+    unsigned __int128 product =
+        static_cast<unsigned __int128>(w) * Pow5Table[index];
+    constexpr uint64_t PrecisionMask = ~0ull >> (MantissaBits + 3);
+    uint64_t high = static_cast<uint64_t>(product >> 64);
+    uint64_t low = static_cast<uint64_t>(product);
+    if ((high & PrecisionMask) == PrecisionMask) {
+        const uint64_t second = static_cast<uint64_t>(
+                (static_cast<unsigned __int128>(w) * Pow5Table[index + 1])
+                >> 64);
+        low += second;
+        if (second > low) {
+            ++high;
+        }
+    }
+
+    const int upperBit = static_cast<int>(high >> 63);
+    const int shift = upperBit + 64 - MantissaBits - 3;
+    mantissa = high >> shift;
+    // floor(log2(10^q)) + 63, exact over the table's range
+    const int pow10Log2 = (((152170 + 65536) * q) >> 16) + 63;
+    power2 = pow10Log2 + upperBit - lz - Format::MinExponent;
+
+    if (power2 <= 0) {
+        // subnormal
+        if (-power2 + 1 >= 64) {
+            mantissa = 0;
+            power2 = 0;
+            return;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        // rounding up may make it normal again
+        power2 = mantissa < (1ull << MantissaBits) ? 0 : 1;
+        mantissa &= ~(1ull << MantissaBits);
+        return;
+    }
+
+    // exactly halfway between two reals: round to even rather than up
+    if (low <= 1 && q >= Format::MinRoundToEven && q <= Format::MaxRoundToEven
+            && (mantissa & 3) == 1 && (mantissa << shift) == high) {
+        mantissa &= ~1ull;
+    }
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (2ull << MantissaBits)) {
+        mantissa = 1ull << MantissaBits;
+        ++power2;
+    }
+    mantissa &= ~(1ull << MantissaBits);
+    if (power2 >= Format::InfinitePower) {
+        mantissa = 0;
+        power2 = Format::InfinitePower;
+    }
+}
+
+// [first, last) starts with digits, an optional fraction and an optional
+// exponent, anything after that is ignored, like strtod does
+template <typename real_type>
+ParseResult parseDecimal(const char* first, const char* last,
+        bool negative, real_type& value)
+{
+    using Format = BinaryFormat<real_type>;
+
+    uint64_t w = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+
+    const char* p = first;
+    for (; p != last && isDigit(*p); ++p) {
+        any = true;
+        if (w == 0 && *p == '0') {
+            continue;
+        }
+        if (++digits > 19) {
+            return ParseResult::NotHandled;
+        }
+        w = w * 10 + (*p - '0');
+    }
+    if (p != last && *p == '.') {
+        for (++p; p != last && isDigit(*p); ++p) {
+            any = true;
+            --exponent;
+            if (w == 0 && *p == '0') {
+                continue;
+            }
+            if (++digits > 19) {
+                return ParseResult::NotHandled;
+            }
+            w = w * 10 + (*p - '0');
+        }
+    }
+    if (!any) {
+        return ParseResult::NotHandled;
+    }
+
+    // an exponent without digits isn't part of the number
+    if (p != last && (*p == 'e' || *p == 'E')) {
+        const char* e = p + 1;
+        bool negativeExponent = false;
+        if (e != last && (*e == '+' || *e == '-')) {
+            negativeExponent = *e == '-';
+            ++e;
+        }
+        if (e != last && isDigit(*e)) {
+            int explicitExponent = 0;
+            for (; e != last && isDigit(*e); ++e) {
+                // large enough to be 0 or infinite whatever the digits
+                if (explicitExponent < 100000) {
+                    explicitExponent = explicitExponent * 10 + (*e - '0');
+                }
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+        }
+    }
+
+    if (w == 0) {
+        value = negative ? -real_type(0) : real_type(0);
+        return ParseResult::Parsed;
+    }
+
+#if FLT_EVAL_METHOD == 0
+    if (w <= Format::MaxExactMantissa
+            && exponent >= -Format::MaxExactPow10
+            && exponent <= Format::MaxExactPow10) {
+        value = static_cast<real_type>(w);
+        if (exponent < 0) {
+            value /= Format::exactPow10(-exponent);
+        }
+        else {
+            value *= Format::exactPow10(exponent);
+        }
+        value = negative ? -value : value;
+        return ParseResult::Parsed;
+    }
+#endif
+
+    uint64_t mantissa = 0;
+    int power2 = 0;
+    eiselLemire<real_type>(w, exponent, mantissa, power2);
+    if (power2 == Format::InfinitePower || (power2 == 0 && mantissa == 0)) {
+        return ParseResult::OutOfRange;
+    }
+
+    using bits_type = typename Format::bits_type;
+    const bits_type bits = static_cast<bits_type>(mantissa)
+        | static_cast<bits_type>(power2) << Format::MantissaBits
+        | static_cast<bits_type>(negative) << (sizeof(bits_type) * 8 - 1);
+    memcpy(&value, &bits, sizeof(value));
+    return ParseResult::Parsed;
+}
+
+// 8 ascii chars, the first one in the low byte: true if they're all digits
+inline bool isEightDigits(uint64_t word)
+{
+    return ((word & 0xf0f0f0f0f0f0f0f0ull)
+            | (((word + 0x0606060606060606ull) & 0xf0f0f0f0f0f0f0f0ull) >> 4))
+        == 0x3333333333333333ull;
+}
+
+// the value of 8 ascii digits, the first one in the low byte: pairs, then
+// quads, then the whole, each step a multiply-add of the halves
+inline uint32_t parseEightDigits(uint64_t word)
+{
+    constexpr uint64_t Mask = 0x000000ff000000ffull;
+    constexpr uint64_t Mul1 = 100 + (1000000ull << 32);
+    constexpr uint64_t Mul2 = 1 + (10000ull << 32);
+    word -= 0x3030303030303030ull;
+    word = word * 10 + (word >> 8);
+    return static_cast<uint32_t>(
+            ((word & Mask) * Mul1 + ((word >> 16) & Mask) * Mul2) >> 32);
+}
+
+// SWAR fast path for what feeds mostly send, e.g. "1234.5678": [first, last)
+// is 8 to 16 chars, digits and at most one '.', nothing else. they're read as
+// the last 8 chars and the first ones, right aligned in 16 chars of '0's,
+// with two loads that stay within [first, last). the '.' is squeezed out,
+// then both words are checked and converted 8 digits at a time. false if
+// [first, last) isn't like that, or if the result isn't exact in Clinger's
+// fast path. shorter strings are cheap enough digit by digit
+template <typename real_type>
+bool parseShortDecimal(const char* first, const char* last,
+        bool negative, real_type& value)
+{
+#if FLT_EVAL_METHOD == 0 && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    using Format = BinaryFormat<real_type>;
+    constexpr uint64_t Zeros = 0x3030303030303030ull;
+    constexpr uint64_t Dots = 0x2e2e2e2e2e2e2e2eull;
+    constexpr uint64_t Ones = 0x0101010101010101ull;
+    constexpr uint64_t Highs = 0x8080808080808080ull;
+
+    const int length = last - first;
+    if (length < 8 || length > 16) {
+        return false;
+    }
+
+    uint64_t leading = Zeros;
+    uint64_t trailing = 0;
+    memcpy(&trailing, last - 8, 8);
+    if (length > 8) {
+        memcpy(&leading, first, 8);
+        const int padding = 8 * (16 - length);
+        leading = padding ? leading << padding | Zeros >> (64 - padding)
+            : leading;
+    }
+
+    // the '.' is the lowest 0 byte of word ^ "........", if any
+    const uint64_t leadingDots = leading ^ Dots;
+    const uint64_t trailingDots = trailing ^ Dots;
+    const uint64_t leadingDot = (leadingDots - Ones) & ~leadingDots & Highs;
+    const uint64_t trailingDot = (trailingDots - Ones) & ~trailingDots & Highs;
+
+    int fraction = 0;
+    if (leadingDot | trailingDot) {
+        const int dot = leadingDot ? __builtin_ctzll(leadingDot) / 8
+            : 8 + __builtin_ctzll(trailingDot) / 8;
+        fraction = 15 - dot;
+        // the chars before the '.' move up a byte, a '0' comes in
+        unsigned __int128 chars =
+            static_cast<unsigned __int128>(trailing) << 64 | leading;
+        const unsigned __int128 below =
+            (static_cast<unsigned __int128>(1) << (8 * dot)) - 1;
+        const unsigned __int128 throughDot = below << 8 | 0xff;
+        chars = (chars & ~throughDot) | (chars & below) << 8 | '0';
+        leading = static_cast<uint64_t>(chars);
+        trailing = static_cast<uint64_t>(chars >> 64);
+    }
+
+    if (!isEightDigits(leading) || !isEightDigits(trailing)) {
+        return false;
+    }
+    const uint64_t w = parseEightDigits(leading) * 100000000ull
+        + parseEightDigits(trailing);
+    if (w > Format::MaxExactMantissa || fraction > Format::MaxExactPow10) {
+        return false;
+    }
+
+    value = static_cast<real_type>(w) / Format::exactPow10(fraction);
+    value = negative ? -value : value;
+    return true;
+#else
+    return false;
+#endif
+}
+
+}
+
+// why a string isn't a real
+enum class ParseError : uint8_t
+{
+    None = 0,
+    // no number at the start, std::invalid_argument
+    NoConversion,
+    // overflows or underflows to 0, std::out_of_range
+    OutOfRange,
+};
+
+// the exception parseReal throws for error
+[[noreturn]] inline void throwParseError(ParseError error)
+{
+    if (error == ParseError::OutOfRange) {
+        throw std::out_of_range("parseReal: out of range");
+    }
+    throw std::invalid_argument("parseReal: no conversion");
+}
+
+// tryParseReal for integers: white space and a sign, then decimal digits
+// accumulated one at a time, no '.', exponent or hex, trailing characters
+// ignored. OutOfRange if it doesn't fit int_type, NoConversion for a
+// negative unsigned, like std::from_chars
+template <typename int_type>
+ParseError tryParseInteger(std::string_view str, int_type& value)
+{
+    using unsigned_type = typename std::make_unsigned<int_type>::type;
+
+    const char* first = str.data();
+    const char* last = first + str.size();
+    while (first != last && detail::isSpace(*first)) {
+        ++first;
+    }
+    bool negative = false;
+    if (first != last && (*first == '+' || *first == '-')) {
+        negative = *first == '-';
+        ++first;
+    }
+    if (first == last || !detail::isDigit(*first)
+            || (negative && std::is_unsigned<int_type>::value)) {
+        return ParseError::NoConversion;
+    }
+
+    // the largest magnitude, one more than max for a negative one
+    const unsigned_type limit =
+        static_cast<unsigned_type>(std::numeric_limits<int_type>::max())
+        + (negative ? 1 : 0);
+    unsigned_type magnitude = 0;
+    for (; first != last && detail::isDigit(*first); ++first) {
+        const unsigned digit = *first - '0';
+        if (magnitude > (limit - digit) / 10) {
+            return ParseError::OutOfRange;
+        }
+        magnitude = magnitude * 10 + digit;
+    }
+    value = static_cast<int_type>(negative ? 0 - magnitude : magnitude);
+    return ParseError::None;
+}
+
+// parseReal without exceptions, value is only set if it returns None, like
+// std::from_chars. a bad string costs about as much as a good one
+template <typename real_type>
+ParseError tryParseReal(std::string_view str, real_type& value)
+{
+    using type = typename std::remove_cv<real_type>::type;
+
+    if constexpr (std::is_integral<type>::value) {
+        return tryParseInteger(str, value);
+    }
+    else {
+        const char* first = str.data();
+        const char* last = first + str.size();
+        while (first != last && detail::isSpace(*first)) {
+            ++first;
+        }
+        bool negative = false;
+        if (first != last && (*first == '+' || *first == '-')) {
+            negative = *first == '-';
+            ++first;
+        }
+        if (first == last || *first == '+' || *first == '-') {
+            return ParseError::NoConversion;
+        }
+
+        const bool hex = last - first > 2 && first[0] == '0'
+            && (first[1] == 'x' || first[1] == 'X');
+
+        type parsed = 0;
+        if constexpr (std::is_same<type, float>::value
+                || std::is_same<type, double>::value) {
+            if (!hex) {
+                if (detail::parseShortDecimal(first, last, negative, parsed)) {
+                    value = parsed;
+                    return ParseError::None;
+                }
+                switch (detail::parseDecimal(first, last, negative, parsed)) {
+                    case detail::ParseResult::Parsed:
+                        value = parsed;
+                        return ParseError::None;
+                    case detail::ParseResult::OutOfRange:
+                        return ParseError::OutOfRange;
+                    case detail::ParseResult::NotHandled:
+                        break;
+                }
+            }
+        }
+
+        auto result = hex
+            ? std::from_chars(first + 2, last, parsed, std::chars_format::hex)
+            : std::from_chars(first, last, parsed);
+        if (hex && result.ec == std::errc::invalid_argument) {
+            // just "0", followed by an x
+            result = std::from_chars(first, last, parsed);
+        }
+        if (result.ec == std::errc::invalid_argument) {
+            return ParseError::NoConversion;
+        }
+        if (result.ec == std::errc::result_out_of_range) {
+            return ParseError::OutOfRange;
+        }
+        value = negative ? -parsed : parsed;
+        return ParseError::None;
+    }
+}
+
+// like std::stof, std::stod and std::stold: skips leading white space,
+// ignores trailing characters, throws std::invalid_argument if there's no
+// number and std::out_of_range if it overflows or underflows to 0. but it
+// ignores the locale, the decimal point is always '.'. an integral real_type
+// is parsed like std::stol, in base 10 only, see tryParseInteger
+template <typename real_type>
+real_type parseReal(std::string_view str)
+{
+    typename std::remove_cv<real_type>::type value;
+    const ParseError error = tryParseReal(str, value);
+    if (error != ParseError::None) {
+        throwParseError(error);
+    }
+    return value;
+}
+
+}
+
+#endif
@@ -0,0 +1,638 @@
+#ifndef LEXICAL_CACHE_SEQLOCK_CACHE_H_INCLUDED
+#define LEXICAL_CACHE_SEQLOCK_CACHE_H_INCLUDED
+
+#include "lexical_cache.h"
+#include "striped_counter.h"
+
+#include <atomic>
+#include <mutex>
+#include <array>
+#include <string>
+#include <string_view>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace lexical_cache
+{
+
+namespace detail
+{
+
+// the entries and indexes of SeqLockCache, with the lock free reads and the
+// writes, which the owner serializes. only fixed size arrays of atomic words
+// and plain ints, no pointer, so it also works placed in memory shared
+// between processes, see SharedMemoryCache
+template <typename real_type, int cache_size_N, int str_capacity>
+class SeqLockStore
+{
+public:
+    static_assert(cache_size_N > 0, "cache can't be empty");
+    static_assert(str_capacity > 0 && str_capacity % 8 == 0
+            && str_capacity < 256, "str_capacity must be whole words");
+
+private:
+    static constexpr int RealWords = (sizeof(real_type) + 7) / 8;
+    static constexpr int StrWords = str_capacity / 8;
+    static constexpr int Words = 1 + RealWords + StrWords;
+    static constexpr int MaxReadAttempts = 16;
+
+    using compare_type = typename UlpBucketIndex<real_type>::compare_type;
+
+    // an entry as plain words, copied in and out of a Slot. the first word
+    // holds the occupied flag and the string length, then the real, then the
+    // string
+    struct Payload
+    {
+        uint64_t m_words[Words];
+
+        bool occupied() const { return (m_words[0] >> 32) != 0; }
+        size_t length() const { return m_words[0] & 0xff; }
+
+        real_type real() const
+        {
+            real_type r;
+            std::memcpy(&r, &m_words[1], sizeof(r));
+            return r;
+        }
+
+        const char* str() const
+        {
+            return reinterpret_cast<const char*>(&m_words[1 + RealWords]);
+        }
+
+        void set(const char* s, size_t len, const real_type& r)
+        {
+            std::memset(m_words, 0, sizeof(m_words));
+            m_words[0] = (1ull << 32) | len;
+            std::memcpy(&m_words[1], &r, sizeof(r));
+            std::memcpy(&m_words[1 + RealWords], s, len);
+        }
+
+        bool matches(const char* s, size_t len) const
+        {
+            return occupied() && length() == len
+                && std::memcmp(str(), s, len) == 0;
+        }
+    };
+
+    struct alignas(64) Slot
+    {
+        std::atomic<uint32_t>             m_seq{0};
+        std::atomic<bool>                 m_referenced{false};
+        std::atomic<uint64_t>             m_words[Words];
+
+        // false if the slot kept changing under the reader
+        bool read(Payload& p) const
+        {
+            for (int attempt = 0; attempt < MaxReadAttempts; ++attempt) {
+                const auto before = m_seq.load(std::memory_order_acquire);
+                if (before & 1) {
+                    continue;
+                }
+                for (int w = 0; w < Words; ++w) {
+                    p.m_words[w] = m_words[w].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_seq.load(std::memory_order_relaxed) == before) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // writers only, under the writer lock. the sequence number may
+        // already be odd, a write left half done by a process that died
+        // holding the lock, this one ends it on an even number all the same
+        void write(const Payload& p)
+        {
+            const auto seq = m_seq.load(std::memory_order_relaxed) | 1;
+            m_seq.store(seq, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (int w = 0; w < Words; ++w) {
+                m_words[w].store(p.m_words[w], std::memory_order_relaxed);
+            }
+            m_seq.store(seq + 1, std::memory_order_release);
+        }
+
+        // writers only, nobody else changes the slot
+        Payload peek() const
+        {
+            Payload p;
+            for (int w = 0; w < Words; ++w) {
+                p.m_words[w] = m_words[w].load(std::memory_order_relaxed);
+            }
+            return p;
+        }
+
+        bool occupied() const
+        {
+            return (m_words[0].load(std::memory_order_relaxed) >> 32) != 0;
+        }
+
+        // CLOCK referenced bit, only written when it changes
+        void touch()
+        {
+            if (!m_referenced.load(std::memory_order_relaxed)) {
+                m_referenced.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // hash -> slot, linear probing over atomic words, each word holds 32 bits
+    // of the hash and the slot + 1, 0 is empty
+    class SlotTable
+    {
+    public:
+        // calls match(slot) on every slot with the same hash until it returns
+        // true
+        template <typename match_type>
+        bool find(uint64_t hash, match_type match) const
+        {
+            const auto tag = static_cast<uint32_t>(hash);
+            auto i = tag & Mask;
+            for (int probes = 0; probes < Size; ++probes, i = (i + 1) & Mask) {
+                const auto e = m_entries[i].load(std::memory_order_acquire);
+                if (e == 0) {
+                    return false;
+                }
+                if ((e >> 32) == tag && match(static_cast<int>(e) - 1)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void insert(uint64_t hash, int slot)
+        {
+            const auto tag = static_cast<uint32_t>(hash);
+            auto i = tag & Mask;
+            while (m_entries[i].load(std::memory_order_relaxed) != 0) {
+                i = (i + 1) & Mask;
+            }
+            m_entries[i].store(entry(tag, slot), std::memory_order_release);
+        }
+
+        // backward shift deletion, keeps probe sequences unbroken without
+        // tombstones. a reader racing with the shift may miss an entry, which
+        // only costs it the locked path
+        void erase(uint64_t hash, int slot)
+        {
+            const auto tag = static_cast<uint32_t>(hash);
+            const auto target = entry(tag, slot);
+            auto i = tag & Mask;
+            while (m_entries[i].load(std::memory_order_relaxed) != target) {
+                i = (i + 1) & Mask;
+            }
+
+            auto j = i;
+            for (;;) {
+                j = (j + 1) & Mask;
+                const auto e = m_entries[j].load(std::memory_order_relaxed);
+                if (e == 0) {
+                    break;
+                }
+                // move e back into the hole unless its home lies cyclically
+                // in (i, j]
+                const auto home = static_cast<uint32_t>(e >> 32) & Mask;
+                const bool stays = (i <= j)
+                    ? (i < home && home <= j)
+                    : (i < home || home <= j);
+                if (!stays) {
+                    m_entries[i].store(e, std::memory_order_release);
+                    i = j;
+                }
+            }
+            m_entries[i].store(0, std::memory_order_release);
+        }
+
+        void clear()
+        {
+            for (auto& e : m_entries) {
+                e.store(0, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        static constexpr int tableSize(int n)
+        {
+            return n <= 1 ? 1 : 2 * tableSize((n + 1) / 2);
+        }
+
+        static constexpr int Size = tableSize(2 * cache_size_N);
+        static constexpr uint32_t Mask = Size - 1;
+
+        static uint64_t entry(uint32_t tag, int slot)
+        {
+            return (static_cast<uint64_t>(tag) << 32)
+                | static_cast<uint32_t>(slot + 1);
+        }
+
+        std::array<std::atomic<uint64_t>, Size> m_entries;
+    };
+
+    using Slots = std::array<Slot, cache_size_N>;
+
+public:
+    using bucket_type = typename UlpBucketIndex<real_type>::bucket_type;
+
+    static uint64_t strHash(const char* s, size_t len)
+    {
+        // FNV-1a
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < len; ++i) {
+            h = (h ^ static_cast<unsigned char>(s[i])) * 0x100000001b3ull;
+        }
+        return mix64(h);
+    }
+
+    static uint64_t bucketHash(bucket_type bucket)
+    {
+        return mix64(static_cast<uint64_t>(bucket));
+    }
+
+    bool findReal(std::string_view str, uint64_t hash, real_type& real);
+    bool findStr(const real_type& real,
+            const UlpBucketIndex<real_type>& buckets, std::string& str);
+
+    // writers only
+    void insertReal(std::string_view str, uint64_t hash, const real_type& fp);
+    void insertStr(const std::string& str, const real_type& fp,
+            const UlpBucketIndex<real_type>& buckets);
+    void clear(const CacheType& t);
+
+    size_t size(const CacheType& t) const;
+
+private:
+    int victim(Slots& slots, int& hand);
+
+    Slots                                 m_reals;
+    Slots                                 m_strings;
+    SlotTable                             m_strToReal;
+    SlotTable                             m_realToStr;
+
+    int                                   m_realsHand = 0;
+    int                                   m_stringsHand = 0;
+    std::atomic<int>                      m_realsSize{0};
+    std::atomic<int>                      m_stringsSize{0};
+};
+
+template <typename real_type, int cache_size_N, int str_capacity>
+bool SeqLockStore<real_type, cache_size_N, str_capacity>::findReal(
+        std::string_view str, uint64_t hash, real_type& real)
+{
+    return m_strToReal.find(hash, [&](int slot) {
+            Payload p;
+            if (!m_reals[slot].read(p) || !p.matches(str.data(), str.size())) {
+                return false;
+            }
+            m_reals[slot].touch();
+            real = p.real();
+            return true;
+        });
+}
+
+template <typename real_type, int cache_size_N, int str_capacity>
+bool SeqLockStore<real_type, cache_size_N, str_capacity>::findStr(
+        const real_type& real, const UlpBucketIndex<real_type>& buckets,
+        std::string& str)
+{
+    // the closest of the almost equal entries, like Cache's index
+    const compare_type x = real;
+    int found = -1;
+    compare_type bestDiff = 0;
+    buckets.forEachBucket(real, [&](bucket_type bucket) {
+            m_realToStr.find(bucketHash(bucket), [&](int slot) {
+                    Payload p;
+                    if (!m_strings[slot].read(p) || !p.occupied()) {
+                        return false;
+                    }
+                    const compare_type candidate = p.real();
+                    if (!useful::almostEqual(candidate, x)) {
+                        return false;
+                    }
+                    const compare_type diff = std::fabs(candidate - x);
+                    if (found < 0 || diff < bestDiff) {
+                        found = slot;
+                        bestDiff = diff;
+                        str.assign(p.str(), p.length());
+                    }
+                    return false;
+                });
+        });
+    if (found < 0) {
+        return false;
+    }
+    m_strings[found].touch();
+    return true;
+}
+
+template <typename real_type, int cache_size_N, int str_capacity>
+int SeqLockStore<real_type, cache_size_N, str_capacity>::victim(
+        Slots& slots, int& hand)
+{
+    // terminates within two turns, the first one clears every referenced bit
+    for (;;) {
+        auto& slot = slots[hand];
+        const int current = hand;
+        hand = (hand + 1) % cache_size_N;
+
+        if (!slot.occupied()) {
+            return current;
+        }
+        if (slot.m_referenced.load(std::memory_order_relaxed)) {
+            slot.m_referenced.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        return current;
+    }
+}
+
+template <typename real_type, int cache_size_N, int str_capacity>
+void SeqLockStore<real_type, cache_size_N, str_capacity>::insertReal(
+        std::string_view str, uint64_t hash, const real_type& fp)
+{
+    const int index = victim(m_reals, m_realsHand);
+    auto& slot = m_reals[index];
+
+    // unpublish the old entry first, so no reader is sent to a slot holding
+    // something else than what the index says (the key check would catch
+    // it, but it would be a wasted read)
+    const Payload old = slot.peek();
+    if (old.occupied()) {
+        m_strToReal.erase(strHash(old.str(), old.length()), index);
+    }
+    else {
+        m_realsSize.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Payload p;
+    p.set(str.data(), str.size(), fp);
+    slot.write(p);
+    slot.m_referenced.store(false, std::memory_order_relaxed);
+
+    m_strToReal.insert(hash, index);
+}
+
+template <typename real_type, int cache_size_N, int str_capacity>
+void SeqLockStore<real_type, cache_size_N, str_capacity>::insertStr(
+        const std::string& str, const real_type& fp,
+        const UlpBucketIndex<real_type>& buckets)
+{
+    const int index = victim(m_strings, m_stringsHand);
+    auto& slot = m_strings[index];
+
+    const Payload old = slot.peek();
+    if (old.occupied()) {
+        m_realToStr.erase(bucketHash(buckets.bucketOf(old.real())), index);
+    }
+    else {
+        m_stringsSize.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Payload p;
+    p.set(str.data(), str.size(), fp);
+    slot.write(p);
+    slot.m_referenced.store(false, std::memory_order_relaxed);
+
+    m_realToStr.insert(bucketHash(buckets.bucketOf(fp)), index);
+}
+
+template <typename real_type, int cache_size_N, int str_capacity>
+size_t SeqLockStore<real_type, cache_size_N, str_capacity>::size(
+        const CacheType& t) const
+{
+    const size_t reals = m_realsSize.load(std::memory_order_relaxed);
+    const size_t strings = m_stringsSize.load(std::memory_order_relaxed);
+    if (t == String2Real) {
+        return reals;
+    }
+    else if (t == Real2String) {
+        return strings;
+    }
+    else {
+        return reals + strings;
+    }
+}
+
+template <typename real_type, int cache_size_N, int str_capacity>
+void SeqLockStore<real_type, cache_size_N, str_capacity>::clear(
+        const CacheType& t)
+{
+    Payload empty;
+    std::memset(empty.m_words, 0, sizeof(empty.m_words));
+
+    if (t == String2Real || t == Both) {
+        m_strToReal.clear();
+        for (auto& slot : m_reals) {
+            slot.write(empty);
+        }
+        m_realsHand = 0;
+        m_realsSize.store(0, std::memory_order_relaxed);
+    }
+
+    if (t == Real2String || t == Both) {
+        m_realToStr.clear();
+        for (auto& slot : m_strings) {
+            slot.write(empty);
+        }
+        m_stringsHand = 0;
+        m_stringsSize.store(0, std::memory_order_relaxed);
+    }
+}
+
+}
+
+// thread safe Cache for read mostly workloads: a hit never takes a lock and
+// never writes to memory shared with other threads.
+//
+// - entries live in fixed slots, each guarded by a sequence number. readers
+//   copy the slot optimistically and retry if a writer changed it meanwhile
+// - both indexes are fixed open addressing tables of atomic words, so a
+//   reader can probe them while a writer updates them. a stale probe at
+//   worst misses, and misses are double checked under the writer lock
+// - eviction is CLOCK, a hit only sets the referenced bit if it's not
+//   already set, the hit counter is a StripedCounter
+//
+// Cache can't be read this way: std::string entries and node based maps may
+// be freed under a reader's feet. so strings longer than str_capacity are
+// converted but not cached, and castToStr copies its result to a thread
+// local buffer that stays valid until the next castToStr call on this thread
+template <
+    typename real_type,
+    int cache_size_N=64,
+    int str_capacity=32,
+    typename format_policy=ShortestFormat,
+    typename enable=
+        typename std::enable_if<std::is_floating_point<real_type>::value>::type
+    >
+class SeqLockCache
+{
+public:
+    static_assert(cache_size_N > 0, "cache can't be empty");
+    static_assert(str_capacity > 0 && str_capacity % 8 == 0
+            && str_capacity < 256, "str_capacity must be whole words");
+
+    SeqLockCache()
+    {
+        clear();
+    }
+
+    // holds a mutex, not copyable nor movable
+    SeqLockCache(const SeqLockCache&) = delete;
+    SeqLockCache& operator=(const SeqLockCache&) = delete;
+
+    // str doesn't have to be null terminated, see Cache::castToReal
+    real_type castToReal(std::string_view str);
+
+    real_type castToReal(const char* str, size_t len)
+    {
+        return castToReal(std::string_view(str, len));
+    }
+    const char* castToStr(const real_type& real);
+
+    size_t size(const CacheType& t=Both) const;
+    bool   empty(const CacheType& t=Both) const;
+    void   clear(const CacheType& t=Both);
+
+    double missRatio() const
+    {
+        const long miss = missCount();
+        return static_cast<double>(miss) / (hitCount() + miss)*100;
+    }
+
+    void resetStats()
+    {
+        m_cacheHit.reset();
+        m_cacheMiss.store(0, std::memory_order_relaxed);
+    }
+
+    long hitCount() const { return m_cacheHit.load(); }
+    long missCount() const { return m_cacheMiss.load(std::memory_order_relaxed); }
+
+private:
+    using Store = detail::SeqLockStore<real_type, cache_size_N, str_capacity>;
+
+    Store                                 m_store;
+    // only used for its bucketing, never holds entries
+    UlpBucketIndex<real_type>             m_buckets;
+
+    std::mutex                            m_writeMutex;
+
+    StripedCounter<>                      m_cacheHit;
+    std::atomic<long>                     m_cacheMiss{0};
+};
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+real_type
+SeqLockCache<real_type, cache_size_N, str_capacity, format_policy, enable>::castToReal(
+        std::string_view str)
+{
+    const auto hash = Store::strHash(str.data(), str.size());
+    real_type real;
+    if (m_store.findReal(str, hash, real)) {
+        m_cacheHit.add();
+        return real;
+    }
+
+    // convert outside the lock, it's the slow part
+    const real_type fp = stringToReal<real_type>(str);
+
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    if (m_store.findReal(str, hash, real)) {
+        // another writer got there first
+        m_cacheHit.add();
+        return real;
+    }
+
+    m_cacheMiss.fetch_add(1, std::memory_order_relaxed);
+    if (str.size() <= str_capacity) {
+        m_store.insertReal(str, hash, fp);
+    }
+    return fp;
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+const char*
+SeqLockCache<real_type, cache_size_N, str_capacity, format_policy, enable>::castToStr(
+        const real_type& real)
+{
+    static thread_local std::string result;
+
+    if (m_store.findStr(real, m_buckets, result)) {
+        m_cacheHit.add();
+        return result.c_str();
+    }
+
+    std::string str;
+    realToString<format_policy>(real, str);
+
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    if (m_store.findStr(real, m_buckets, result)) {
+        m_cacheHit.add();
+        return result.c_str();
+    }
+
+    m_cacheMiss.fetch_add(1, std::memory_order_relaxed);
+    if (str.size() <= str_capacity) {
+        m_store.insertStr(str, real, m_buckets);
+    }
+    result = std::move(str);
+    return result.c_str();
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+size_t SeqLockCache<real_type, cache_size_N, str_capacity, format_policy, enable>::size(
+        const CacheType& t) const
+{
+    return m_store.size(t);
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+bool SeqLockCache<real_type, cache_size_N, str_capacity, format_policy, enable>::empty(
+        const CacheType& t) const
+{
+    return size(t) == 0;
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+void SeqLockCache<real_type, cache_size_N, str_capacity, format_policy, enable>::clear(
+        const CacheType& t)
+{
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    m_store.clear(t);
+}
+
+}
+
+#endif
@@ -0,0 +1,419 @@
+#ifndef LEXICAL_CACHE_SET_ASSOCIATIVE_CACHE_H_INCLUDED
+#define LEXICAL_CACHE_SET_ASSOCIATIVE_CACHE_H_INCLUDED
+
+#include "lexical_cache.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+
+namespace lexical_cache
+{
+
+// Cache for large capacities: the hash of a key picks one of Sets sets, and
+// the key can only be cached in one of that set's Ways entries. there's no
+// index besides the hash, each set runs its own eviction_policy over its
+// ways, so a lookup or an eviction never looks at more than Ways entries.
+//
+// a set holds its ways' tags, lengths and reals, one or two cache lines for
+// up to 8 ways. their strings are kept apart, in an array indexed by set
+// and way, so a lookup only touches the string of a way whose tag or real
+// matches. strings of str_capacity chars or more are converted but not
+// cached.
+//
+// reals are placed by their UlpBucketIndex bucket and looked up in every
+// bucket that may hold an almost equal real, see UlpBucketIndex
+template <
+    typename real_type,
+    int Sets=1024,
+    int Ways=8,
+    int str_capacity=32,
+    typename lock_policy=NoLock,
+    typename eviction_policy=ClockEviction,
+    typename format_policy=ShortestFormat,
+    typename enable=
+        typename std::enable_if<std::is_floating_point<real_type>::value>::type
+    >
+class SetAssociativeCache
+{
+public:
+    static_assert(Sets > 0, "need at least one set");
+    static_assert(Ways >= 1 && Ways <= 16, "a set holds 1 to 16 ways");
+    static_assert(str_capacity > 1 && str_capacity < 256,
+            "the string length has to fit in a byte");
+
+    SetAssociativeCache() = default;
+
+    // str doesn't have to be null terminated, see Cache::castToReal
+    real_type castToReal(std::string_view str);
+
+    real_type castToReal(const char* str, size_t len)
+    {
+        return castToReal(std::string_view(str, len));
+    }
+
+    // unless lock_policy::copy_result, the returned string lives in the cache
+    // until it's evicted (until the next castToStr call if it's too long to
+    // be cached), otherwise it's copied to a thread local buffer and lives
+    // until the next castToStr call on this thread
+    const char* castToStr(const real_type& real);
+
+    size_t size(const CacheType& t=Both) const;
+    bool   empty(const CacheType& t=Both) const;
+    void   clear(const CacheType& t=Both);
+
+    double missRatio() const
+    {
+        const auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        return cache.missRatioUnlocked();
+    }
+
+    void resetStats()
+    {
+        auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        cache.m_cacheMiss = 0;
+        cache.m_cacheHit = 0;
+    }
+
+    long hitCount() const
+    {
+        const auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        return cache.m_cacheHit;
+    }
+
+    long missCount() const
+    {
+        const auto& cache = lock_policy::select(*this);
+        Guard lock(cache.m_mutex);
+        return cache.m_cacheMiss;
+    }
+
+    friend std::ostream& operator << (std::ostream& os,
+            const SetAssociativeCache& self)
+    {
+        const auto& cache = lock_policy::select(self);
+        Guard lock(cache.m_mutex);
+
+        os << "Real cached: \n";
+        for (int s = 0; s < Sets; ++s) {
+            const auto& set = cache.m_reals[s];
+            for (int w = 0; w < set.m_used; ++w) {
+                os << "set: " << s << ", real: " << set.m_values[w]
+                   << ", string: \"" << cache.m_realsStrs[s][w].data()
+                   << "\"\n";
+            }
+        }
+        os << "String cached: \n";
+        for (int s = 0; s < Sets; ++s) {
+            const auto& set = cache.m_strings[s];
+            for (int w = 0; w < set.m_used; ++w) {
+                os << "set: " << s << ", real: " << set.m_values[w]
+                   << ", string: \"" << cache.m_stringsStrs[s][w].data()
+                   << "\"\n";
+            }
+        }
+        os << "cache miss ratio: " << cache.missRatioUnlocked() << "%\n";
+        return os;
+    }
+
+private:
+    using Guard = std::lock_guard<typename lock_policy::mutex_type>;
+    using EvictionState = typename eviction_policy::template State<Ways>;
+    using bucket_type = typename UlpBucketIndex<real_type>::bucket_type;
+
+    // a set's strings, by way
+    using SetStrs = std::array<std::array<char, str_capacity>, Ways>;
+
+    struct alignas(64) Set
+    {
+        EvictionState                     m_eviction;
+        int                               m_used = 0;
+        // a byte of the string's hash, unused by the real -> string sets
+        std::array<uint8_t, Ways>         m_tags;
+        std::array<uint8_t, Ways>         m_lengths;
+        std::array<real_type, Ways>       m_values;
+
+        // the way to write a new entry to
+        int allocate()
+        {
+            if (m_used < Ways) {
+                m_eviction.insert(m_used);
+                return m_used++;
+            }
+            const int way = m_eviction.victim();
+            m_eviction.replace(way);
+            return way;
+        }
+
+        void clear()
+        {
+            m_eviction.clear();
+            m_used = 0;
+        }
+    };
+
+    static int setOf(uint64_t hash)
+    {
+        return static_cast<int>((hash >> 8) % Sets);
+    }
+
+    static uint8_t tagOf(uint64_t hash)
+    {
+        return static_cast<uint8_t>(hash);
+    }
+
+    static uint64_t bucketHash(bucket_type bucket)
+    {
+        return mix64(static_cast<uint64_t>(bucket));
+    }
+
+    double missRatioUnlocked() const
+    {
+        return static_cast<double>(m_cacheMiss) / (m_cacheHit + m_cacheMiss)*100;
+    }
+
+    size_t count(const std::array<Set, Sets>& sets) const
+    {
+        size_t total = 0;
+        for (const auto& set : sets) {
+            total += set.m_used;
+        }
+        return total;
+    }
+
+    real_type lookupReal(std::string_view str);
+    const char* lookupStr(const real_type& real);
+
+    std::array<Set, Sets>                 m_reals;
+    std::array<Set, Sets>                 m_strings;
+    std::array<SetStrs, Sets>             m_realsStrs;
+    std::array<SetStrs, Sets>             m_stringsStrs;
+    // castToStr result when it's too long to be cached
+    std::string                           m_uncached;
+    // only used for bucketOf() and forEachBucket(), never holds entries
+    UlpBucketIndex<real_type>             m_buckets;
+
+    mutable typename lock_policy::mutex_type m_mutex;
+    // ThreadLocal keeps the object's instances in m_mutex
+    friend lock_policy;
+
+    long                                  m_cacheHit = 0;
+    long                                  m_cacheMiss = 0;
+};
+
+template <
+    typename real_type,
+    int Sets,
+    int Ways,
+    int str_capacity,
+    typename lock_policy,
+    typename eviction_policy,
+    typename format_policy,
+    typename enable
+    >
+real_type
+SetAssociativeCache<real_type, Sets, Ways, str_capacity, lock_policy, eviction_policy, format_policy, enable>::castToReal(std::string_view str)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    return cache.lookupReal(str);
+}
+
+template <
+    typename real_type,
+    int Sets,
+    int Ways,
+    int str_capacity,
+    typename lock_policy,
+    typename eviction_policy,
+    typename format_policy,
+    typename enable
+    >
+const char*
+SetAssociativeCache<real_type, Sets, Ways, str_capacity, lock_policy, eviction_policy, format_policy, enable>::castToStr(const real_type& real)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+    if (!lock_policy::copy_result) {
+        return cache.lookupStr(real);
+    }
+
+    static thread_local std::string result;
+    result.assign(cache.lookupStr(real));
+    return result.c_str();
+}
+
+template <
+    typename real_type,
+    int Sets,
+    int Ways,
+    int str_capacity,
+    typename lock_policy,
+    typename eviction_policy,
+    typename format_policy,
+    typename enable
+    >
+real_type
+SetAssociativeCache<real_type, Sets, Ways, str_capacity, lock_policy, eviction_policy, format_policy, enable>::lookupReal(std::string_view str)
+{
+    const auto hash = hashBytes(str.data(), str.size());
+    const auto tag = tagOf(hash);
+    const int s = setOf(hash);
+    auto& set = m_reals[s];
+    auto& strs = m_realsStrs[s];
+    for (int w = 0; w < set.m_used; ++w) {
+        if (set.m_tags[w] == tag && set.m_lengths[w] == str.size()
+                && memcmp(strs[w].data(), str.data(), str.size()) == 0) {
+            ++m_cacheHit;
+            set.m_eviction.touch(w);
+            return set.m_values[w];
+        }
+    }
+
+    ++m_cacheMiss;
+    // convert first, if str isn't a number nothing is evicted
+    const real_type fp = stringToReal<real_type>(str);
+    if (str.size() >= str_capacity) {
+        return fp;
+    }
+
+    const int way = set.allocate();
+    set.m_tags[way] = tag;
+    set.m_lengths[way] = str.size();
+    set.m_values[way] = fp;
+    memcpy(strs[way].data(), str.data(), str.size());
+    strs[way][str.size()] = '\0';
+    return fp;
+}
+
+template <
+    typename real_type,
+    int Sets,
+    int Ways,
+    int str_capacity,
+    typename lock_policy,
+    typename eviction_policy,
+    typename format_policy,
+    typename enable
+    >
+const char*
+SetAssociativeCache<real_type, Sets, Ways, str_capacity, lock_policy, eviction_policy, format_policy, enable>::lookupStr(const real_type& real)
+{
+    using compare_type = typename UlpBucketIndex<real_type>::compare_type;
+    const compare_type x = real;
+
+    const char* found = nullptr;
+    m_buckets.forEachBucket(real, [&](bucket_type bucket) {
+            if (found) {
+                return;
+            }
+            const int s = setOf(bucketHash(bucket));
+            auto& set = m_strings[s];
+            for (int w = 0; w < set.m_used; ++w) {
+                if (useful::almostEqual(
+                            static_cast<compare_type>(set.m_values[w]), x)) {
+                    set.m_eviction.touch(w);
+                    found = m_stringsStrs[s][w].data();
+                    return;
+                }
+            }
+        });
+    if (found) {
+        ++m_cacheHit;
+        return found;
+    }
+
+    ++m_cacheMiss;
+    const int s = setOf(bucketHash(m_buckets.bucketOf(real)));
+    auto& set = m_strings[s];
+    char buf[str_capacity];
+    const int n = realToString<format_policy>(real, buf, str_capacity);
+    if (n >= str_capacity) {
+        realToString<format_policy>(real, m_uncached);
+        return m_uncached.c_str();
+    }
+
+    const int way = set.allocate();
+    set.m_lengths[way] = n;
+    set.m_values[way] = real;
+    memcpy(m_stringsStrs[s][way].data(), buf, n + 1);
+    return m_stringsStrs[s][way].data();
+}
+
+template <
+    typename real_type,
+    int Sets,
+    int Ways,
+    int str_capacity,
+    typename lock_policy,
+    typename eviction_policy,
+    typename format_policy,
+    typename enable
+    >
+size_t SetAssociativeCache<real_type, Sets, Ways, str_capacity, lock_policy, eviction_policy, format_policy, enable>::size(const CacheType& t) const
+{
+    const auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+
+    if (t == String2Real) {
+        return cache.count(cache.m_reals);
+    }
+    else if (t == Real2String) {
+        return cache.count(cache.m_strings);
+    }
+    else {
+        return cache.count(cache.m_reals) + cache.count(cache.m_strings);
+    }
+}
+
+template <
+    typename real_type,
+    int Sets,
+    int Ways,
+    int str_capacity,
+    typename lock_policy,
+    typename eviction_policy,
+    typename format_policy,
+    typename enable
+    >
+bool SetAssociativeCache<real_type, Sets, Ways, str_capacity, lock_policy, eviction_policy, format_policy, enable>::empty(const CacheType& t) const
+{
+    return size(t) == 0;
+}
+
+template <
+    typename real_type,
+    int Sets,
+    int Ways,
+    int str_capacity,
+    typename lock_policy,
+    typename eviction_policy,
+    typename format_policy,
+    typename enable
+    >
+void SetAssociativeCache<real_type, Sets, Ways, str_capacity, lock_policy, eviction_policy, format_policy, enable>::clear(const CacheType& t)
+{
+    auto& cache = lock_policy::select(*this);
+    Guard lock(cache.m_mutex);
+
+    if (t == String2Real || t == Both) {
+        for (auto& set : cache.m_reals) {
+            set.clear();
+        }
+    }
+
+    if (t == Real2String || t == Both) {
+        for (auto& set : cache.m_strings) {
+            set.clear();
+        }
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef LEXICAL_CACHE_SHARDED_CACHE_H_INCLUDED
+#define LEXICAL_CACHE_SHARDED_CACHE_H_INCLUDED
+
+#include "lexical_cache.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace lexical_cache
+{
+
+struct ShardStats
+{
+    long m_hits = 0;
+    long m_misses = 0;
+
+    double missRatio() const
+    {
+        return static_cast<double>(m_misses) / (m_hits + m_misses)*100;
+    }
+};
+
+// thread safe Cache made of shard_count independently locked Caches, a key
+// is routed to a shard by its hash, so threads only contend when they hit
+// the same shard.
+//
+// strings are routed by their hash, reals by their UlpBucketIndex bucket, so
+// reals that are almost equal normally go to the same shard. the rare pair
+// straddling a bucket boundary may be cached twice, in two shards, but both
+// entries convert correctly.
+//
+// cache_size_N is the total size, split evenly between shards.
+template <
+    typename real_type,
+    int cache_size_N=64,
+    int shard_count=8
+    >
+class ShardedCache
+{
+public:
+    static_assert(shard_count > 0, "need at least one shard");
+    static_assert(cache_size_N >= shard_count,
+            "need at least one entry per shard");
+
+    static constexpr int shard_size_N =
+        (cache_size_N + shard_count - 1) / shard_count;
+
+    using ShardCache = Cache<real_type, shard_size_N, MutexLock>;
+
+    ShardedCache() = default;
+
+    // shards hold mutexes, not copyable nor movable
+    ShardedCache(const ShardedCache&) = delete;
+    ShardedCache& operator=(const ShardedCache&) = delete;
+
+    real_type castToReal(std::string_view str);
+
+    real_type castToReal(const char* str, size_t len)
+    {
+        return castToReal(std::string_view(str, len));
+    }
+
+    // the returned string is copied to a thread local buffer while the shard
+    // is locked, see MutexLock
+    const char* castToStr(const real_type& real);
+    const char* castToStr(const real_type& real, const RealFormat& format);
+
+    size_t size(const CacheType& t=Both) const;
+    bool   empty(const CacheType& t=Both) const;
+    void   clear(const CacheType& t=Both);
+
+    ShardStats shardStats(int shard) const;
+    ShardStats stats() const;
+
+    double missRatio() const
+    {
+        return stats().missRatio();
+    }
+
+    void resetStats();
+
+    int shardOf(std::string_view str) const
+    {
+        return route(CstrHash()(str));
+    }
+
+    int shardOf(const real_type& real) const
+    {
+        return route(static_cast<uint64_t>(m_buckets.bucketOf(real)));
+    }
+
+private:
+    // a cache line each, so locking one shard doesn't invalidate the line
+    // holding its neighbour's mutex
+    struct alignas(64) Shard
+    {
+        ShardCache                        m_cache;
+    };
+
+    static int route(uint64_t hash)
+    {
+        // fibonacci hashing, the low bits of CstrHash are poorly mixed
+        return static_cast<int>(
+                ((hash * 0x9E3779B97F4A7C15ull) >> 32) % shard_count);
+    }
+
+    std::array<Shard, shard_count>        m_shards;
+    // only used for bucketOf(), never holds entries
+    UlpBucketIndex<real_type>             m_buckets;
+};
+
+template <typename real_type, int cache_size_N, int shard_count>
+real_type
+ShardedCache<real_type, cache_size_N, shard_count>::castToReal(
+        std::string_view str)
+{
+    return m_shards[shardOf(str)].m_cache.castToReal(str);
+}
+
+template <typename real_type, int cache_size_N, int shard_count>
+const char*
+ShardedCache<real_type, cache_size_N, shard_count>::castToStr(
+        const real_type& real)
+{
+    return m_shards[shardOf(real)].m_cache.castToStr(real);
+}
+
+template <typename real_type, int cache_size_N, int shard_count>
+const char*
+ShardedCache<real_type, cache_size_N, shard_count>::castToStr(
+        const real_type& real, const RealFormat& format)
+{
+    return m_shards[shardOf(real)].m_cache.castToStr(real, format);
+}
+
+template <typename real_type, int cache_size_N, int shard_count>
+size_t ShardedCache<real_type, cache_size_N, shard_count>::size(
+        const CacheType& t) const
+{
+    size_t total = 0;
+    for (const auto& shard : m_shards) {
+        total += shard.m_cache.size(t);
+    }
+    return total;
+}
+
+template <typename real_type, int cache_size_N, int shard_count>
+bool ShardedCache<real_type, cache_size_N, shard_count>::empty(
+        const CacheType& t) const
+{
+    for (const auto& shard : m_shards) {
+        if (!shard.m_cache.empty(t)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename real_type, int cache_size_N, int shard_count>
+void ShardedCache<real_type, cache_size_N, shard_count>::clear(
+        const CacheType& t)
+{
+    for (auto& shard : m_shards) {
+        shard.m_cache.clear(t);
+    }
+}
+
+template <typename real_type, int cache_size_N, int shard_count>
+ShardStats ShardedCache<real_type, cache_size_N, shard_count>::shardStats(
+        int shard) const
+{
+    assert(shard >= 0 && shard < shard_count);
+
+    // one snapshot under the shard's lock, hits and misses of the same
+    // moment
+    const auto snapshot = m_shards[shard].m_cache.stats();
+    ShardStats stats;
+    stats.m_hits = snapshot.hits();
+    stats.m_misses = snapshot.misses();
+    return stats;
+}
+
+template <typename real_type, int cache_size_N, int shard_count>
+ShardStats ShardedCache<real_type, cache_size_N, shard_count>::stats() const
+{
+    ShardStats total;
+    for (int i = 0; i < shard_count; ++i) {
+        auto stats = shardStats(i);
+        total.m_hits += stats.m_hits;
+        total.m_misses += stats.m_misses;
+    }
+    return total;
+}
+
+template <typename real_type, int cache_size_N, int shard_count>
+void ShardedCache<real_type, cache_size_N, shard_count>::resetStats()
+{
+    for (auto& shard : m_shards) {
+        shard.m_cache.resetStats();
+    }
+}
+
+}
+
+#endif
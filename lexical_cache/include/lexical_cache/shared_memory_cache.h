@@ -0,0 +1,489 @@
+#ifndef LEXICAL_CACHE_SHARED_MEMORY_CACHE_H_INCLUDED
+#define LEXICAL_CACHE_SHARED_MEMORY_CACHE_H_INCLUDED
+
+#include "seqlock_cache.h"
+#include "striped_counter.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <cerrno>
+#include <cstdint>
+
+namespace lexical_cache
+{
+
+// where a SharedMemoryCache lives: a POSIX shared memory object, named like
+// "/prices", or a file that's mapped, e.g. on a tmpfs
+enum SharedRegion {
+    PosixShm = 0,
+    MappedFile,
+};
+
+namespace detail
+{
+
+// a process shared mutex that survives its owner's death: the next lock()
+// gets it anyway and returns true, the owner may have left what it guards
+// half updated
+class RobustMutex
+{
+public:
+    // once, by whoever sets the region up
+    void init()
+    {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&m_mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+    }
+
+    bool lock()
+    {
+        const int rc = pthread_mutex_lock(&m_mutex);
+        if (rc == EOWNERDEAD) {
+            pthread_mutex_consistent(&m_mutex);
+            return true;
+        }
+        if (rc != 0) {
+            throw std::system_error(rc, std::generic_category(),
+                    "RobustMutex::lock");
+        }
+        return false;
+    }
+
+    void unlock() { pthread_mutex_unlock(&m_mutex); }
+
+private:
+    pthread_mutex_t                       m_mutex;
+};
+
+// a region's first word: how far it's set up, and in the high 32 bits the
+// pid of the process that set it up or is doing so, so that if it dies
+// half way another can tell and take over
+enum RegionState : uint32_t {
+    // zero filled, as a new region is
+    Unset = 0,
+    SettingUp,
+    Ready,
+};
+
+inline uint64_t regionState(pid_t pid, RegionState state)
+{
+    return static_cast<uint64_t>(pid) << 32 | state;
+}
+
+// kill() only checks, ESRCH is no such process. a process in another pid
+// namespace can't be told apart from a dead one, the region must be shared
+// within one
+inline bool processAlive(pid_t pid)
+{
+    return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+// what the processes sharing a region must agree on
+struct SharedLayout
+{
+    uint32_t m_version;
+    uint32_t m_regionSize;
+    uint32_t m_realSize;
+    uint32_t m_realDigits;
+    uint32_t m_cacheSize;
+    uint32_t m_strCapacity;
+    uint32_t m_formatKey;
+
+    bool operator == (const SharedLayout& other) const
+    {
+        return m_version == other.m_version
+            && m_regionSize == other.m_regionSize
+            && m_realSize == other.m_realSize
+            && m_realDigits == other.m_realDigits
+            && m_cacheSize == other.m_cacheSize
+            && m_strCapacity == other.m_strCapacity
+            && m_formatKey == other.m_formatKey;
+    }
+};
+
+}
+
+// SeqLockCache shared between processes: the workers on a box map the same
+// region, one's miss is a hit for all the others and there's one copy of
+// the entries rather than one per process.
+//
+// the region is a SeqLockStore, fixed arrays of atomic words indexed by slot
+// number, no pointer, so it can be mapped anywhere in each process. reads
+// are lock free, as in SeqLockCache. writers take a robust process shared
+// mutex in the region, if a process dies holding it the next writer clears
+// the cache, which may have been left half updated, and carries on.
+//
+// the first process to map the region sets it up, the others wait for it,
+// or do it themselves if it died before it was done. they must all use the
+// same template arguments, a region set up with others throws
+// std::runtime_error. the region outlives the processes, see
+// remove(). hit and miss counts are the calling process'
+template <
+    typename real_type,
+    int cache_size_N=64,
+    int str_capacity=32,
+    typename format_policy=ShortestFormat,
+    typename enable=
+        typename std::enable_if<std::is_floating_point<real_type>::value>::type
+    >
+class SharedMemoryCache
+{
+public:
+    // maps name, creating it if it's not there yet. throws std::system_error
+    // if it can't be opened or mapped
+    explicit SharedMemoryCache(const std::string& name,
+            SharedRegion region=PosixShm);
+    ~SharedMemoryCache();
+
+    SharedMemoryCache(const SharedMemoryCache&) = delete;
+    SharedMemoryCache& operator=(const SharedMemoryCache&) = delete;
+
+    // the region goes away once every process has unmapped it. false if
+    // there was none
+    static bool remove(const std::string& name, SharedRegion region=PosixShm)
+    {
+        return (region == PosixShm ? shm_unlink(name.c_str())
+                : unlink(name.c_str())) == 0;
+    }
+
+    // str doesn't have to be null terminated, see Cache::castToReal
+    real_type castToReal(std::string_view str);
+
+    real_type castToReal(const char* str, size_t len)
+    {
+        return castToReal(std::string_view(str, len));
+    }
+
+    // valid until the next castToStr call on this thread, see SeqLockCache
+    const char* castToStr(const real_type& real);
+
+    size_t size(const CacheType& t=Both) const;
+    bool   empty(const CacheType& t=Both) const;
+    // for every process
+    void   clear(const CacheType& t=Both);
+
+    double missRatio() const
+    {
+        const long miss = missCount();
+        return static_cast<double>(miss) / (hitCount() + miss)*100;
+    }
+
+    void resetStats()
+    {
+        m_cacheHit.reset();
+        m_cacheMiss.store(0, std::memory_order_relaxed);
+    }
+
+    long hitCount() const { return m_cacheHit.load(); }
+    long missCount() const { return m_cacheMiss.load(std::memory_order_relaxed); }
+
+private:
+    using Store = detail::SeqLockStore<real_type, cache_size_N, str_capacity>;
+
+    static constexpr uint32_t Version = 2;
+    // how long to wait for another process to set the region up
+    static constexpr int SetUpTimeoutMs = 5000;
+
+    struct Region
+    {
+        std::atomic<uint64_t>             m_state;
+        detail::SharedLayout              m_layout;
+        detail::RobustMutex               m_writeMutex;
+        Store                             m_store;
+    };
+
+    static detail::SharedLayout layout()
+    {
+        return detail::SharedLayout{Version, sizeof(Region),
+            sizeof(real_type), std::numeric_limits<real_type>::digits,
+            cache_size_N, str_capacity, format_policy::key()};
+    }
+
+    // holds the region's write lock, clears the store if its last holder
+    // died
+    class WriteGuard
+    {
+    public:
+        explicit WriteGuard(Region& region) : m_region(region)
+        {
+            if (m_region.m_writeMutex.lock()) {
+                m_region.m_store.clear(Both);
+            }
+        }
+
+        ~WriteGuard() { m_region.m_writeMutex.unlock(); }
+
+        WriteGuard(const WriteGuard&) = delete;
+        WriteGuard& operator=(const WriteGuard&) = delete;
+
+    private:
+        Region&                           m_region;
+    };
+
+    // sets the region up or waits for whoever does
+    void attach(const std::string& name);
+    // by the process whose pid is in m_state
+    void setUp();
+
+    Region*                               m_region = nullptr;
+    // only used for its bucketing, never holds entries
+    UlpBucketIndex<real_type>             m_buckets;
+
+    StripedCounter<>                      m_cacheHit;
+    std::atomic<long>                     m_cacheMiss{0};
+};
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+SharedMemoryCache<real_type, cache_size_N, str_capacity, format_policy, enable>::SharedMemoryCache(
+        const std::string& name, SharedRegion region)
+{
+    const int fd = region == PosixShm
+        ? shm_open(name.c_str(), O_RDWR | O_CREAT, 0600)
+        : open(name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                "SharedMemoryCache: can't open " + name);
+    }
+
+    // all the processes size it the same, unless their layouts differ,
+    // which attach() tells
+    struct stat st;
+    if (fstat(fd, &st) != 0
+            || (st.st_size < static_cast<off_t>(sizeof(Region))
+                && ftruncate(fd, sizeof(Region)) != 0)) {
+        const int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(),
+                "SharedMemoryCache: can't size " + name);
+    }
+
+    void* p = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (p == MAP_FAILED) {
+        throw std::system_error(error, std::generic_category(),
+                "SharedMemoryCache: can't map " + name);
+    }
+    m_region = static_cast<Region*>(p);
+
+    try {
+        attach(name);
+    }
+    catch (...) {
+        munmap(m_region, sizeof(Region));
+        throw;
+    }
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+SharedMemoryCache<real_type, cache_size_N, str_capacity, format_policy, enable>::~SharedMemoryCache()
+{
+    munmap(m_region, sizeof(Region));
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+void SharedMemoryCache<real_type, cache_size_N, str_capacity, format_policy, enable>::attach(
+        const std::string& name)
+{
+    using namespace detail;
+
+    const uint64_t claimed = regionState(getpid(), SettingUp);
+    uint64_t state = Unset;
+    if (m_region->m_state.compare_exchange_strong(state, claimed,
+                std::memory_order_acquire)) {
+        setUp();
+        return;
+    }
+
+    for (int waited = 0; static_cast<uint32_t>(state) != Ready; ++waited) {
+        // whoever was setting it up died, the one process to swap its pid
+        // for its own starts over
+        if (static_cast<uint32_t>(state) == SettingUp
+                && !processAlive(static_cast<pid_t>(state >> 32))
+                && m_region->m_state.compare_exchange_strong(state, claimed,
+                    std::memory_order_acquire)) {
+            setUp();
+            return;
+        }
+        if (waited == SetUpTimeoutMs) {
+            throw std::runtime_error(
+                    "SharedMemoryCache: " + name + " was never set up");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        state = m_region->m_state.load(std::memory_order_acquire);
+    }
+    if (!(m_region->m_layout == layout())) {
+        throw std::runtime_error("SharedMemoryCache: " + name
+                + " holds a cache of other template arguments");
+    }
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+void SharedMemoryCache<real_type, cache_size_N, str_capacity, format_policy, enable>::setUp()
+{
+    new (&m_region->m_store) Store();
+    m_region->m_store.clear(Both);
+    m_region->m_writeMutex.init();
+    m_region->m_layout = layout();
+    m_region->m_state.store(detail::regionState(getpid(), detail::Ready),
+            std::memory_order_release);
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+real_type
+SharedMemoryCache<real_type, cache_size_N, str_capacity, format_policy, enable>::castToReal(
+        std::string_view str)
+{
+    auto& store = m_region->m_store;
+    const auto hash = Store::strHash(str.data(), str.size());
+    real_type real;
+    if (store.findReal(str, hash, real)) {
+        m_cacheHit.add();
+        return real;
+    }
+
+    // convert outside the lock, it's the slow part
+    const real_type fp = stringToReal<real_type>(str);
+
+    WriteGuard lock(*m_region);
+    if (store.findReal(str, hash, real)) {
+        // another writer, maybe in another process, got there first
+        m_cacheHit.add();
+        return real;
+    }
+
+    m_cacheMiss.fetch_add(1, std::memory_order_relaxed);
+    if (str.size() <= str_capacity) {
+        store.insertReal(str, hash, fp);
+    }
+    return fp;
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+const char*
+SharedMemoryCache<real_type, cache_size_N, str_capacity, format_policy, enable>::castToStr(
+        const real_type& real)
+{
+    static thread_local std::string result;
+
+    auto& store = m_region->m_store;
+    if (store.findStr(real, m_buckets, result)) {
+        m_cacheHit.add();
+        return result.c_str();
+    }
+
+    std::string str;
+    realToString<format_policy>(real, str);
+
+    WriteGuard lock(*m_region);
+    if (store.findStr(real, m_buckets, result)) {
+        m_cacheHit.add();
+        return result.c_str();
+    }
+
+    m_cacheMiss.fetch_add(1, std::memory_order_relaxed);
+    if (str.size() <= str_capacity) {
+        store.insertStr(str, real, m_buckets);
+    }
+    result = std::move(str);
+    return result.c_str();
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+size_t SharedMemoryCache<real_type, cache_size_N, str_capacity, format_policy, enable>::size(
+        const CacheType& t) const
+{
+    return m_region->m_store.size(t);
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+bool SharedMemoryCache<real_type, cache_size_N, str_capacity, format_policy, enable>::empty(
+        const CacheType& t) const
+{
+    return size(t) == 0;
+}
+
+template <
+    typename real_type,
+    int cache_size_N,
+    int str_capacity,
+    typename format_policy,
+    typename enable
+    >
+void SharedMemoryCache<real_type, cache_size_N, str_capacity, format_policy, enable>::clear(
+        const CacheType& t)
+{
+    WriteGuard lock(*m_region);
+    m_region->m_store.clear(t);
+}
+
+}
+
+#endif
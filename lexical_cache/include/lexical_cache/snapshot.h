@@ -0,0 +1,197 @@
+#ifndef LEXICAL_CACHE_SNAPSHOT_H_INCLUDED
+#define LEXICAL_CACHE_SNAPSHOT_H_INCLUDED
+
+#include "value_traits.h"
+
+#include <sparsehash/internal/hashtable-common.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// the file Cache::saveSnapshot writes and loadSnapshot reads, to warm a
+// cache up at startup with what it held at the last shutdown:
+//
+//   magic "LXCS", version: 2 bytes
+//   sizeof(real_type), its ValueTraits tag, the digits of a floating point
+//   type, byte order: 1 byte each. the reals are stored as they are in
+//   memory, so a snapshot only loads where these match
+//   then for String2Real, then Real2String:
+//     entry count: 4 bytes
+//     the entries, the next victim first, each:
+//       real: sizeof(real_type) bytes
+//       format key: 1 byte, see RealFormat, 0 for String2Real
+//       ParseError: 1 byte, 0 unless it's a String2Real string that isn't
+//       a number
+//       string length: 4 bytes, then the string
+//   checksum: 8 bytes, FNV-1a of all the bytes before it
+//
+// numbers are big endian, written and read with sparsehash's helpers, so
+// the file can go to anything they take: a FILE*, a std::ostream*, or a
+// type with Read() and Write() like in sparsehash's serialize()
+namespace lexical_cache
+{
+
+namespace detail
+{
+
+constexpr char SnapshotMagic[4] = {'L', 'X', 'C', 'S'};
+constexpr uint16_t SnapshotVersion = 2;
+// a longer string in a snapshot means it's not one
+constexpr uint32_t MaxSnapshotStrLength = 1 << 20;
+
+// passes everything on to STREAM and keeps the FNV-1a of it, sparsehash's
+// read_data and write_data take it as it has Read() and Write()
+template <typename STREAM>
+class ChecksumStream
+{
+public:
+    explicit ChecksumStream(STREAM* fp) : m_fp(fp) {}
+
+    size_t Read(void* data, size_t length)
+    {
+        if (!google::sparsehash_internal::read_data(m_fp, data, length)) {
+            return 0;
+        }
+        update(data, length);
+        return length;
+    }
+
+    size_t Write(const void* data, size_t length)
+    {
+        update(data, length);
+        return google::sparsehash_internal::write_data(m_fp, data, length)
+            ? length : 0;
+    }
+
+    uint64_t checksum() const { return m_checksum; }
+
+private:
+    void update(const void* data, size_t length)
+    {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < length; ++i) {
+            m_checksum = (m_checksum ^ bytes[i]) * 0x100000001b3ull;
+        }
+    }
+
+    STREAM*                               m_fp;
+    uint64_t                              m_checksum = 0xcbf29ce484222325ull;
+};
+
+template <typename real_type>
+struct SnapshotEntry
+{
+    real_type m_real;
+    uint8_t m_format;
+    uint8_t m_error;
+    std::string m_str;
+};
+
+inline bool nativeLittleEndian()
+{
+    const uint16_t one = 1;
+    return *reinterpret_cast<const uint8_t*>(&one) == 1;
+}
+
+template <typename real_type, typename OUTPUT>
+bool writeSnapshotHeader(OUTPUT* fp)
+{
+    using namespace google::sparsehash_internal;
+    return write_data(fp, SnapshotMagic, sizeof(SnapshotMagic))
+        && write_bigendian_number(fp, SnapshotVersion, 2)
+        && write_bigendian_number(fp, uint8_t(sizeof(real_type)), 1)
+        && write_bigendian_number(fp, ValueTraits<real_type>::tag(), 1)
+        && write_bigendian_number(fp, uint8_t(nativeLittleEndian()), 1);
+}
+
+// false unless it's a snapshot of this version, of real_type's
+template <typename real_type, typename INPUT>
+bool readSnapshotHeader(INPUT* fp)
+{
+    using namespace google::sparsehash_internal;
+    char magic[sizeof(SnapshotMagic)];
+    uint16_t version;
+    uint8_t size, tag, littleEndian;
+    return read_data(fp, magic, sizeof(magic))
+        && std::string_view(magic, sizeof(magic))
+            == std::string_view(SnapshotMagic, sizeof(SnapshotMagic))
+        && read_bigendian_number(fp, &version, 2)
+        && version == SnapshotVersion
+        && read_bigendian_number(fp, &size, 1)
+        && size == sizeof(real_type)
+        && read_bigendian_number(fp, &tag, 1)
+        && tag == ValueTraits<real_type>::tag()
+        && read_bigendian_number(fp, &littleEndian, 1)
+        && littleEndian == uint8_t(nativeLittleEndian());
+}
+
+template <typename real_type, typename OUTPUT>
+bool writeSnapshotEntry(OUTPUT* fp, const real_type& real, uint8_t format,
+        uint8_t error, std::string_view str)
+{
+    using namespace google::sparsehash_internal;
+    return write_data(fp, &real, sizeof(real))
+        && write_bigendian_number(fp, format, 1)
+        && write_bigendian_number(fp, error, 1)
+        && write_bigendian_number(fp, uint32_t(str.size()), 4)
+        && write_data(fp, str.data(), str.size());
+}
+
+template <typename real_type, typename INPUT>
+bool readSnapshotEntry(INPUT* fp, SnapshotEntry<real_type>& entry)
+{
+    using namespace google::sparsehash_internal;
+    uint32_t length;
+    if (!read_data(fp, &entry.m_real, sizeof(entry.m_real))
+            || !read_bigendian_number(fp, &entry.m_format, 1)
+            || !read_bigendian_number(fp, &entry.m_error, 1)
+            || !read_bigendian_number(fp, &length, 4)
+            || length > MaxSnapshotStrLength) {
+        return false;
+    }
+    entry.m_str.resize(length);
+    return read_data(fp, &entry.m_str[0], length);
+}
+
+// a direction's entries, count first, as eviction orders them
+template <typename real_type, typename OUTPUT, typename Values,
+         typename Eviction>
+bool writeSnapshotEntries(OUTPUT* fp, const Values& values,
+        const Eviction& eviction, size_t size)
+{
+    bool written = google::sparsehash_internal::write_bigendian_number(
+            fp, uint32_t(size), 4);
+    eviction.forEachByAge(static_cast<int>(size), [&](int slot) {
+        written = written && writeSnapshotEntry(fp, values[slot].m_real,
+                values[slot].m_format, values[slot].m_error,
+                values.view(slot));
+    });
+    return written;
+}
+
+template <typename real_type, typename INPUT>
+bool readSnapshotEntries(INPUT* fp,
+        std::vector<SnapshotEntry<real_type>>& entries)
+{
+    uint32_t count;
+    if (!google::sparsehash_internal::read_bigendian_number(fp, &count, 4)) {
+        return false;
+    }
+    // not reserved, count is only known to be right at the end
+    entries.clear();
+    for (uint32_t i = 0; i < count; ++i) {
+        entries.emplace_back();
+        if (!readSnapshotEntry(fp, entries.back())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,360 @@
+#ifndef LEXICAL_CACHE_STATS_POLICIES_H_INCLUDED
+#define LEXICAL_CACHE_STATS_POLICIES_H_INCLUDED
+
+#include "striped_counter.h"
+
+#include <array>
+#include <algorithm>
+#include <type_traits>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// statistics policies of Cache, what it counts. each one provides a State,
+// one per direction:
+//
+// - enabled: false if nothing is counted, Cache then has no counter at all
+//   on its hot path
+// - timed: whether lookups are timed, Cache then reads the tick counter
+//   before a lookup and reports the ticks it took
+// - recordHit(ticks), recordMiss(ticks): a lookup's outcome, ticks is -1 if
+//   it wasn't timed, e.g. a key of a batch
+// - recordInsert(): a miss was cached
+// - recordEviction(): and it replaced the victim
+// - recordRejected(): a miss the admission policy didn't cache
+// - recordBypassed(): a lookup the bypass policy sent to the conversion
+// - counts(): the counters so far, see DirectionCounts
+// - snapshot(): the counters and the latencies so far, see DirectionStats
+// - clear(): all back to 0
+namespace lexical_cache
+{
+
+namespace detail
+{
+
+// the time stamp counter on x86, it runs at a constant rate on anything
+// recent and costs about 20 cycles to read, more in a VM that traps it.
+// nanoseconds elsewhere
+inline uint64_t readTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(
+            steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+}
+
+// latencies in ticks by order of magnitude: bucket b > 0 counts the ones in
+// [2^(b-1), 2^b), bucket 0 the zeros and the last one everything above. a
+// record is an increment, so it can stay on the hot path
+class LatencyHistogram
+{
+public:
+    static constexpr int BucketCount = 40;
+
+    void record(uint64_t ticks)
+    {
+        ++m_buckets[bucketOf(ticks)];
+    }
+
+    long bucket(int b) const { return m_buckets[b]; }
+
+    // the largest latency bucket b holds
+    static uint64_t upperBound(int b)
+    {
+        return b == 0 ? 0 : (1ull << b) - 1;
+    }
+
+    long count() const
+    {
+        long total = 0;
+        for (const auto n : m_buckets) {
+            total += n;
+        }
+        return total;
+    }
+
+    // the latency fraction of the samples are under, e.g. 0.99, rounded up
+    // to a bucket's upper bound. 0 if there's no sample
+    uint64_t percentile(double fraction) const
+    {
+        const long total = count();
+        if (total == 0) {
+            return 0;
+        }
+        const long rank = std::max(1L,
+                static_cast<long>(std::ceil(fraction * total)));
+        long seen = 0;
+        for (int b = 0; b < BucketCount; ++b) {
+            seen += m_buckets[b];
+            if (seen >= rank) {
+                return upperBound(b);
+            }
+        }
+        return upperBound(BucketCount - 1);
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for (int b = 0; b < BucketCount; ++b) {
+            m_buckets[b] += other.m_buckets[b];
+        }
+    }
+
+    void clear() { m_buckets.fill(0); }
+
+private:
+    static int bucketOf(uint64_t ticks)
+    {
+        if (ticks == 0) {
+            return 0;
+        }
+        const int b = 64 - __builtin_clzll(ticks);
+        return b < BucketCount ? b : BucketCount - 1;
+    }
+
+    std::array<long, BucketCount>         m_buckets{};
+};
+
+// the counters of one direction of a cache, castToReal's or castToStr's
+struct DirectionCounts
+{
+    long m_hits = 0;
+    long m_misses = 0;
+    long m_inserts = 0;
+    long m_evictions = 0;
+    long m_rejected = 0;
+    long m_bypassed = 0;
+
+    long lookups() const { return m_hits + m_misses; }
+
+    double missRatio() const
+    {
+        return static_cast<double>(m_misses) / lookups()*100;
+    }
+
+    void merge(const DirectionCounts& other)
+    {
+        m_hits += other.m_hits;
+        m_misses += other.m_misses;
+        m_inserts += other.m_inserts;
+        m_evictions += other.m_evictions;
+        m_rejected += other.m_rejected;
+        m_bypassed += other.m_bypassed;
+    }
+};
+
+// the statistics of one direction of a cache, its counters and latencies
+struct DirectionStats : DirectionCounts
+{
+    // empty unless the stats policy is timed
+    LatencyHistogram m_hitLatency;
+    LatencyHistogram m_missLatency;
+
+    void merge(const DirectionStats& other)
+    {
+        DirectionCounts::merge(other);
+        m_hitLatency.merge(other.m_hitLatency);
+        m_missLatency.merge(other.m_missLatency);
+    }
+};
+
+// a snapshot of both directions, see Cache::stats()
+struct CacheStats
+{
+    DirectionStats m_strToReal;
+    DirectionStats m_realToStr;
+
+    long hits() const { return m_strToReal.m_hits + m_realToStr.m_hits; }
+    long misses() const
+    {
+        return m_strToReal.m_misses + m_realToStr.m_misses;
+    }
+
+    double missRatio() const
+    {
+        return static_cast<double>(misses()) / (hits() + misses())*100;
+    }
+};
+
+// nothing counted, nothing on the hot path
+struct NoStats
+{
+    class State
+    {
+    public:
+        static constexpr bool enabled = false;
+        static constexpr bool timed = false;
+
+        void recordHit(int64_t=-1) {}
+        void recordMiss(int64_t=-1) {}
+        void recordInsert() {}
+        void recordEviction() {}
+        void recordRejected() {}
+        void recordBypassed() {}
+        DirectionCounts counts() const { return DirectionCounts(); }
+        DirectionStats snapshot() const { return DirectionStats(); }
+        void clear() {}
+    };
+};
+
+namespace detail
+{
+
+class CountingStats
+{
+public:
+    static constexpr bool enabled = true;
+    static constexpr bool timed = false;
+
+    void recordHit(int64_t=-1) { ++m_counts.m_hits; }
+    void recordMiss(int64_t=-1) { ++m_counts.m_misses; }
+    void recordInsert() { ++m_counts.m_inserts; }
+    void recordEviction() { ++m_counts.m_evictions; }
+    void recordRejected() { ++m_counts.m_rejected; }
+    void recordBypassed() { ++m_counts.m_bypassed; }
+
+    const DirectionCounts& counts() const { return m_counts; }
+
+    DirectionStats snapshot() const
+    {
+        DirectionStats stats;
+        static_cast<DirectionCounts&>(stats) = m_counts;
+        return stats;
+    }
+
+    void clear() { m_counts = DirectionCounts(); }
+
+protected:
+    DirectionCounts                       m_counts;
+};
+
+// the histograms only live here, a CountStats cache doesn't carry their
+// 640 bytes per direction
+class TimedStats : public CountingStats
+{
+public:
+    static constexpr bool timed = true;
+
+    void recordHit(int64_t ticks=-1)
+    {
+        ++m_counts.m_hits;
+        if (ticks >= 0) {
+            m_hitLatency.record(ticks);
+        }
+    }
+
+    void recordMiss(int64_t ticks=-1)
+    {
+        ++m_counts.m_misses;
+        if (ticks >= 0) {
+            m_missLatency.record(ticks);
+        }
+    }
+
+    DirectionStats snapshot() const
+    {
+        DirectionStats stats = CountingStats::snapshot();
+        stats.m_hitLatency = m_hitLatency;
+        stats.m_missLatency = m_missLatency;
+        return stats;
+    }
+
+    void clear()
+    {
+        CountingStats::clear();
+        m_hitLatency.clear();
+        m_missLatency.clear();
+    }
+
+private:
+    LatencyHistogram                      m_hitLatency;
+    LatencyHistogram                      m_missLatency;
+};
+
+}
+
+// plain counters, an increment or two per lookup
+struct CountStats
+{
+    using State = detail::CountingStats;
+};
+
+// CountStats, and the latencies of hits and misses, misses include the
+// conversion. two tick counter reads per lookup, which may double the cost
+// of a hit, it's for finding out where the time goes rather than for
+// production
+struct LatencyStats
+{
+    using State = detail::TimedStats;
+};
+
+// CountStats for caches shared between threads: the hits and misses, which
+// every lookup writes, are StripedCounters, so a lookup only writes its own
+// thread's stripe, never a line another thread's lookups write or read.
+// counts() adds the stripes up, exact even when threads share a stripe.
+// the other counters are only written on a miss, which writes the shared
+// index anyway, they stay plain
+template <int stripe_count=16>
+struct StripedStats
+{
+    class State
+    {
+    public:
+        static constexpr bool enabled = true;
+        static constexpr bool timed = false;
+
+        void recordHit(int64_t=-1) { m_hits.add(); }
+        void recordMiss(int64_t=-1) { m_misses.add(); }
+        void recordInsert() { ++m_counts.m_inserts; }
+        void recordEviction() { ++m_counts.m_evictions; }
+        void recordRejected() { ++m_counts.m_rejected; }
+        void recordBypassed() { ++m_counts.m_bypassed; }
+
+        DirectionCounts counts() const
+        {
+            DirectionCounts counts = m_counts;
+            counts.m_hits = m_hits.load();
+            counts.m_misses = m_misses.load();
+            return counts;
+        }
+
+        DirectionStats snapshot() const
+        {
+            DirectionStats stats;
+            static_cast<DirectionCounts&>(stats) = counts();
+            return stats;
+        }
+
+        void clear()
+        {
+            m_hits.reset();
+            m_misses.reset();
+            m_counts = DirectionCounts();
+        }
+
+    private:
+        StripedCounter<stripe_count>      m_hits;
+        StripedCounter<stripe_count>      m_misses;
+        // m_hits and m_misses unused
+        DirectionCounts                   m_counts;
+    };
+};
+
+// the default stats policy of a Cache: StripedStats if it's shared between
+// threads, i.e. if lock_policy copies results out, CountStats otherwise
+template <typename lock_policy>
+using DefaultStats = typename std::conditional<lock_policy::copy_result,
+      StripedStats<>, CountStats>::type;
+
+}
+
+#endif
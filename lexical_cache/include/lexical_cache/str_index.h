@@ -0,0 +1,395 @@
+#ifndef LEXICAL_CACHE_STR_INDEX_H_INCLUDED
+#define LEXICAL_CACHE_STR_INDEX_H_INCLUDED
+
+#include "flat_table.h"
+#include "hash_functions.h"
+
+#include <sparsehash/dense_hash_map>
+
+#include <unordered_map>
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <assert.h>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// string -> slot indexes of Cache. the keys are owned by the cache, an index
+// only keeps views of them, valid until the slot is erased:
+//
+// - find(str): slot holding str, -1 if none
+// - hash(str), prefetch(hash), find(str, hash): the same lookup in steps,
+//   a batch hashes all its keys and prefetches their buckets before finding
+//   any of them
+// - insert(key, slot): key is now cached in a slot
+// - erase(key, slot): the slot holding key is about to be reused
+// - size(), empty(), clear()
+// - forEach(f): calls f(key, slot) on every entry
+namespace lexical_cache
+{
+
+struct CstrHash;
+
+// mixes every byte of s, a word at a time
+inline uint64_t hashBytes(const char* s, size_t len)
+{
+    uint64_t h = len * 0x9e3779b97f4a7c15ull;
+    for (; len >= 8; s += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, s, 8);
+        h = (h ^ word) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    if (len > 0) {
+        uint64_t word = 0;
+        memcpy(&word, s, len);
+        h = (h ^ word) * 0xff51afd7ed558ccdull;
+    }
+    return mix64(h);
+}
+
+// node based std::unordered_map, any size
+template <typename hash_type>
+class MapStrIndex
+{
+public:
+    int find(std::string_view str) const
+    {
+        auto existing = m_map.find(str);
+        return existing != m_map.end() ? existing->second : -1;
+    }
+
+    // the node's address isn't known before the lookup, nothing to prefetch
+    uint64_t hash(std::string_view) const { return 0; }
+    void prefetch(uint64_t) const {}
+
+    int find(std::string_view str, uint64_t) const
+    {
+        return find(str);
+    }
+
+    void insert(std::string_view key, int slot)
+    {
+        m_map.emplace(key, slot);
+    }
+
+    void erase(std::string_view key, int)
+    {
+        m_map.erase(key);
+    }
+
+    size_t size() const { return m_map.size(); }
+    bool empty() const { return m_map.empty(); }
+    void clear() { m_map.clear(); }
+
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (const auto& entry : m_map) {
+            f(entry.first, entry.second);
+        }
+    }
+
+private:
+    // test shows searching in unordered map is faster than a sorted array
+    std::unordered_map<std::string_view, int,
+        hash_type, hash_type>             m_map;
+};
+
+// for small caches: a byte of the key's hash per slot, packed so that one
+// SIMD compare checks 16 (SSE2) or 32 (AVX2) slots at once. only the slots
+// whose tag matches are verified, by length then memcmp, so a hit costs a
+// hash, a couple of compares and one memcmp, with no pointer chasing
+template <int N>
+class TagStrIndex
+{
+public:
+    static_assert(N > 0 && N <= 64, "the occupied slots are a 64 bit mask");
+
+    TagStrIndex()
+    {
+        clear();
+    }
+
+    int find(std::string_view str) const
+    {
+        return find(str, hash(str));
+    }
+
+    uint64_t hash(std::string_view str) const
+    {
+        return hashBytes(str.data(), str.size());
+    }
+
+    // the tags are a cache line or two, hot already
+    void prefetch(uint64_t) const {}
+
+    int find(std::string_view str, uint64_t hash) const
+    {
+        auto candidates = match(tagOf(hash)) & m_occupied;
+        while (candidates) {
+            const int slot = __builtin_ctzll(candidates);
+            if (m_lengths[slot] == str.size()
+                    && memcmp(m_keys[slot], str.data(), str.size()) == 0) {
+                return slot;
+            }
+            candidates &= candidates - 1;
+        }
+        return -1;
+    }
+
+    void insert(std::string_view key, int slot)
+    {
+        assert(!(m_occupied & bit(slot)));
+        m_tags[slot] = tagOf(hashBytes(key.data(), key.size()));
+        m_keys[slot] = key.data();
+        m_lengths[slot] = key.size();
+        m_occupied |= bit(slot);
+        ++m_size;
+    }
+
+    void erase(std::string_view, int slot)
+    {
+        if (m_occupied & bit(slot)) {
+            m_occupied &= ~bit(slot);
+            --m_size;
+        }
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    void clear()
+    {
+        m_tags.fill(0);
+        m_occupied = 0;
+        m_size = 0;
+    }
+
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (auto slots = m_occupied; slots; slots &= slots - 1) {
+            const int slot = __builtin_ctzll(slots);
+            f(std::string_view(m_keys[slot], m_lengths[slot]), slot);
+        }
+    }
+
+private:
+    // whole 32 byte vectors, the padding tags are never occupied
+    static constexpr int TagCount = (N + 31) / 32 * 32;
+
+    static uint64_t bit(int slot)
+    {
+        return 1ull << slot;
+    }
+
+    static uint8_t tagOf(uint64_t hash)
+    {
+        return static_cast<uint8_t>(hash >> 56);
+    }
+
+    // bit i is set if m_tags[i] == tag
+    uint64_t match(uint8_t tag) const
+    {
+        uint64_t bits = 0;
+#if defined(__AVX2__)
+        const auto needle = _mm256_set1_epi8(static_cast<char>(tag));
+        for (int i = 0; i < TagCount; i += 32) {
+            const auto tags = _mm256_load_si256(
+                    reinterpret_cast<const __m256i*>(&m_tags[i]));
+            bits |= static_cast<uint64_t>(static_cast<uint32_t>(
+                        _mm256_movemask_epi8(
+                            _mm256_cmpeq_epi8(tags, needle)))) << i;
+        }
+#elif defined(__SSE2__)
+        const auto needle = _mm_set1_epi8(static_cast<char>(tag));
+        for (int i = 0; i < TagCount; i += 16) {
+            const auto tags = _mm_load_si128(
+                    reinterpret_cast<const __m128i*>(&m_tags[i]));
+            bits |= static_cast<uint64_t>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(tags, needle))) << i;
+        }
+#else
+        for (int i = 0; i < N; ++i) {
+            bits |= static_cast<uint64_t>(m_tags[i] == tag) << i;
+        }
+#endif
+        return bits;
+    }
+
+    alignas(32) std::array<uint8_t, TagCount> m_tags;
+    uint64_t                              m_occupied;
+    int                                   m_size;
+    std::array<uint32_t, N>               m_lengths;
+    std::array<const char*, N>            m_keys;
+};
+
+// google::dense_hash_map, open addressing over key pointers. erased keys
+// leave tombstones, reused by later inserts
+template <int N, typename hash_type>
+class DenseStrIndex
+{
+public:
+    DenseStrIndex()
+    {
+        m_map.set_empty_key(emptyKey());
+        m_map.set_deleted_key(deletedKey());
+        m_map.resize(N);
+    }
+
+    int find(std::string_view str) const
+    {
+        auto existing = m_map.find(str);
+        return existing != m_map.end() ? existing->second : -1;
+    }
+
+    // dense_hash_map doesn't expose its buckets, nothing to prefetch
+    uint64_t hash(std::string_view) const { return 0; }
+    void prefetch(uint64_t) const {}
+
+    int find(std::string_view str, uint64_t) const
+    {
+        return find(str);
+    }
+
+    void insert(std::string_view key, int slot)
+    {
+        m_map.insert(std::make_pair(key, slot));
+    }
+
+    void erase(std::string_view key, int)
+    {
+        m_map.erase(key);
+    }
+
+    size_t size() const { return m_map.size(); }
+    bool empty() const { return m_map.empty(); }
+    void clear() { m_map.clear_no_resize(); }
+
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (const auto& entry : m_map) {
+            f(entry.first, entry.second);
+        }
+    }
+
+private:
+    // the empty and deleted keys are views of this buffer, told apart from
+    // every key by their address: "" and "\0" are keys too, a cache holds
+    // what tryCastToReal made of them
+    static const char* sentinels()
+    {
+        static const char buffer[2] = {};
+        return buffer;
+    }
+
+    static std::string_view emptyKey()
+    {
+        return std::string_view(sentinels(), 0);
+    }
+
+    static std::string_view deletedKey()
+    {
+        return std::string_view(sentinels() + 1, 0);
+    }
+
+    struct KeyEqual
+    {
+        static bool isSentinel(std::string_view key)
+        {
+            return key.data() == sentinels() || key.data() == sentinels() + 1;
+        }
+
+        bool operator()(std::string_view a, std::string_view b) const
+        {
+            if (isSentinel(a) || isSentinel(b)) {
+                return a.data() == b.data();
+            }
+            return a == b;
+        }
+    };
+
+    google::dense_hash_map<std::string_view, int,
+        hash_type, KeyEqual>              m_map;
+};
+
+// FlatTable of the key's hash, slot and key view: a lookup is one probe
+// sequence over contiguous memory, the key is only read when the hashes match
+template <int N>
+class FlatStrIndex
+{
+public:
+    int find(std::string_view str) const
+    {
+        return find(str, hash(str));
+    }
+
+    uint64_t hash(std::string_view str) const
+    {
+        return hashOf(str);
+    }
+
+    void prefetch(uint64_t hash) const
+    {
+        m_table.prefetch(static_cast<uint32_t>(hash));
+    }
+
+    int find(std::string_view str, uint64_t hash) const
+    {
+        int found = -1;
+        m_table.find(static_cast<uint32_t>(hash), [&](const Entry& entry) {
+                if (entry.m_key != str) {
+                    return false;
+                }
+                found = entry.m_slot;
+                return true;
+            });
+        return found;
+    }
+
+    void insert(std::string_view key, int slot)
+    {
+        m_table.insert(Entry{hashOf(key), slot, key});
+    }
+
+    void erase(std::string_view key, int slot)
+    {
+        m_table.erase(hashOf(key), slot);
+    }
+
+    size_t size() const { return m_table.size(); }
+    bool empty() const { return m_table.empty(); }
+    void clear() { m_table.clear(); }
+
+    template <typename F>
+    void forEach(F f) const
+    {
+        m_table.forEach([&f](const Entry& entry) {
+                f(entry.m_key, entry.m_slot);
+            });
+    }
+
+private:
+    struct Entry
+    {
+        uint32_t m_hash;
+        int m_slot;
+        std::string_view m_key;
+    };
+
+    static uint32_t hashOf(std::string_view str)
+    {
+        return static_cast<uint32_t>(hashBytes(str.data(), str.size()));
+    }
+
+    detail::FlatTable<Entry, N>           m_table;
+};
+
+}
+
+#endif
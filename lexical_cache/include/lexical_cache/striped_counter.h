@@ -0,0 +1,61 @@
+#ifndef LEXICAL_CACHE_STRIPED_COUNTER_H_INCLUDED
+#define LEXICAL_CACHE_STRIPED_COUNTER_H_INCLUDED
+
+#include <atomic>
+#include <array>
+
+namespace lexical_cache
+{
+
+// dense index of the calling thread, assigned on first use
+inline unsigned threadIndex()
+{
+    static std::atomic<unsigned> next{0};
+    static thread_local unsigned index = next.fetch_add(1);
+    return index;
+}
+
+// counter shared between threads without sharing a cache line: each thread
+// adds to its own stripe, reading sums all stripes. threads only share a
+// stripe when there are more than stripe_count of them, the total is exact
+// either way
+template <int stripe_count=64>
+class StripedCounter
+{
+public:
+    static_assert(stripe_count > 0, "need at least one stripe");
+
+    void add(long n=1)
+    {
+        m_stripes[threadIndex() % stripe_count].m_count.fetch_add(
+                n, std::memory_order_relaxed);
+    }
+
+    long load() const
+    {
+        long total = 0;
+        for (const auto& s : m_stripes) {
+            total += s.m_count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    void reset()
+    {
+        for (auto& s : m_stripes) {
+            s.m_count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct alignas(64) Stripe
+    {
+        std::atomic<long> m_count{0};
+    };
+
+    std::array<Stripe, stripe_count>      m_stripes;
+};
+
+}
+
+#endif
@@ -0,0 +1,347 @@
+#ifndef LEXICAL_CACHE_ULP_BUCKET_INDEX_H_INCLUDED
+#define LEXICAL_CACHE_ULP_BUCKET_INDEX_H_INCLUDED
+
+#include "flat_table.h"
+#include "hash_functions.h"
+
+#include <comparefp/comparefp.h>
+
+#include <unordered_map>
+#include <type_traits>
+#include <limits>
+#include <cfloat>
+#include <cmath>
+
+namespace lexical_cache
+{
+
+// real -> index lookup that keeps the useful::almostEqual semantics without
+// scanning every entry.
+//
+// two reals are almost equal if they are within FLT_EPSILON of each other, or
+// if they have the same sign and are no more than MAX_ULPS apart. so the reals
+// matching x always lie in a small interval around x, we only need to hash
+// reals into buckets such that this interval covers a few buckets:
+//
+// - close to 0 the absolute tolerance dominates, bucket by x / FLT_EPSILON
+// - elsewhere the ulps tolerance dominates, bucket by the ordered integer
+//   representation of x, UlpsPerBucket consecutive reals per bucket
+//
+// the threshold between the two is where MAX_ULPS ulps equals FLT_EPSILON, so
+// either way a lookup probes a handful of buckets and verifies the candidates
+// with almostEqual
+template <typename real_type>
+class UlpBucketIndex
+{
+public:
+    // long double has no integer of the same size, compare it as double
+    using compare_type = typename std::conditional<
+        std::is_same<float, typename std::remove_cv<real_type>::type>::value,
+        float, double>::type;
+    using FloatingPoint = useful::FloatingPoint<compare_type>;
+    using bits_type = typename FloatingPoint::IntegerSize;
+    using bucket_type = long long;
+
+    // a bucket is as wide as the ulps tolerance, so a lookup probes two or
+    // three of them
+    static constexpr int UlpsPerBucket = FloatingPoint::MAX_ULPS;
+
+    struct Entry
+    {
+        real_type m_real;
+        int m_index;
+    };
+
+    using container_type = std::unordered_multimap<bucket_type, Entry>;
+    using const_iterator = typename container_type::const_iterator;
+
+    UlpBucketIndex()
+        : m_maxDiff(FLT_EPSILON)
+        , m_threshold(m_maxDiff / (FloatingPoint::MAX_ULPS
+                    * std::numeric_limits<compare_type>::epsilon()))
+    {
+    }
+
+    // index of the entry almost equal to real, the closest one if there are
+    // several, -1 if none
+    int find(const real_type& real) const
+    {
+        return find(real, [](int) { return true; });
+    }
+
+    // same, among the entries whose index passes accept(index), e.g. the
+    // slots holding a given format
+    template <typename predicate_type>
+    int find(const real_type& real, predicate_type accept) const;
+
+    // the nodes' addresses aren't known before the lookup, nothing to
+    // prefetch
+    void prefetch(const real_type&) const {}
+
+    void insert(const real_type& real, int index)
+    {
+        m_buckets.emplace(bucketOf(real), Entry{real, index});
+    }
+
+    // erase by index rather than by value, so NaN can be evicted too
+    bool erase(const real_type& real, int index);
+
+    size_t size() const { return m_buckets.size(); }
+    bool   empty() const { return m_buckets.empty(); }
+    void   clear() { m_buckets.clear(); }
+
+    const_iterator begin() const { return m_buckets.begin(); }
+    const_iterator end() const { return m_buckets.end(); }
+
+    // calls visit(bucket, real, index) on every entry
+    template <typename visitor_type>
+    void forEach(visitor_type visit) const
+    {
+        for (const auto& entry : m_buckets) {
+            visit(entry.first, entry.second.m_real, entry.second.m_index);
+        }
+    }
+
+    // calls visit(bucket) for every bucket that may hold a real almost equal
+    // to real, for indexes built on the same bucketing
+    template <typename visitor_type>
+    void forEachBucket(const real_type& real, visitor_type visit) const;
+
+    // the bucket real is stored in, almost equal reals are in the same or a
+    // neighbouring bucket
+    bucket_type bucketOf(compare_type real) const
+    {
+        if (!std::isfinite(real)) {
+            return std::isnan(real) ? NotFinite : ulpBucketOf(real);
+        }
+        if (std::fabs(real) < m_threshold) {
+            return absBucketOf(real);
+        }
+        return ulpBucketOf(real);
+    }
+
+private:
+    static constexpr bucket_type NotFinite =
+        std::numeric_limits<bucket_type>::min();
+
+    bucket_type absBucketOf(compare_type real) const
+    {
+        return static_cast<bucket_type>(std::floor(real / m_maxDiff));
+    }
+
+    static bucket_type ulpBucketOf(compare_type real)
+    {
+        bits_type bits = FloatingPoint(real).orderedBits();
+        bucket_type bucket = bits / UlpsPerBucket;
+        return (bits % UlpsPerBucket < 0) ? bucket - 1 : bucket;
+    }
+
+    template <typename predicate_type>
+    void probe(bucket_type bucket, compare_type real, predicate_type& accept,
+            int& found, compare_type& bestDiff) const;
+
+    compare_type                          m_maxDiff;
+    compare_type                          m_threshold;
+    container_type                        m_buckets;
+};
+
+template <typename real_type>
+template <typename predicate_type>
+int UlpBucketIndex<real_type>::find(
+        const real_type& real, predicate_type accept) const
+{
+    if (m_buckets.empty()) {
+        return -1;
+    }
+
+    const compare_type x = real;
+    int found = -1;
+    compare_type bestDiff = std::numeric_limits<compare_type>::infinity();
+    forEachBucket(real, [&](bucket_type bucket) {
+            probe(bucket, x, accept, found, bestDiff);
+        });
+    return found;
+}
+
+template <typename real_type>
+template <typename visitor_type>
+void UlpBucketIndex<real_type>::forEachBucket(
+        const real_type& real, visitor_type visit) const
+{
+    const compare_type x = real;
+    if (std::isnan(x)) {
+        return;
+    }
+
+    // all matches lie in [lo, hi], widen the absolute tolerance a little so
+    // rounding in x -/+ maxDiff can't leave a match out
+    const bits_type bits = FloatingPoint(x).orderedBits();
+    const compare_type tolerance = m_maxDiff * (1 + 1.0/1024);
+    const compare_type lo = std::fmin(x - tolerance,
+            FloatingPoint::fromOrderedBits(bits - FloatingPoint::MAX_ULPS));
+    const compare_type hi = std::fmax(x + tolerance,
+            FloatingPoint::fromOrderedBits(bits + FloatingPoint::MAX_ULPS));
+
+    // the part of [lo, hi] bucketed by absolute difference
+    const compare_type absLo = std::fmax(lo, -m_threshold);
+    const compare_type absHi = std::fmin(hi, m_threshold);
+    if (absLo <= absHi) {
+        const auto last = absBucketOf(absHi);
+        for (auto b = absBucketOf(absLo); b <= last; ++b) {
+            visit(b);
+        }
+    }
+
+    // the parts of [lo, hi] bucketed by ulps, one on each side of 0
+    if (lo <= -m_threshold) {
+        const auto last = ulpBucketOf(std::fmin(hi, -m_threshold));
+        for (auto b = ulpBucketOf(lo); b <= last; ++b) {
+            visit(b);
+        }
+    }
+    if (hi >= m_threshold) {
+        const auto last = ulpBucketOf(hi);
+        for (auto b = ulpBucketOf(std::fmax(lo, m_threshold)); b <= last; ++b) {
+            visit(b);
+        }
+    }
+}
+
+template <typename real_type>
+template <typename predicate_type>
+void UlpBucketIndex<real_type>::probe(
+        bucket_type bucket, compare_type real, predicate_type& accept,
+        int& found, compare_type& bestDiff) const
+{
+    auto range = m_buckets.equal_range(bucket);
+    for (auto it = range.first; it != range.second; ++it) {
+        const compare_type candidate = it->second.m_real;
+        if (!useful::almostEqual(candidate, real)
+                || !accept(it->second.m_index)) {
+            continue;
+        }
+        const compare_type diff = std::fabs(candidate - real);
+        if (found < 0 || diff < bestDiff) {
+            found = it->second.m_index;
+            bestDiff = diff;
+        }
+    }
+}
+
+template <typename real_type>
+bool UlpBucketIndex<real_type>::erase(
+        const real_type& real, int index)
+{
+    auto range = m_buckets.equal_range(bucketOf(real));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.m_index == index) {
+            m_buckets.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+// UlpBucketIndex over a FlatTable for at most N entries, the bucket's hash
+// and the entry are stored inline, so a lookup probes contiguous memory
+// rather than the nodes of a std::unordered_multimap, and never allocates
+template <typename real_type, int N>
+class FlatUlpBucketIndex
+{
+public:
+    using Buckets = UlpBucketIndex<real_type>;
+    using compare_type = typename Buckets::compare_type;
+    using bucket_type = typename Buckets::bucket_type;
+
+    int find(const real_type& real) const
+    {
+        return find(real, [](int) { return true; });
+    }
+
+    template <typename predicate_type>
+    int find(const real_type& real, predicate_type accept) const
+    {
+        const compare_type x = real;
+        int found = -1;
+        compare_type bestDiff = std::numeric_limits<compare_type>::infinity();
+        m_buckets.forEachBucket(real, [&](bucket_type bucket) {
+                m_table.find(hashOf(bucket), [&](const Entry& entry) {
+                        const compare_type candidate = entry.m_real;
+                        if (useful::almostEqual(candidate, x)
+                                && accept(entry.m_slot)) {
+                            const compare_type diff = std::fabs(candidate - x);
+                            if (found < 0 || diff < bestDiff) {
+                                found = entry.m_slot;
+                                bestDiff = diff;
+                            }
+                        }
+                        return false;
+                    });
+            });
+        return found;
+    }
+
+    // pulls the buckets find(real) probes into the cpu cache, for batches
+    // of lookups
+    void prefetch(const real_type& real) const
+    {
+        m_buckets.forEachBucket(real, [this](bucket_type bucket) {
+                m_table.prefetch(hashOf(bucket));
+            });
+    }
+
+    void insert(const real_type& real, int index)
+    {
+        m_table.insert(Entry{hashOf(bucketOf(real)), index, real});
+    }
+
+    bool erase(const real_type& real, int index)
+    {
+        return m_table.erase(hashOf(bucketOf(real)), index);
+    }
+
+    size_t size() const { return m_table.size(); }
+    bool   empty() const { return m_table.empty(); }
+    void   clear() { m_table.clear(); }
+
+    template <typename visitor_type>
+    void forEach(visitor_type visit) const
+    {
+        m_table.forEach([&](const Entry& entry) {
+                visit(bucketOf(entry.m_real), entry.m_real, entry.m_slot);
+            });
+    }
+
+    template <typename visitor_type>
+    void forEachBucket(const real_type& real, visitor_type visit) const
+    {
+        m_buckets.forEachBucket(real, visit);
+    }
+
+    bucket_type bucketOf(compare_type real) const
+    {
+        return m_buckets.bucketOf(real);
+    }
+
+private:
+    struct Entry
+    {
+        uint32_t m_hash;
+        int m_slot;
+        real_type m_real;
+    };
+
+    static uint32_t hashOf(bucket_type bucket)
+    {
+        // neighbouring buckets mustn't share a run
+        return static_cast<uint32_t>(mix64(static_cast<uint64_t>(bucket)));
+    }
+
+    // only used for bucketing, never holds entries
+    Buckets                               m_buckets;
+    detail::FlatTable<Entry, N>           m_table;
+};
+
+}
+
+#endif
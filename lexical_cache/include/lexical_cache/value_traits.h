@@ -0,0 +1,78 @@
+#ifndef LEXICAL_CACHE_VALUE_TRAITS_H_INCLUDED
+#define LEXICAL_CACHE_VALUE_TRAITS_H_INCLUDED
+
+#include "decimal.h"
+
+#include <limits>
+#include <type_traits>
+#include <cstdint>
+
+// the types Cache converts strings to and from, its real_type: float, double
+// and long double, the integers from short up but bool, and Decimal. their
+// strings are parsed with tryParseReal and written with the format policy's
+// format(), both overloaded for each kind. ValueTraits<T> tells Cache the
+// rest:
+//
+// - supported: whether T is one of them
+// - exact: reals are looked up by their key(), with no tolerance, see
+//   exact_index.h. floating point ones are almost equal within a few ulps,
+//   see ulp_bucket_index.h
+// - key(real): the bits of an exact real, equal keys for equal reals
+// - tag(): tells T apart from the other types of its size in a snapshot
+namespace lexical_cache
+{
+
+template <typename T, typename enable=void>
+struct ValueTraits
+{
+    static constexpr bool supported = false;
+};
+
+template <typename real_type>
+struct ValueTraits<real_type,
+    typename std::enable_if<std::is_floating_point<real_type>::value>::type>
+{
+    static constexpr bool supported = true;
+    static constexpr bool exact = false;
+
+    // the digits, which is what snapshots held before there were others
+    static constexpr uint8_t tag()
+    {
+        return std::numeric_limits<real_type>::digits;
+    }
+};
+
+template <typename int_type>
+struct ValueTraits<int_type,
+    typename std::enable_if<std::is_integral<int_type>::value
+        && !std::is_same<int_type, bool>::value
+        && sizeof(int_type) >= sizeof(short)>::type>
+{
+    static constexpr bool supported = true;
+    static constexpr bool exact = true;
+
+    static uint64_t key(int_type real) { return static_cast<uint64_t>(real); }
+
+    static constexpr uint8_t tag()
+    {
+        return 0x80 | std::numeric_limits<int_type>::digits;
+    }
+};
+
+template <typename int_type, int Scale>
+struct ValueTraits<Decimal<int_type, Scale>>
+{
+    static constexpr bool supported = true;
+    static constexpr bool exact = true;
+
+    static uint64_t key(const Decimal<int_type, Scale>& real)
+    {
+        return static_cast<uint64_t>(real.ticks());
+    }
+
+    static constexpr uint8_t tag() { return 0xe0 + Scale; }
+};
+
+}
+
+#endif
@@ -0,0 +1,57 @@
+#include <TestUtils.h>
+#include "PerfUtils.h"
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+constexpr int g_cacheSize = 64;
+
+// one-off strings in between hot ones: with nothing to stop them each one
+// evicts a hot entry, with TinyLFU they have to be seen more often than the
+// victim to get in, so the hot entries stay cached
+template <typename admission_policy>
+void testOneOffMisses(const char* name)
+{
+    constexpr int iteration = 1000*1000;
+
+    std::vector<std::string> hot;
+    for (int i = 0; i < g_cacheSize; ++i) {
+        hot.push_back(randomString(-9999.9999, 9999.9999));
+    }
+    std::mt19937 generator(std::random_device{}());
+    std::vector<std::string> testSequence;
+    testSequence.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        testSequence.push_back(i % 2 == 0 ? hot[generator() % g_cacheSize]
+                : randomString(-9999.9999, 9999.9999));
+    }
+
+    Cache<double, g_cacheSize, NoLock, LruEviction, admission_policy> cache;
+    for (const auto& str : hot) {
+        cache.castToReal(str);
+    }
+    cache.resetStats();
+    const double latency = meanLatency(testSequence,
+            [&cache](const std::string& s) { return cache.castToReal(s); });
+    std::cout << name << ", mean latency: " << latency
+        << " ns, cache miss ratio: " << cache.missRatio()
+        << "%, rejected: " << cache.rejectedCount() << std::endl;
+}
+
+TEST(AdmissionPerfTest, testOneOffMisses)
+{
+    testOneOffMisses<AdmitAll>("admit all");
+    testOneOffMisses<TinyLfuAdmission<> >("tinylfu");
+}
+
+}
@@ -0,0 +1,91 @@
+#include <TestUtils.h>
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+template <typename cache_type>
+void testBatchHit(cache_type& cache, int cacheSize, int batchSize)
+{
+    using namespace std::chrono;
+    constexpr int iteration = 1024*1024;
+
+    std::vector<std::pair<std::string, double> > pairs;
+    for (int i = 0; i < cacheSize; ++i) {
+        pairs.push_back(randomStringRealPair(-9999.9999, 9999.9999));
+        cache.castToReal(pairs.back().first);
+        cache.castToStr(pairs.back().second);
+    }
+
+    std::mt19937 generator(std::random_device{}());
+    std::uniform_int_distribution<int> distribution(0, cacheSize - 1);
+    std::vector<std::string_view> strs;
+    std::vector<double> reals;
+    strs.reserve(iteration);
+    reals.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        const auto& pair = pairs[distribution(generator)];
+        strs.push_back(pair.first);
+        reals.push_back(pair.second);
+    }
+    std::vector<double> realResults(iteration);
+    std::vector<std::string> strResults(iteration);
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < iteration; ++i) {
+        realResults[i] = cache.castToReal(strs[i]);
+    }
+    auto finish = steady_clock::now();
+    const auto realLoop = duration_cast<nanoseconds>(finish - start).count();
+
+    start = steady_clock::now();
+    for (int i = 0; i < iteration; i += batchSize) {
+        cache.castToRealBatch(&strs[i], batchSize, &realResults[i]);
+    }
+    finish = steady_clock::now();
+    const auto realBatch = duration_cast<nanoseconds>(finish - start).count();
+
+    start = steady_clock::now();
+    for (int i = 0; i < iteration; ++i) {
+        strResults[i].assign(cache.castToStr(reals[i]));
+    }
+    finish = steady_clock::now();
+    const auto strLoop = duration_cast<nanoseconds>(finish - start).count();
+
+    start = steady_clock::now();
+    for (int i = 0; i < iteration; i += batchSize) {
+        cache.castToStrBatch(&reals[i], batchSize, &strResults[i]);
+    }
+    finish = steady_clock::now();
+    const auto strBatch = duration_cast<nanoseconds>(finish - start).count();
+
+    std::cout << "cache size " << cacheSize << ", batch of " << batchSize
+        << ", castToReal loop: " << realLoop / iteration << " ns, batch: "
+        << realBatch / iteration << " ns, castToStr loop: "
+        << strLoop / iteration << " ns, batch: " << strBatch / iteration
+        << " ns" << std::endl;
+}
+
+TEST(BatchPerfTest, testHitPerformance)
+{
+    // too big for the stack, and for the cpu caches
+    constexpr int capacity = 65536;
+    static Cache<double, capacity> cache;
+    for (const int batchSize : {8, 64, 1024}) {
+        testBatchHit(cache, capacity, batchSize);
+        cache.clear();
+    }
+}
+
+}
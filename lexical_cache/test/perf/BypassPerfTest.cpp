@@ -0,0 +1,58 @@
+#include <TestUtils.h>
+#include "PerfUtils.h"
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+constexpr int g_cacheSize = 64;
+
+TEST(BypassPerfTest, testCacheInTheWrongSpot)
+{
+    constexpr int iteration = 1000*1000;
+
+    std::vector<double> misses;
+    misses.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        misses.push_back(randomReal(-9999.9999, 9999.9999));
+    }
+    std::vector<double> hits;
+    hits.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        hits.push_back(misses[i % g_cacheSize]);
+    }
+
+    char buf[64];
+    const double direct = meanLatency(misses, [&buf](double d) {
+            return ShortestFormat::format(d, buf, sizeof(buf));
+        });
+
+    Cache<double, g_cacheSize> plain;
+    Cache<double, g_cacheSize, NoLock, LruEviction, AdmitAll, 40, AutoIndex,
+          ShortestFormat, AdaptiveBypass<> > adaptive;
+    const double plainMiss = meanLatency(misses,
+            [&plain](double d) { return *plain.castToStr(d); });
+    const double adaptiveMiss = meanLatency(misses,
+            [&adaptive](double d) { return *adaptive.castToStr(d); });
+    const long bypassed = adaptive.bypassedCount();
+    const double plainHit = meanLatency(hits,
+            [&plain](double d) { return *plain.castToStr(d); });
+    const double adaptiveHit = meanLatency(hits,
+            [&adaptive](double d) { return *adaptive.castToStr(d); });
+
+    std::cout << "castToStr, direct: " << direct << " ns, all misses: "
+        << plainMiss << " ns, adaptive: " << adaptiveMiss << " ns ("
+        << bypassed * 100.0 / iteration << "% bypassed)" << std::endl;
+    std::cout << "castToStr, all hits: " << plainHit << " ns, adaptive: "
+        << adaptiveHit << " ns" << std::endl;
+    EXPECT_LT(adaptiveMiss, plainMiss);
+}
+
+}
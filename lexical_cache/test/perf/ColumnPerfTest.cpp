@@ -0,0 +1,68 @@
+#include <TestUtils.h>
+
+#include <lexical_cache/column_converter.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+TEST(ColumnPerfTest, testDictionaryEncoding)
+{
+    using namespace std::chrono;
+    constexpr int rowCount = 1000*1000;
+    constexpr int distinct = 5000;
+
+    std::vector<std::string> dictionary;
+    for (int i = 0; i < distinct; ++i) {
+        dictionary.push_back(randomString(-9999.9999, 9999.9999));
+    }
+    std::mt19937 generator(std::random_device{}());
+    std::uniform_int_distribution<int> distribution(0, distinct - 1);
+    std::vector<std::string_view> rows;
+    rows.reserve(rowCount);
+    for (int i = 0; i < rowCount; ++i) {
+        rows.push_back(dictionary[distribution(generator)]);
+    }
+
+    // the pre-pass ColumnConverter replaces
+    auto start = steady_clock::now();
+    std::unordered_map<std::string, double> parsed;
+    std::vector<double> values;
+    values.reserve(rowCount);
+    for (const auto& row : rows) {
+        std::string key(row);
+        auto existing = parsed.find(key);
+        if (existing == parsed.end()) {
+            existing = parsed.emplace(key, std::stod(key)).first;
+        }
+        values.push_back(existing->second);
+    }
+    auto finish = steady_clock::now();
+    const auto map = duration_cast<nanoseconds>(finish - start).count();
+
+    start = steady_clock::now();
+    ColumnConverter<double> converter;
+    converter.convert(rows);
+    finish = steady_clock::now();
+    const auto column = duration_cast<nanoseconds>(finish - start).count();
+
+    EXPECT_EQ(values, converter.values());
+    EXPECT_EQ(parsed.size(), converter.distinctCount());
+    std::cout << rowCount << " rows, " << distinct << " distinct"
+        << ", unordered_map<std::string, double>: " << map / rowCount
+        << " ns per row, ColumnConverter: " << column / rowCount
+        << " ns per row" << std::endl;
+    EXPECT_LT(column, map);
+}
+
+}
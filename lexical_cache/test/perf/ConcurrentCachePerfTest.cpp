@@ -0,0 +1,94 @@
+#include <TestUtils.h>
+
+#include <lexical_cache/sharded_cache.h>
+#include <lexical_cache/seqlock_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+constexpr int g_cacheSize = 256;
+constexpr int g_iteration = 100*1000;
+
+// what we do today: one mutex around one cache
+class GlobalMutexCache
+{
+public:
+    double castToReal(const std::string& str)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_cache.castToReal(str);
+    }
+
+private:
+    std::mutex                    m_mutex;
+    Cache<double, g_cacheSize>    m_cache;
+};
+
+class ConcurrentCachePerfTest : public ::testing::Test
+{
+public:
+    ConcurrentCachePerfTest()
+    {
+        for (int i = 0; i < g_cacheSize / 2; ++i) {
+            m_testStrings.push_back(randomString(-9999.9999, 9999.9999));
+        }
+    }
+
+protected:
+    std::vector<std::string> m_testStrings;
+
+    template <typename cache_type>
+    void testScaling(const char* name)
+    {
+        using namespace std::chrono;
+        for (int threadCount = 1; threadCount <= 32; threadCount *= 2) {
+            cache_type cache;
+            std::vector<std::thread> threads;
+
+            auto start = std::chrono::steady_clock::now();
+            for (int t = 0; t < threadCount; ++t) {
+                threads.emplace_back([this, &cache, t]() {
+                    const auto n = m_testStrings.size();
+                    for (int i = 0; i < g_iteration; ++i) {
+                        cache.castToReal(m_testStrings[(i * 7 + t) % n]);
+                    }
+                });
+            }
+            for (auto& t : threads) {
+                t.join();
+            }
+            auto finish = std::chrono::steady_clock::now();
+
+            auto ns = duration_cast<nanoseconds>(finish - start).count();
+            std::cout << name << ", threads: " << threadCount
+                << ", throughput: "
+                << 1000.0 * threadCount * g_iteration / ns
+                << " Mops/s" << std::endl;
+        }
+    }
+};
+
+TEST_F(ConcurrentCachePerfTest, testGlobalMutexScaling)
+{
+    this->testScaling<GlobalMutexCache>("global mutex");
+}
+
+TEST_F(ConcurrentCachePerfTest, testShardedScaling)
+{
+    this->testScaling< ShardedCache<double, g_cacheSize, 16> >("sharded");
+}
+
+TEST_F(ConcurrentCachePerfTest, testSeqLockScaling)
+{
+    this->testScaling< SeqLockCache<double, g_cacheSize> >("seqlock");
+}
+
+}
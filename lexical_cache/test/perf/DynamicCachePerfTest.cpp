@@ -0,0 +1,55 @@
+#include <TestUtils.h>
+#include "PerfUtils.h"
+
+#include <lexical_cache/lexical_cache.h>
+#include <lexical_cache/dynamic_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+constexpr int g_cacheSize = 64;
+
+TEST(DynamicCachePerfTest, testHitPerformance)
+{
+    constexpr int iteration = 1000*1000;
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < g_cacheSize; ++i) {
+        keys.push_back(randomString(-9999.9999, 9999.9999));
+    }
+    std::vector<std::string> hits;
+    hits.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        hits.push_back(keys[randomInt(0, g_cacheSize - 1)]);
+    }
+
+    // the same indexes, only the storage and eviction state are sized at
+    // run time
+    Cache<double, g_cacheSize, NoLock, LruEviction, AdmitAll, 40, MapIndex>
+        fixed;
+    DynamicCache<double> dynamic(g_cacheSize);
+    const double fixedHit = meanLatency(hits,
+            [&fixed](const std::string& s) { return fixed.castToReal(s); });
+    const double dynamicHit = meanLatency(hits,
+            [&dynamic](const std::string& s) { return dynamic.castToReal(s); });
+    EXPECT_EQ(fixed.hitCount(), dynamic.hitCount());
+
+    // shrinking to a quarter and back keeps the hot quarter
+    dynamic.resize(g_cacheSize / 4);
+    dynamic.resize(g_cacheSize);
+    const double resizedHit = meanLatency(hits,
+            [&dynamic](const std::string& s) { return dynamic.castToReal(s); });
+
+    std::cout << "castToReal hit, fixed size: " << fixedHit
+        << " ns, dynamic: " << dynamicHit << " ns, after resizing: "
+        << resizedHit << " ns" << std::endl;
+}
+
+}
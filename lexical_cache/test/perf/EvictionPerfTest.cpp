@@ -0,0 +1,49 @@
+#include <TestUtils.h>
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+template <typename eviction_policy>
+void testLargeCacheMiss(const char* name)
+{
+    using namespace std::chrono;
+    constexpr int cacheSize = 4096;
+    constexpr int iteration = 200*1000;
+
+    // twice as many distinct strings as entries, so once the cache is full
+    // most lookups miss and evict
+    std::vector<std::string> testSequence;
+    testSequence.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        testSequence.push_back(std::to_string((i * 7919) % (2 * cacheSize)));
+    }
+
+    Cache<double, cacheSize, NoLock, eviction_policy> cache;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& str : testSequence) {
+        cache.castToReal(str);
+    }
+    auto finish = std::chrono::steady_clock::now();
+    std::cout << name << ", cache size " << cacheSize << ", mean latency: "
+        << duration_cast<nanoseconds>(finish - start).count() / iteration
+        << " ns, cache miss ratio: " << cache.missRatio() << "%" << std::endl;
+}
+
+TEST(EvictionPerfTest, testLargeCacheMissPerformance)
+{
+    testLargeCacheMiss<LruEviction>("lru");
+    testLargeCacheMiss<ClockEviction>("clock");
+    testLargeCacheMiss<SieveEviction>("sieve");
+}
+
+}
@@ -0,0 +1,71 @@
+#include <TestUtils.h>
+#include "PerfUtils.h"
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+constexpr int g_cacheSize = 64;
+
+// the same prices as double, as int64_t cents and as Decimal: exact keys
+// hash their bits once where a double probes its ulp buckets
+template <typename real_type, typename F>
+void testExactKeyHit(const std::string& name, F fromCents)
+{
+    using namespace std::chrono;
+    constexpr int iteration = 1000*1000;
+
+    Cache<real_type, g_cacheSize> cache;
+    std::vector<real_type> reals;
+    std::vector<std::string> strs;
+    for (int i = 0; i < g_cacheSize; ++i) {
+        reals.push_back(fromCents(10000 + 25 * i));
+        strs.push_back(cache.castToStr(reals.back()));
+        cache.castToReal(strs.back());
+    }
+
+    std::mt19937 generator(42);
+    std::vector<real_type> realSequence;
+    std::vector<std::string> strSequence;
+    for (int i = 0; i < iteration; ++i) {
+        const int k = generator() % g_cacheSize;
+        realSequence.push_back(reals[k]);
+        strSequence.push_back(strs[k]);
+    }
+
+    const double toReal = meanLatency(strSequence,
+            [&cache](const std::string& s) {
+                return static_cast<double>(cache.castToReal(s));
+            });
+    const double toStr = meanLatency(realSequence,
+            [&cache](const real_type& real) {
+                return static_cast<double>(strlen(cache.castToStr(real)));
+            });
+
+    EXPECT_EQ(2 * iteration, cache.hitCount());
+    std::cout << name << ", castToReal hit latency: " << toReal
+        << " ns, castToStr hit latency: " << toStr << " ns" << std::endl;
+}
+
+TEST(ExactKeyPerfTest, testHitPerformance)
+{
+    testExactKeyHit<double>("double",
+            [](int cents) { return cents / 100.0; });
+    testExactKeyHit<int64_t>("int64_t",
+            [](int cents) { return int64_t(cents); });
+    testExactKeyHit<Decimal<int64_t, 2>>("Decimal<int64_t, 2>",
+            [](int cents) { return Decimal<int64_t, 2>::fromTicks(cents); });
+}
+
+}
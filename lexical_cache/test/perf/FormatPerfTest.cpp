@@ -0,0 +1,86 @@
+#include <TestUtils.h>
+#include "PerfUtils.h"
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+constexpr int g_cacheSize = 64;
+
+TEST(FormatPerfTest, testCastToStrMiss)
+{
+    constexpr int iteration = 1000*1000;
+
+    std::vector<double> misses;
+    misses.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        misses.push_back(randomReal(-9999.9999, 9999.9999));
+    }
+
+    char buf[64];
+    const double toString = meanLatency(misses,
+            [](double d) { return std::to_string(d).size(); });
+    const double legacy = meanLatency(misses, [&buf](double d) {
+            return LegacyFormat::format(d, buf, sizeof(buf));
+        });
+    const double shortest = meanLatency(misses, [&buf](double d) {
+            return ShortestFormat::format(d, buf, sizeof(buf));
+        });
+
+    Cache<double, g_cacheSize> cache;
+    Cache<double, g_cacheSize, NoLock, LruEviction, AdmitAll, 40, AutoIndex,
+          LegacyFormat> legacyCache;
+    const double miss = meanLatency(misses,
+            [&cache](double d) { return *cache.castToStr(d); });
+    const double legacyMiss = meanLatency(misses,
+            [&legacyCache](double d) { return *legacyCache.castToStr(d); });
+
+    std::cout << "std::to_string: " << toString << " ns, %f: " << legacy
+        << " ns, shortest: " << shortest << " ns" << std::endl;
+    std::cout << "castToStr miss, shortest: " << miss << " ns, %f: "
+        << legacyMiss << " ns" << std::endl;
+    EXPECT_LT(shortest, legacy);
+}
+
+TEST(FormatPerfTest, testFixedMiss)
+{
+    constexpr int iteration = 1000*1000;
+
+    std::vector<double> misses;
+    misses.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        misses.push_back(randomReal(-9999.9999, 9999.9999));
+    }
+
+    char buf[64];
+    const double printf4 = meanLatency(misses, [&buf](double d) {
+            return snprintf(buf, sizeof(buf), "%.4f", d);
+        });
+    const double fixed4 = meanLatency(misses, [&buf](double d) {
+            return FixedFormat<4>::format(d, buf, sizeof(buf));
+        });
+    const double plain = meanLatency(misses, [&buf](double d) {
+            return PlainFormat::format(d, buf, sizeof(buf));
+        });
+
+    Cache<double, g_cacheSize> cache;
+    const auto format = RealFormat::fixed(4);
+    const double miss = meanLatency(misses,
+            [&cache, &format](double d) { return *cache.castToStr(d, format); });
+
+    std::cout << "%.4f: " << printf4 << " ns, fixed(4): " << fixed4
+        << " ns, plain: " << plain << " ns" << std::endl;
+    std::cout << "castToStr miss, fixed(4): " << miss << " ns" << std::endl;
+    EXPECT_LT(fixed4, printf4);
+}
+
+}
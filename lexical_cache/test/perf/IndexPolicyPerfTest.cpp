@@ -0,0 +1,73 @@
+#include <TestUtils.h>
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+constexpr int g_cacheSize = 64;
+
+template <typename index_policy, int cache_size>
+void testIndexPolicyHit(const char* name)
+{
+    using namespace std::chrono;
+    constexpr int iteration = 1000*1000;
+
+    // too big for the stack
+    static Cache<double, cache_size, NoLock, LruEviction, AdmitAll, 40,
+           index_policy> cache;
+    std::vector<std::pair<std::string, double> > pairs;
+    for (int i = 0; i < cache_size; ++i) {
+        pairs.push_back(randomStringRealPair(-9999.9999, 9999.9999));
+        cache.castToReal(pairs.back().first);
+        cache.castToStr(pairs.back().second);
+    }
+
+    std::mt19937 generator(std::random_device{}());
+    std::uniform_int_distribution<int> distribution(0, cache_size - 1);
+    std::vector<int> testSequence;
+    testSequence.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        testSequence.push_back(distribution(generator));
+    }
+
+    cache.resetStats();
+    auto start = std::chrono::steady_clock::now();
+    for (auto i : testSequence) {
+        cache.castToReal(pairs[i].first);
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (auto i : testSequence) {
+        cache.castToStr(pairs[i].second);
+    }
+    auto finish = std::chrono::steady_clock::now();
+    EXPECT_EQ(2 * iteration, cache.hitCount());
+    std::cout << name << ", cache size " << cache_size
+        << ", castToReal hit latency: "
+        << duration_cast<nanoseconds>(middle - start).count() / iteration
+        << " ns, castToStr hit latency: "
+        << duration_cast<nanoseconds>(finish - middle).count() / iteration
+        << " ns" << std::endl;
+}
+
+TEST(IndexPolicyPerfTest, testHitPerformance)
+{
+    testIndexPolicyHit<MapIndex, g_cacheSize>("unordered_map");
+    testIndexPolicyHit<DenseIndex, g_cacheSize>("dense_hash_map");
+    testIndexPolicyHit<FlatIndex, g_cacheSize>("flat");
+    testIndexPolicyHit<AutoIndex, g_cacheSize>("auto");
+    testIndexPolicyHit<MapIndex, 1024>("unordered_map");
+    testIndexPolicyHit<DenseIndex, 1024>("dense_hash_map");
+    testIndexPolicyHit<FlatIndex, 1024>("flat");
+}
+
+}
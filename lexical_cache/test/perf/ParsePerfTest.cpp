@@ -0,0 +1,141 @@
+#include <TestUtils.h>
+#include "PerfUtils.h"
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+constexpr int g_cacheSize = 64;
+
+// the hit ratio above which converting through the cache is faster than
+// converting directly
+double breakEvenHitRatio(double hit, double miss, double direct)
+{
+    return std::max(0.0, (miss - direct) / (miss - hit)) * 100;
+}
+
+TEST(ParsePerfTest, testBreakEvenHitRatio)
+{
+    constexpr int iteration = 1000*1000;
+
+    std::vector<std::string> misses;
+    misses.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        misses.push_back(randomString(-9999.9999, 9999.9999));
+    }
+    std::vector<std::string> hits;
+    hits.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        hits.push_back(misses[i % g_cacheSize]);
+    }
+
+    const double stod = meanLatency(misses,
+            [](const std::string& str) { return std::stod(str); });
+    const double parse = meanLatency(misses,
+            [](const std::string& str) { return parseReal<double>(str); });
+
+    Cache<double, g_cacheSize> cache;
+    auto castToReal = [&cache](const std::string& str) {
+        return cache.castToReal(str);
+    };
+    const double miss = meanLatency(misses, castToReal);
+    const double hit = meanLatency(hits, castToReal);
+
+    // what a miss would cost if it still called std::stod
+    const double stodMiss = miss - parse + stod;
+    std::cout << "std::stod: " << stod << " ns, parseReal: " << parse
+        << " ns, cache hit: " << hit << " ns, cache miss: " << miss
+        << " ns" << std::endl;
+    std::cout << "break-even hit ratio with std::stod: "
+        << breakEvenHitRatio(hit, stodMiss, stod)
+        << "%, with parseReal: " << breakEvenHitRatio(hit, miss, parse)
+        << "%" << std::endl;
+}
+
+TEST(ParsePerfTest, testShortDecimalMiss)
+{
+    constexpr int iteration = 1000*1000;
+
+    // prices as feeds send them, 4 decimals
+    std::mt19937 generator(97);
+    std::vector<std::string> misses;
+    misses.reserve(iteration);
+    char buf[32];
+    for (int i = 0; i < iteration; ++i) {
+        snprintf(buf, sizeof(buf), "%.4f", (generator() % 100000000) / 1e4);
+        misses.push_back(buf);
+    }
+    std::vector<std::string> hits;
+    hits.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        hits.push_back(misses[i % g_cacheSize]);
+    }
+
+    const double general = meanLatency(misses, [](const std::string& str) {
+            double value = 0;
+            detail::parseDecimal(str.data(), str.data() + str.size(), false,
+                    value);
+            return value;
+        });
+    const double swar = meanLatency(misses,
+            [](const std::string& str) { return parseReal<double>(str); });
+
+    Cache<double, g_cacheSize> cache;
+    auto castToReal = [&cache](const std::string& str) {
+        return cache.castToReal(str);
+    };
+    const double miss = meanLatency(misses, castToReal);
+    const double hit = meanLatency(hits, castToReal);
+
+    std::cout << "digit by digit: " << general << " ns, SWAR: "
+        << swar << " ns, cache hit: " << hit << " ns, cache miss: " << miss
+        << " ns" << std::endl;
+}
+
+TEST(ParsePerfTest, testRepeatedBadInput)
+{
+    constexpr int iteration = 100*1000;
+
+    // mostly numbers, a few kinds of garbage in between
+    const std::string bad[] = {"N/A", "-", "", "null"};
+    std::vector<std::string> strs;
+    strs.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        strs.push_back(i % 4 == 0 ? bad[i / 4 % 4]
+                : std::to_string(i % 100) + ".5");
+    }
+
+    Cache<double, g_cacheSize> throwing;
+    const double thrown = meanLatency(strs,
+            [&throwing](const std::string& s) {
+                try {
+                    return throwing.castToReal(s);
+                }
+                catch (const std::invalid_argument&) {
+                    return 0.0;
+                }
+            });
+    Cache<double, g_cacheSize> trying;
+    const double tried = meanLatency(strs,
+            [&trying](const std::string& s) {
+                return trying.tryCastToReal(s).valueOr(0.0);
+            });
+
+    std::cout << "a quarter bad input, castToReal: " << thrown
+        << " ns, tryCastToReal: " << tried << " ns" << std::endl;
+    EXPECT_EQ(throwing.hitCount(), trying.hitCount());
+}
+
+}
@@ -0,0 +1,31 @@
+#ifndef LEXICAL_CACHE_PERFUTILS_H_INCLUDED
+#define LEXICAL_CACHE_PERFUTILS_H_INCLUDED
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace lexical_cache {
+
+template <typename T, typename F>
+double meanLatency(const std::vector<T>& testSequence, F convert)
+{
+    using namespace std::chrono;
+    double sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& value : testSequence) {
+        sum += convert(value);
+    }
+    auto finish = std::chrono::steady_clock::now();
+    // keep the conversions from being optimised away
+    EXPECT_FALSE(std::isnan(sum));
+    return static_cast<double>(
+            duration_cast<nanoseconds>(finish - start).count())
+        / testSequence.size();
+}
+
+}
+
+#endif
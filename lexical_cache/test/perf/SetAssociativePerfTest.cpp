@@ -0,0 +1,53 @@
+#include <TestUtils.h>
+
+#include <lexical_cache/lexical_cache.h>
+#include <lexical_cache/set_associative_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+template <typename cache_type>
+void testLargeCacheMixed(cache_type& cache, const char* name, int keyCount)
+{
+    using namespace std::chrono;
+    constexpr int iteration = 1000*1000;
+
+    std::mt19937 generator(std::random_device{}());
+    std::uniform_int_distribution<int> distribution(0, keyCount - 1);
+    std::vector<std::string> testSequence;
+    testSequence.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        testSequence.push_back(std::to_string(distribution(generator) * 0.25));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& str : testSequence) {
+        cache.castToReal(str);
+    }
+    auto finish = std::chrono::steady_clock::now();
+    std::cout << name << ", " << keyCount << " keys, mean latency: "
+        << duration_cast<nanoseconds>(finish - start).count() / iteration
+        << " ns, cache miss ratio: " << cache.missRatio() << "%" << std::endl;
+}
+
+TEST(SetAssociativePerfTest, testLargeCachePerformance)
+{
+    constexpr int capacity = 16384;
+    // too big for the stack
+    static Cache<double, capacity> fullyAssociative;
+    static SetAssociativeCache<double, capacity / 8, 8> setAssociative;
+
+    testLargeCacheMixed(fullyAssociative, "fully associative", capacity / 2);
+    testLargeCacheMixed(setAssociative, "8 way set associative", capacity / 2);
+}
+
+}
@@ -0,0 +1,54 @@
+#include <TestUtils.h>
+#include "PerfUtils.h"
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+constexpr int g_cacheSize = 64;
+
+TEST(StatsPerfTest, testHitOverhead)
+{
+    constexpr int iteration = 1000*1000;
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < g_cacheSize; ++i) {
+        keys.push_back(randomString(-9999.9999, 9999.9999));
+    }
+    std::vector<std::string> hits;
+    hits.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        hits.push_back(keys[randomInt(0, g_cacheSize - 1)]);
+    }
+
+    Cache<double, g_cacheSize, NoLock, LruEviction, AdmitAll, 40, AutoIndex,
+          ShortestFormat, NeverBypass, NoStats> none;
+    Cache<double, g_cacheSize> counts;
+    Cache<double, g_cacheSize, NoLock, LruEviction, AdmitAll, 40, AutoIndex,
+          ShortestFormat, NeverBypass, LatencyStats> latencies;
+    const double noStats = meanLatency(hits,
+            [&none](const std::string& s) { return none.castToReal(s); });
+    const double countStats = meanLatency(hits,
+            [&counts](const std::string& s) { return counts.castToReal(s); });
+    const double latencyStats = meanLatency(hits,
+            [&latencies](const std::string& s) {
+                return latencies.castToReal(s);
+            });
+
+    const auto stats = latencies.stats().m_strToReal;
+    std::cout << "castToReal hit, NoStats: " << noStats << " ns, CountStats: "
+        << countStats << " ns, LatencyStats: " << latencyStats
+        << " ns, p50/p99 " << stats.m_hitLatency.percentile(0.5) << "/"
+        << stats.m_hitLatency.percentile(0.99) << " ticks" << std::endl;
+    EXPECT_EQ(iteration, stats.lookups());
+}
+
+}
@@ -0,0 +1,62 @@
+#include <TestUtils.h>
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+constexpr int g_cacheSize = 64;
+
+template <typename index_type, int slot_count>
+void testIndexHit(const char* name)
+{
+    using namespace std::chrono;
+    constexpr int iteration = 1000*1000;
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < slot_count; ++i) {
+        keys.push_back(randomString(-9999.9999, 9999.9999));
+    }
+    index_type index;
+    for (int i = 0; i < slot_count; ++i) {
+        index.insert(keys[i], i);
+    }
+
+    std::mt19937 generator(std::random_device{}());
+    std::uniform_int_distribution<int> distribution(0, slot_count - 1);
+    std::vector<const std::string*> testSequence;
+    testSequence.reserve(iteration);
+    for (int i = 0; i < iteration; ++i) {
+        testSequence.push_back(&keys[distribution(generator)]);
+    }
+
+    long found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto* key : testSequence) {
+        found += index.find(*key) >= 0;
+    }
+    auto finish = std::chrono::steady_clock::now();
+    EXPECT_EQ(iteration, found);
+    std::cout << name << ", " << slot_count << " slots, mean hit latency: "
+        << duration_cast<nanoseconds>(finish - start).count() / iteration
+        << " ns" << std::endl;
+}
+
+TEST(StrIndexPerfTest, testHitPerformance)
+{
+    testIndexHit<MapStrIndex<CstrHash>, 10>("unordered_map");
+    testIndexHit<TagStrIndex<10>, 10>("tag array");
+    testIndexHit<MapStrIndex<CstrHash>, g_cacheSize>("unordered_map");
+    testIndexHit<TagStrIndex<g_cacheSize>, g_cacheSize>("tag array");
+}
+
+}
@@ -40,8 +40,7 @@ public:
 
         // populate the cache
         for (const auto& p : m_testPairs) {
-            auto d = m_cache.castToReal(p.first);
-            //EXPECT_FLOAT_EQ(d, p.second);
+            m_cache.castToReal(p.first);
         }
 
         EXPECT_EQ(g_cacheSize, m_cache.size());
@@ -77,7 +76,7 @@ protected:
         std::mt19937 g(rd());
         std::shuffle(testSequence.begin(), testSequence.end(), g);
 
-        assert(testSequence.size() == iteration);
+        assert(testSequence.size() == static_cast<size_t>(iteration));
 
         return testSequence;
     }
@@ -107,7 +106,7 @@ protected:
         std::mt19937 g(rd());
         std::shuffle(testSequence.begin(), testSequence.end(), g);
 
-        assert(testSequence.size() == iteration);
+        assert(testSequence.size() == static_cast<size_t>(iteration));
 
         return testSequence;
     }
@@ -119,7 +118,7 @@ protected:
         using namespace std::chrono;
         auto start = std::chrono::system_clock::now();
         for (int i = 0; i < iteration; ++i) {
-            auto d = m_cache.castToReal(testSequence[i]);
+            m_cache.castToReal(testSequence[i]);
         }
         auto finish = std::chrono::system_clock::now();
         auto duration = finish - start;
@@ -135,7 +134,7 @@ protected:
         using namespace std::chrono;
         auto start = std::chrono::system_clock::now();
         for (int i = 0; i < iteration; ++i) {
-            auto d = std::stod(testSequence[i]);
+            std::stod(testSequence[i]);
         }
         auto finish = std::chrono::system_clock::now();
         auto duration = finish - start;
@@ -151,7 +150,7 @@ protected:
         using namespace std::chrono;
         auto start = std::chrono::system_clock::now();
         for (int i = 0; i < iteration; ++i) {
-            auto d = m_cache.castToStr(testSequence[i]);
+            m_cache.castToStr(testSequence[i]);
         }
         auto finish = std::chrono::system_clock::now();
         auto duration = finish - start;
@@ -167,7 +166,7 @@ protected:
         using namespace std::chrono;
         auto start = std::chrono::system_clock::now();
         for (int i = 0; i < iteration; ++i) {
-            auto d = std::to_string(testSequence[i]);
+            std::to_string(testSequence[i]);
         }
         auto finish = std::chrono::system_clock::now();
         auto duration = finish - start;
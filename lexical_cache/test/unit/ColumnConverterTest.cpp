@@ -0,0 +1,78 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/column_converter.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <unordered_map>
+#include <stdexcept>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+TEST(ColumnConverterTest, testConvert)
+{
+    ColumnConverter<double> converter;
+    converter.convert({"1.5", "2.25", "1.5", "1.5"});
+
+    EXPECT_THAT(converter.values(), ElementsAre(1.5, 2.25, 1.5, 1.5));
+    EXPECT_THAT(converter.codes(), ElementsAre(0u, 1u, 0u, 0u));
+    EXPECT_THAT(converter.dictionary(), ElementsAre(1.5, 2.25));
+    EXPECT_EQ("1.5", converter.dictionaryKey(0));
+    EXPECT_EQ("2.25", converter.dictionaryKey(1));
+
+    // appended, a string keeps its code. "1.50" is another string
+    converter.convert({"2.25", "1.50"});
+    EXPECT_EQ(6u, converter.rowCount());
+    EXPECT_EQ(3u, converter.distinctCount());
+    EXPECT_THAT(converter.codes(), ElementsAre(0u, 1u, 0u, 0u, 1u, 2u));
+    EXPECT_DOUBLE_EQ(1.5, converter.values()[5]);
+
+    converter.clear();
+    EXPECT_EQ(0u, converter.rowCount());
+    EXPECT_EQ(0u, converter.distinctCount());
+}
+
+TEST(ColumnConverterTest, testManyDistinct)
+{
+    // the table grows many times, the rows don't outlive convert()
+    ColumnConverter<double> converter;
+    std::unordered_map<std::string, uint32_t> expected;
+    std::vector<std::string> column;
+    for (int i = 0; i < 100000; ++i) {
+        column.push_back(std::to_string(randomInt(0, 20000) * 0.01));
+    }
+    {
+        std::vector<std::string> copy(column);
+        const std::vector<std::string_view> rows(copy.begin(), copy.end());
+        converter.convert(rows);
+    }
+
+    ASSERT_EQ(column.size(), converter.rowCount());
+    for (size_t i = 0; i < column.size(); ++i) {
+        const auto code = converter.codes()[i];
+        EXPECT_EQ(code, expected.emplace(column[i], expected.size())
+                .first->second);
+        EXPECT_EQ(column[i], converter.dictionaryKey(code));
+        EXPECT_EQ(std::stod(column[i]), converter.values()[i]);
+    }
+    EXPECT_EQ(expected.size(), converter.distinctCount());
+}
+
+TEST(ColumnConverterTest, testNotANumber)
+{
+    ColumnConverter<float> converter;
+    EXPECT_THROW(converter.convert({"1.5", "abc", "2.5"}),
+            std::invalid_argument);
+    // the rows before it are converted
+    EXPECT_THAT(converter.values(), ElementsAre(1.5f));
+    EXPECT_EQ(1u, converter.distinctCount());
+
+    converter.reserve(1000, 500);
+    converter.convert({"2.5", "1.5"});
+    EXPECT_THAT(converter.codes(), ElementsAre(0u, 1u, 0u));
+}
+
+}
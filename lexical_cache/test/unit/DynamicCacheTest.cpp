@@ -0,0 +1,250 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/dynamic_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+template <typename eviction_policy>
+class DynamicCacheTest : public ::testing::Test
+{
+protected:
+    static constexpr int cacheSize = 64;
+    using FixedCache = Cache<double, cacheSize, NoLock, eviction_policy,
+          AdmitAll, 40, MapIndex>;
+    using CacheType = DynamicCache<double, NoLock, eviction_policy>;
+};
+
+using EvictionPolicies =
+    ::testing::Types<LruEviction, ClockEviction, SieveEviction>;
+TYPED_TEST_CASE(DynamicCacheTest, EvictionPolicies);
+
+TYPED_TEST(DynamicCacheTest, testSameAsFixedCache)
+{
+    typename TestFixture::FixedCache fixed;
+    typename TestFixture::CacheType dynamic(TestFixture::cacheSize);
+
+    // skewed keys, so each policy keeps something different
+    std::mt19937 generator(4242);
+    for (int i = 0; i < 20000; ++i) {
+        const int key = generator() % 16 == 0
+            ? generator() % 1000 : generator() % 80;
+        const std::string str = std::to_string(key) + ".5";
+        EXPECT_EQ(fixed.castToReal(str), dynamic.castToReal(str));
+        EXPECT_STREQ(fixed.castToStr(key + 0.25),
+                dynamic.castToStr(key + 0.25));
+    }
+    EXPECT_EQ(fixed.hitCount(), dynamic.hitCount());
+    EXPECT_EQ(fixed.missCount(), dynamic.missCount());
+    EXPECT_EQ(fixed.size(), dynamic.size());
+}
+
+TYPED_TEST(DynamicCacheTest, testShrinkKeepsHotEntries)
+{
+    typename TestFixture::CacheType cache(100);
+    for (int i = 0; i < 100; ++i) {
+        cache.castToReal(std::to_string(i));
+        cache.castToStr(i);
+    }
+    // the first ten are hot
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 10; ++i) {
+            cache.castToReal(std::to_string(i));
+            cache.castToStr(i);
+        }
+    }
+
+    cache.resize(10);
+    EXPECT_EQ(10u, cache.capacity());
+    EXPECT_EQ(10u, cache.size(String2Real));
+    EXPECT_EQ(10u, cache.size(Real2String));
+
+    cache.resetStats();
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_DOUBLE_EQ(i, cache.castToReal(std::to_string(i)));
+        EXPECT_STREQ(std::to_string(i).c_str(), cache.castToStr(i));
+    }
+    EXPECT_EQ(20, cache.hitCount());
+    EXPECT_EQ(0, cache.missCount());
+
+    // and it keeps working at the new size
+    for (int i = 100; i < 200; ++i) {
+        EXPECT_DOUBLE_EQ(i, cache.castToReal(std::to_string(i)));
+        EXPECT_STREQ(std::to_string(i).c_str(), cache.castToStr(i));
+    }
+    EXPECT_EQ(10u, cache.size(String2Real));
+    EXPECT_EQ(10u, cache.size(Real2String));
+}
+
+TYPED_TEST(DynamicCacheTest, testGrow)
+{
+    typename TestFixture::CacheType cache(10);
+    for (int i = 0; i < 10; ++i) {
+        cache.castToReal(std::to_string(i));
+    }
+
+    cache.resize(1000);
+    EXPECT_EQ(10u, cache.size(String2Real));
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_DOUBLE_EQ(i, cache.castToReal(std::to_string(i)));
+    }
+    EXPECT_EQ(1000u, cache.size(String2Real));
+
+    // all of them still there, the storage moved a few times on the way
+    cache.resetStats();
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_DOUBLE_EQ(i, cache.castToReal(std::to_string(i)));
+    }
+    EXPECT_EQ(1000, cache.hitCount());
+}
+
+TYPED_TEST(DynamicCacheTest, testRandomResizes)
+{
+    typename TestFixture::CacheType cache(32);
+
+    std::mt19937 generator(777);
+    for (int i = 0; i < 50000; ++i) {
+        if (i % 500 == 0) {
+            cache.resize(1 + generator() % 100);
+            cache.setMemoryBudget(
+                    generator() % 2 ? 0 : 1000 + generator() % 10000);
+        }
+        // some keys long enough for the overflow arena
+        const int key = generator() % 200;
+        const std::string str = key % 7 == 0
+            ? std::to_string(key) + "." + std::string(50, '1')
+            : std::to_string(key);
+        EXPECT_DOUBLE_EQ(std::stod(str), cache.castToReal(str));
+        EXPECT_EQ(shortestString(key + 0.5), cache.castToStr(key + 0.5));
+
+        EXPECT_LE(cache.size(String2Real), cache.capacity());
+        EXPECT_LE(cache.size(Real2String), cache.capacity());
+        if (cache.memoryBudget() > 0) {
+            EXPECT_LE(cache.bytes(String2Real), cache.memoryBudget());
+            EXPECT_LE(cache.bytes(Real2String), cache.memoryBudget());
+        }
+    }
+}
+
+TEST(DynamicCacheTest, testShrunkLruSameAsSmallerCache)
+{
+    // an LRU cache's n most recent entries are what an LRU cache of n would
+    // hold, so once shrunk it behaves like one
+    Cache<double, 16, NoLock, LruEviction> fixed;
+    DynamicCache<double, NoLock, LruEviction> dynamic(256);
+
+    std::mt19937 generator(1234);
+    std::vector<std::string> keys;
+    for (int i = 0; i < 4000; ++i) {
+        keys.push_back(std::to_string(generator() % 40));
+    }
+    for (const auto& key : keys) {
+        fixed.castToReal(key);
+        dynamic.castToReal(key);
+    }
+
+    dynamic.resize(16);
+    fixed.resetStats();
+    dynamic.resetStats();
+    for (const auto& key : keys) {
+        EXPECT_EQ(fixed.castToReal(key), dynamic.castToReal(key));
+    }
+    EXPECT_EQ(fixed.hitCount(), dynamic.hitCount());
+    EXPECT_EQ(fixed.missCount(), dynamic.missCount());
+}
+
+TEST(DynamicCacheTest, testMemoryBudget)
+{
+    using CacheType = DynamicCache<double>;
+
+    CacheType cache(1000);
+    cache.castToReal("1.5");
+    const size_t shortEntry = cache.bytes(String2Real);
+    // 200 chars, in the overflow arena
+    const std::string longStr = "1." + std::string(198, '5');
+    cache.castToReal(longStr);
+    const size_t longEntry = cache.bytes(String2Real) - shortEntry;
+    EXPECT_GT(longEntry, shortEntry + 200);
+    cache.clear();
+
+    cache.setMemoryBudget(20 * shortEntry);
+    for (int i = 0; i < 100; ++i) {
+        cache.castToReal(std::to_string(i));
+        EXPECT_LE(cache.bytes(String2Real), cache.memoryBudget());
+    }
+    EXPECT_EQ(20u, cache.size(String2Real));
+
+    // long strings take the room of several short ones
+    for (int i = 0; i < 10; ++i) {
+        const auto str = std::to_string(i) + longStr.substr(1);
+        EXPECT_DOUBLE_EQ(std::stod(str), cache.castToReal(str));
+        EXPECT_LE(cache.bytes(String2Real), cache.memoryBudget());
+    }
+    EXPECT_LT(cache.size(String2Real), 20u);
+
+    // a tighter budget evicts right away
+    cache.setMemoryBudget(4 * shortEntry);
+    EXPECT_LE(cache.bytes(String2Real), 4 * shortEntry);
+    EXPECT_GT(cache.size(String2Real), 0u);
+
+    // too big for the whole budget, converted but not cached
+    const auto size = cache.size(String2Real);
+    const std::string tooLong = "1." + std::string(400, '5');
+    EXPECT_DOUBLE_EQ(std::stod(tooLong), cache.castToReal(tooLong));
+    EXPECT_EQ(size, cache.size(String2Real));
+    char plain[512];
+    formatPlain(1e300, plain, sizeof(plain));
+    EXPECT_STREQ(plain, cache.castToStr(1e300, RealFormat::plain()));
+    EXPECT_EQ(0u, cache.size(Real2String));
+
+    // no budget, no limit but the capacity
+    cache.setMemoryBudget(0);
+    for (int i = 0; i < 100; ++i) {
+        cache.castToReal(std::to_string(i) + longStr.substr(1));
+    }
+    EXPECT_GE(cache.size(String2Real), 100u);
+}
+
+TEST(DynamicCacheTest, testFormats)
+{
+    DynamicCache<double> cache(4);
+    EXPECT_STREQ("2.5", cache.castToStr(2.5));
+    EXPECT_STREQ("2.50", cache.castToStr(2.5, RealFormat::fixed(2)));
+    EXPECT_STREQ("2.5", cache.castToStr(2.5));
+    EXPECT_EQ(1, cache.hitCount());
+    EXPECT_EQ(2u, cache.size(Real2String));
+}
+
+TEST(DynamicCacheTest, testThreadLocal)
+{
+    // every thread's instance has the capacity and budget it was built with
+    DynamicCache<double, ThreadLocal> cache(3, 4096);
+    const auto check = [&cache]() {
+        EXPECT_EQ(3u, cache.capacity());
+        EXPECT_EQ(4096u, cache.memoryBudget());
+        for (int i = 0; i < 10; ++i) {
+            cache.castToReal(std::to_string(i));
+        }
+        EXPECT_EQ(3u, cache.size(String2Real));
+    };
+    check();
+    std::thread other(check);
+    other.join();
+
+    // resize() is the calling thread's
+    cache.resize(5);
+    EXPECT_EQ(5u, cache.capacity());
+    std::thread resized([&cache]() { EXPECT_EQ(3u, cache.capacity()); });
+    resized.join();
+}
+
+}
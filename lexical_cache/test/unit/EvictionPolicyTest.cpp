@@ -0,0 +1,259 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <sstream>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+template <typename eviction_policy>
+class EvictionPolicyTest : public ::testing::Test
+{
+protected:
+    static constexpr int cacheSize = 4;
+    using CacheType = Cache<double, cacheSize, NoLock, eviction_policy>;
+};
+
+using EvictionPolicies =
+    ::testing::Types<LruEviction, ClockEviction, SieveEviction>;
+TYPED_TEST_CASE(EvictionPolicyTest, EvictionPolicies);
+
+TYPED_TEST(EvictionPolicyTest, testCacheFull)
+{
+    typename TestFixture::CacheType cache;
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_FLOAT_EQ(i, cache.castToReal(std::to_string(i)));
+        EXPECT_FLOAT_EQ(i, std::stod(cache.castToStr(i)));
+    }
+    EXPECT_EQ(static_cast<size_t>(TestFixture::cacheSize), cache.size(String2Real));
+    EXPECT_EQ(static_cast<size_t>(TestFixture::cacheSize), cache.size(Real2String));
+}
+
+TYPED_TEST(EvictionPolicyTest, testHotEntrySurvives)
+{
+    typename TestFixture::CacheType cache;
+    cache.castToReal("0");
+    for (int i = 1; i < 100; ++i) {
+        // keep hitting "0" while streaming through one-off strings
+        cache.castToReal("0");
+        cache.castToReal(std::to_string(i));
+    }
+
+    cache.resetStats();
+    cache.castToReal("0");
+    EXPECT_EQ(1, cache.hitCount()) << cache;
+}
+
+TYPED_TEST(EvictionPolicyTest, testSnapshotRoundTrip)
+{
+    typename TestFixture::CacheType cache;
+    for (int i = 0; i < 10; ++i) {
+        cache.castToReal(std::to_string(i));
+        cache.castToStr(i + 0.5);
+        cache.castToReal("9");
+    }
+    std::stringstream snapshot;
+    ASSERT_TRUE(cache.writeSnapshot(&snapshot));
+
+    typename TestFixture::CacheType loaded;
+    ASSERT_TRUE(loaded.readSnapshot(&snapshot));
+    EXPECT_EQ(cache.size(String2Real), loaded.size(String2Real));
+    EXPECT_EQ(cache.size(Real2String), loaded.size(Real2String));
+    for (int i = 10 - TestFixture::cacheSize; i < 10; ++i) {
+        EXPECT_DOUBLE_EQ(i, loaded.castToReal(std::to_string(i)));
+        EXPECT_STREQ(cache.castToStr(i + 0.5), loaded.castToStr(i + 0.5));
+    }
+    EXPECT_EQ(2 * TestFixture::cacheSize, loaded.hitCount()) << loaded;
+}
+
+TEST(LruEvictionTest, testEvictLeastRecentlyUsed)
+{
+    Cache<double, 3, NoLock, LruEviction> cache;
+    cache.castToReal("1");
+    cache.castToReal("2");
+    cache.castToReal("3");
+    cache.castToReal("1");
+
+    // "2" is the least recently used
+    cache.castToReal("4");
+    cache.resetStats();
+    cache.castToReal("1");
+    cache.castToReal("3");
+    cache.castToReal("4");
+    EXPECT_EQ(3, cache.hitCount());
+    cache.castToReal("2");
+    EXPECT_EQ(1, cache.missCount());
+}
+
+TEST(LruEvictionTest, testSnapshotKeepsRecency)
+{
+    Cache<double, 8, NoLock, LruEviction> cache;
+    std::mt19937 generator(99);
+    for (int i = 0; i < 1000; ++i) {
+        cache.castToReal(std::to_string(generator() % 20));
+    }
+    std::stringstream snapshot;
+    ASSERT_TRUE(cache.writeSnapshot(&snapshot));
+    Cache<double, 8, NoLock, LruEviction> loaded;
+    ASSERT_TRUE(loaded.readSnapshot(&snapshot));
+
+    // the same entries in the same order, so the same hits from now on
+    cache.resetStats();
+    for (int i = 0; i < 1000; ++i) {
+        const auto str = std::to_string(generator() % 20);
+        cache.castToReal(str);
+        loaded.castToReal(str);
+    }
+    EXPECT_EQ(cache.hitCount(), loaded.hitCount());
+}
+
+TEST(SieveEvictionTest, testEvictUnvisited)
+{
+    Cache<double, 3, NoLock, SieveEviction> cache;
+    cache.castToReal("1");
+    cache.castToReal("2");
+    cache.castToReal("3");
+    cache.castToReal("1");
+
+    // the hand skips the visited "1" and evicts "2"
+    cache.castToReal("4");
+    cache.resetStats();
+    cache.castToReal("1");
+    cache.castToReal("3");
+    cache.castToReal("4");
+    EXPECT_EQ(3, cache.hitCount());
+}
+
+TEST(TinyLfuAdmissionTest, testOneOffsDontFlushHotEntries)
+{
+    constexpr int cacheSize = 4;
+    Cache<double, cacheSize> plain;
+    Cache<double, cacheSize, NoLock, LruEviction, TinyLfuAdmission<> > tinyLfu;
+
+    const std::vector<std::string> hot = {"1.5", "2.5", "3.5", "4.5"};
+    for (int i = 0; i < 5; ++i) {
+        for (const auto& str : hot) {
+            plain.castToReal(str);
+            tinyLfu.castToReal(str);
+        }
+    }
+
+    // a noisy feed, every string seen once
+    for (int i = 0; i < 20; ++i) {
+        const auto str = std::to_string(100 + i);
+        EXPECT_FLOAT_EQ(100 + i, plain.castToReal(str));
+        EXPECT_FLOAT_EQ(100 + i, tinyLfu.castToReal(str));
+    }
+    EXPECT_EQ(0, plain.rejectedCount());
+    EXPECT_LT(0, tinyLfu.rejectedCount());
+
+    plain.resetStats();
+    tinyLfu.resetStats();
+    for (const auto& str : hot) {
+        plain.castToReal(str);
+        tinyLfu.castToReal(str);
+    }
+    EXPECT_EQ(0, plain.hitCount());
+    EXPECT_EQ(4, tinyLfu.hitCount()) << tinyLfu;
+}
+
+TEST(TinyLfuAdmissionTest, testRejectedCastToStr)
+{
+    Cache<double, 1, NoLock, LruEviction, TinyLfuAdmission<> > cache;
+    for (int i = 0; i < 5; ++i) {
+        cache.castToStr(1.0);
+    }
+
+    // not cached, but still converted
+    EXPECT_STREQ("2", cache.castToStr(2.0));
+    EXPECT_EQ(1, cache.rejectedCount());
+    EXPECT_STREQ("1", cache.castToStr(1.0));
+}
+
+TEST(AdaptiveBypassTest, testBypassWhileMissesCostMore)
+{
+    // windows of 64 lookups, every other one timed, bypass for 2 windows
+    AdaptiveBypass<64, 2, 2>::State state;
+    auto window = [&state](bool hits, int64_t latency) {
+        for (int i = 0; i < 64; ++i) {
+            if (state.bypass()) {
+                state.recordConversion(100);
+                continue;
+            }
+            if (state.timedConversion()) {
+                state.recordConversion(100);
+            }
+            const int64_t ns = state.timed() ? latency : -1;
+            hits ? state.recordHit(ns) : state.recordMiss(ns);
+        }
+    };
+
+    // hits at 30ns are cheaper than a 100ns conversion
+    window(true, 30);
+    window(true, 30);
+    EXPECT_FALSE(state.bypassing());
+    EXPECT_DOUBLE_EQ(30, state.hitLatency());
+
+    // misses at 150ns aren't
+    for (int i = 0; i < 3 && !state.bypassing(); ++i) {
+        window(false, 150);
+    }
+    EXPECT_TRUE(state.bypassing());
+
+    // probes the cache again after 2 windows
+    window(false, 150);
+    window(false, 150);
+    EXPECT_FALSE(state.bypassing());
+    for (int i = 0; i < 3; ++i) {
+        window(true, 30);
+    }
+    EXPECT_FALSE(state.bypassing());
+
+    state.clear();
+    EXPECT_LT(state.conversionLatency(), 0);
+}
+
+TEST(AdaptiveBypassTest, testCacheBypassedOnMisses)
+{
+    Cache<double, 4, NoLock, LruEviction, AdmitAll, 40, AutoIndex,
+          ShortestFormat, AdaptiveBypass<64, 2, 4> > cache;
+
+    // a hot set, formatting costs more than a hit
+    const double hot[] = {1.5, 2.5, 3.5, 4.5};
+    for (int i = 0; i < 64 * 20; ++i) {
+        EXPECT_EQ(shortestString(hot[i % 4]), cache.castToStr(hot[i % 4]));
+    }
+    EXPECT_FALSE(cache.bypassing(Real2String));
+    EXPECT_EQ(0, cache.bypassedCount());
+
+    // every real seen once, the cache only adds to the conversion
+    long i = 0;
+    for (; i < 64 * 100 && !cache.bypassing(Real2String); ++i) {
+        cache.castToStr(1000.25 + i);
+    }
+    ASSERT_TRUE(cache.bypassing(Real2String)) << cache;
+
+    // converted directly, not cached
+    const auto bypassed = cache.bypassedCount();
+    const auto misses = cache.missCount();
+    const auto size = cache.size(Real2String);
+    EXPECT_LT(0, bypassed);
+    EXPECT_STREQ("1.5", cache.castToStr(1.5));
+    EXPECT_STREQ("-7.25", cache.castToStr(-7.25));
+    EXPECT_EQ(bypassed + 2, cache.bypassedCount());
+    EXPECT_EQ(misses, cache.missCount());
+    EXPECT_EQ(size, cache.size(Real2String));
+
+    cache.resetStats();
+    EXPECT_EQ(0, cache.bypassedCount());
+    cache.clear();
+    EXPECT_FALSE(cache.bypassing(Real2String));
+}
+
+}
@@ -0,0 +1,165 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+template <typename lock_policy>
+class LockPolicyTest : public ::testing::Test
+{
+protected:
+    using CacheType = Cache<double, 16, lock_policy>;
+};
+
+using LockPolicies = ::testing::Types<NoLock, MutexLock, SpinLock, ThreadLocal>;
+TYPED_TEST_CASE(LockPolicyTest, LockPolicies);
+
+TYPED_TEST(LockPolicyTest, testCast)
+{
+    typename TestFixture::CacheType cache;
+
+    EXPECT_FLOAT_EQ(1.5, cache.castToReal("1.5"));
+    EXPECT_FLOAT_EQ(1.5, cache.castToReal("1.5"));
+    EXPECT_STREQ("2.5", cache.castToStr(2.5));
+
+    EXPECT_EQ(1u, cache.size(String2Real));
+    EXPECT_EQ(1u, cache.size(Real2String));
+    EXPECT_EQ(1, cache.hitCount());
+    EXPECT_EQ(2, cache.missCount());
+}
+
+TYPED_TEST(LockPolicyTest, testConcurrentCast)
+{
+    // NoLock isn't meant to be shared between threads
+    if (std::is_same<TypeParam, NoLock>::value) {
+        return;
+    }
+
+    typename TestFixture::CacheType cache;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t]() {
+            for (int i = 0; i < 5000; ++i) {
+                const double d = (i + t) % 32;
+                EXPECT_FLOAT_EQ(d, cache.castToReal(std::to_string(d)));
+                EXPECT_FLOAT_EQ(d, std::stod(cache.castToStr(d)));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // each thread counted in its own stripe, none lost
+    if (!std::is_same<TypeParam, ThreadLocal>::value) {
+        EXPECT_EQ(4*5000*2, cache.hitCount() + cache.missCount());
+    }
+}
+
+TEST(StripedStatsTest, testStripePerThread)
+{
+    // more threads than stripes, some of them share one
+    using StatsState = StripedStats<4>::State;
+    StatsState stats;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&stats, t]() {
+            for (int i = 0; i < 1000; ++i) {
+                stats.recordHit();
+                if (i % 4 == t % 4) {
+                    stats.recordMiss();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    const auto total = stats.snapshot();
+    EXPECT_EQ(8000, total.m_hits);
+    EXPECT_EQ(2000, total.m_misses);
+    EXPECT_EQ(10000, stats.counts().lookups());
+
+    stats.recordInsert();
+    stats.clear();
+    EXPECT_EQ(0, stats.counts().lookups());
+    EXPECT_EQ(0, stats.counts().m_inserts);
+}
+
+TEST(StripedStatsTest, testDefault)
+{
+    EXPECT_TRUE((std::is_same<DefaultStats<NoLock>, CountStats>::value));
+    EXPECT_TRUE((std::is_same<DefaultStats<ThreadLocal>, CountStats>::value));
+    EXPECT_TRUE((std::is_same<DefaultStats<MutexLock>,
+                StripedStats<> >::value));
+    EXPECT_TRUE((std::is_same<DefaultStats<SpinLock>,
+                StripedStats<> >::value));
+}
+
+TEST(StripedStatsTest, testResetStats)
+{
+    Cache<double, 16, MutexLock> cache;
+    cache.castToReal("1.5");
+    cache.castToReal("1.5");
+    cache.castToStr(1.5);
+    EXPECT_EQ(1, cache.hitCount());
+    EXPECT_EQ(2, cache.missCount());
+
+    cache.resetStats();
+    EXPECT_EQ(0, cache.hitCount());
+    EXPECT_EQ(0, cache.missCount());
+    EXPECT_EQ(0, cache.stats().m_strToReal.m_inserts);
+}
+
+TEST(ThreadLocalTest, testInstancePerThread)
+{
+    Cache<double, 4, ThreadLocal> cache;
+    cache.castToReal("1.0");
+    EXPECT_EQ(1u, cache.size(String2Real));
+
+    std::thread other([&cache]() {
+        EXPECT_TRUE(cache.empty());
+        cache.castToReal("2.0");
+        cache.castToReal("3.0");
+        EXPECT_EQ(2u, cache.size(String2Real));
+    });
+    other.join();
+
+    EXPECT_EQ(1u, cache.size(String2Real));
+}
+
+TEST(ThreadLocalTest, testInstancePerObject)
+{
+    Cache<double, 4, ThreadLocal> first;
+    Cache<double, 4, ThreadLocal> second;
+    first.castToReal("1.0");
+    first.castToReal("1.0");
+    EXPECT_EQ(1u, first.size(String2Real));
+    EXPECT_TRUE(second.empty());
+    EXPECT_EQ(0, second.hitCount());
+
+    second.castToReal("2.0");
+    second.castToReal("3.0");
+    EXPECT_EQ(1u, first.size(String2Real));
+    EXPECT_EQ(1, first.hitCount());
+    EXPECT_EQ(2u, second.size(String2Real));
+    EXPECT_EQ(2, second.missCount());
+
+    // a new object starts empty, even where a destroyed one was
+    for (int i = 0; i < 2; ++i) {
+        Cache<double, 4, ThreadLocal> scoped;
+        EXPECT_TRUE(scoped.empty());
+        scoped.castToReal("4.0");
+    }
+}
+
+}
@@ -0,0 +1,259 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/format_policies.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+namespace {
+
+// formatReal's result, compared with std::to_chars' shortest representation
+// and parsed back bit for bit
+template <typename real_type>
+void expectSameAsToChars(real_type real)
+{
+    char expected[64];
+    *std::to_chars(expected, expected + sizeof(expected) - 1, real).ptr = '\0';
+
+    char actual[64];
+    const int n = formatReal(real, actual, sizeof(actual));
+    EXPECT_STREQ(expected, actual);
+    EXPECT_EQ(static_cast<int>(strlen(expected)), n);
+
+    if (std::isfinite(real)) {
+        const real_type parsed = parseReal<real_type>(actual);
+        EXPECT_EQ(0, memcmp(&real, &parsed, sizeof(real_type))) << actual;
+    }
+}
+
+// formatPlain's result, compared with std::to_chars' fixed notation
+template <typename real_type>
+void expectSameAsToCharsFixed(real_type real)
+{
+    char expected[512];
+    *std::to_chars(expected, expected + sizeof(expected) - 1, real,
+            std::chars_format::fixed).ptr = '\0';
+
+    char actual[512];
+    const int n = formatPlain(real, actual, sizeof(actual));
+    EXPECT_STREQ(expected, actual);
+    EXPECT_EQ(static_cast<int>(strlen(expected)), n);
+}
+
+// formatFixed's result, compared with printf's
+void expectSameAsPrintf(double real, int decimals)
+{
+    char expected[512];
+    snprintf(expected, sizeof(expected), "%.*f", decimals, real);
+
+    char actual[512];
+    const int n = formatFixed(real, decimals, actual, sizeof(actual));
+    EXPECT_STREQ(expected, actual) << decimals;
+    EXPECT_EQ(static_cast<int>(strlen(expected)), n);
+}
+
+}
+
+TEST(RealFormatterTest, testSpecialCases)
+{
+    const double cases[] = {
+        0.0, -0.0, 1.0, -1.0, 1.5, 0.1, 0.3, 0.1 + 0.2, 2.5, 100.0, 1e5,
+        123456.0, 1234.5678, 1e-5, 1.5e-7, 1e15, 1e16, 1e20, 1e21, 1e22,
+        1e23, 9007199254740993.0, 18014398509481984.0, 5e-324,
+        2.2250738585072011e-308, 2.2250738585072014e-308,
+        1.7976931348623157e308, 3.14159265358979323846,
+        std::numeric_limits<double>::infinity(),
+        -std::numeric_limits<double>::infinity(),
+        std::numeric_limits<double>::quiet_NaN(),
+    };
+    for (const auto real : cases) {
+        expectSameAsToChars<double>(real);
+        expectSameAsToChars<float>(static_cast<float>(real));
+    }
+
+    char buf[32];
+    formatReal(0.1, buf, sizeof(buf));
+    EXPECT_STREQ("0.1", buf);
+    formatReal(1e20, buf, sizeof(buf));
+    EXPECT_STREQ("1e+20", buf);
+    formatReal(-1234.5, buf, sizeof(buf));
+    EXPECT_STREQ("-1234.5", buf);
+    formatReal(0.1f, buf, sizeof(buf));
+    EXPECT_STREQ("0.1", buf);
+}
+
+TEST(RealFormatterTest, testTruncated)
+{
+    // like snprintf: cut and null terminated, returns the whole length
+    char buf[5];
+    EXPECT_EQ(8, formatReal(-1234.25, buf, sizeof(buf)));
+    EXPECT_STREQ("-123", buf);
+    EXPECT_EQ(3, formatReal(2.5, buf, sizeof(buf)));
+    EXPECT_STREQ("2.5", buf);
+    EXPECT_EQ(3, formatReal(2.5, buf, 0));
+    EXPECT_STREQ("2.5", buf);
+}
+
+TEST(RealFormatterTest, testLongDouble)
+{
+    char buf[64];
+    formatReal(0.1L, buf, sizeof(buf));
+    EXPECT_STREQ("0.1", buf);
+    formatReal(-2.5L, buf, sizeof(buf));
+    EXPECT_STREQ("-2.5", buf);
+}
+
+TEST(RealFormatterTest, testRandomBits)
+{
+    std::mt19937_64 generator(2468);
+    for (int i = 0; i < 200000; ++i) {
+        // every double and float is equally likely, nan and inf included
+        const uint64_t bits = generator();
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        expectSameAsToChars(d);
+        float f;
+        const uint32_t fbits = static_cast<uint32_t>(bits);
+        memcpy(&f, &fbits, sizeof(f));
+        expectSameAsToChars(f);
+    }
+}
+
+TEST(RealFormatterTest, testPrices)
+{
+    std::mt19937_64 generator(1357);
+    for (int i = 0; i < 200000; ++i) {
+        // what a feed sends: a few decimals
+        const int decimals = generator() % 7;
+        const double price = static_cast<double>(generator() % 100000000)
+            / std::pow(10.0, decimals);
+        expectSameAsToChars(price);
+        expectSameAsToChars(static_cast<float>(price));
+    }
+}
+
+TEST(RealFormatterTest, testFormatPolicies)
+{
+    char buf[64];
+    EXPECT_EQ(4, ShortestFormat::format(1.25, buf, sizeof(buf)));
+    EXPECT_STREQ("1.25", buf);
+    EXPECT_EQ(8, LegacyFormat::format(1.25, buf, sizeof(buf)));
+    EXPECT_STREQ(std::to_string(1.25).c_str(), buf);
+    LegacyFormat::format(2.5L, buf, sizeof(buf));
+    EXPECT_STREQ(std::to_string(2.5L).c_str(), buf);
+}
+
+TEST(RealFormatterTest, testPlain)
+{
+    const double cases[] = {
+        0.0, -0.0, 1.0, 0.1, 0.1 + 0.2, 100.0, 1e20, 1e22, 1e23, 1.5e-7,
+        -2.5e-10, 5e-324, 1e38, 3.4e38, 1e300, 1.7976931348623157e308,
+        std::numeric_limits<double>::infinity(),
+    };
+    for (const auto real : cases) {
+        expectSameAsToCharsFixed<double>(real);
+        expectSameAsToCharsFixed<float>(static_cast<float>(real));
+    }
+
+    std::mt19937_64 generator(9753);
+    for (int i = 0; i < 100000; ++i) {
+        const uint64_t bits = generator();
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        if (!std::isnan(d)) {
+            expectSameAsToCharsFixed(d);
+        }
+    }
+
+    char buf[8];
+    EXPECT_EQ(21, formatPlain(1e20, buf, sizeof(buf)));
+    EXPECT_STREQ("1000000", buf);
+    EXPECT_EQ(10, formatPlain(1.5e-7, buf, sizeof(buf)));
+    EXPECT_STREQ("0.00000", buf);
+}
+
+TEST(RealFormatterTest, testFixed)
+{
+    const double cases[] = {
+        0.0, -0.0, 1.0, -1.0, 0.5, 1.5, 2.5, -2.5, 0.125, 0.375, 2.675,
+        1.005, 0.045, 1234.5678, -0.001, 0.1 + 0.2, 1e15, 4503599627370497.0,
+        1e20, 1e300, 5e-324, 1.7976931348623157e308,
+        std::numeric_limits<double>::infinity(),
+        -std::numeric_limits<double>::infinity(),
+    };
+    for (const auto real : cases) {
+        for (int decimals = 0; decimals <= MaxFixedDecimals; ++decimals) {
+            expectSameAsPrintf(real, decimals);
+        }
+    }
+
+    std::mt19937_64 generator(8642);
+    for (int i = 0; i < 200000; ++i) {
+        const int decimals = generator() % 10;
+        // prices and exact halves, where the rounding is decided
+        const double price = static_cast<double>(generator() % 100000000)
+            / std::pow(10.0, generator() % 9);
+        expectSameAsPrintf(price, decimals);
+        expectSameAsPrintf(std::ldexp(
+                    static_cast<double>(generator() % 1000000), -10), decimals);
+        expectSameAsPrintf(static_cast<float>(price), decimals);
+    }
+
+    char buf[64];
+    formatFixed(2.675, 2, buf, sizeof(buf));
+    EXPECT_STREQ("2.67", buf);
+    formatFixed(0.125, 2, buf, sizeof(buf));
+    EXPECT_STREQ("0.12", buf);
+    // the scaled product rounds to a tie, the exact one is just under it,
+    // or just over it
+    formatFixed(1200.55, 1, buf, sizeof(buf));
+    EXPECT_STREQ("1200.5", buf);
+    formatFixed(31.285, 2, buf, sizeof(buf));
+    EXPECT_STREQ("31.29", buf);
+    formatFixed(32.9765, 3, buf, sizeof(buf));
+    EXPECT_STREQ("32.977", buf);
+    formatFixed(-0.001, 2, buf, sizeof(buf));
+    EXPECT_STREQ("-0.00", buf);
+    formatFixed(1.5f, 4, buf, sizeof(buf));
+    EXPECT_STREQ("1.5000", buf);
+    formatFixed(2.5L, 3, buf, sizeof(buf));
+    EXPECT_STREQ("2.500", buf);
+
+    char small[4];
+    EXPECT_EQ(6, formatFixed(-12.345, 2, small, sizeof(small)));
+    EXPECT_STREQ("-12", small);
+}
+
+TEST(RealFormatterTest, testRealFormat)
+{
+    char buf[64];
+    EXPECT_EQ(5, RealFormat::fixed(2).format(12.5, buf, sizeof(buf)));
+    EXPECT_STREQ("12.50", buf);
+    RealFormat::plain().format(1e20, buf, sizeof(buf));
+    EXPECT_STREQ("100000000000000000000", buf);
+    RealFormat::shortest().format(1e20, buf, sizeof(buf));
+    EXPECT_STREQ("1e+20", buf);
+    FixedFormat<4>::format(0.1, buf, sizeof(buf));
+    EXPECT_STREQ("0.1000", buf);
+    PlainFormat::format(1.5e-7f, buf, sizeof(buf));
+    EXPECT_STREQ("0.00000015", buf);
+
+    // a key per format
+    EXPECT_TRUE(RealFormat::of<FixedFormat<2>>() == RealFormat::fixed(2));
+    EXPECT_TRUE(RealFormat::of<ShortestFormat>() == RealFormat::shortest());
+    EXPECT_TRUE(RealFormat::fixed(2) != RealFormat::fixed(3));
+    EXPECT_TRUE(RealFormat::plain() != RealFormat::shortest());
+    EXPECT_TRUE(RealFormat::legacy() != RealFormat::fixed(0));
+}
+
+}
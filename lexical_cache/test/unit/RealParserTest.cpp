@@ -0,0 +1,192 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/real_parser.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+namespace {
+
+// parseReal's result, compared bit for bit with strtod / strtof's. strtod
+// also flags subnormal results with ERANGE, parseReal only throws when the
+// result is 0 or infinite
+template <typename real_type>
+void expectSameAsStrtod(const std::string& str)
+{
+    errno = 0;
+    char* end = nullptr;
+    const real_type expected = std::is_same<real_type, float>::value
+        ? std::strtof(str.c_str(), &end) : std::strtod(str.c_str(), &end);
+    const bool overflow = errno == ERANGE
+        && (expected == 0 || std::isinf(expected));
+
+    if (overflow) {
+        EXPECT_THROW(parseReal<real_type>(str), std::out_of_range) << str;
+        return;
+    }
+    const real_type actual = parseReal<real_type>(str);
+    EXPECT_EQ(0, memcmp(&expected, &actual, sizeof(real_type)))
+        << str << ": " << expected << " != " << actual;
+}
+
+}
+
+TEST(RealParserTest, testSpecialCases)
+{
+    const char* cases[] = {
+        "0", "-0", "0.0", "1", "-1", "1.5", "  +1.5", "\t-2.25", ".5", "5.",
+        "1234.5678", "-9999.9999", "0.1", "0.3", "123456789012345678",
+        "1e23", "8.41e21", "5e-324", "4.9406564584124654e-324",
+        "2.2250738585072011e-308", "2.2250738585072014e-308",
+        "1.7976931348623157e308", "1.7976931348623158e308",
+        "1.7976931348623159e308", "1e309", "1e-400", "9007199254740993",
+        "9007199254740995", "7.3177701707893310e+15",
+        "3.14159265358979323846264338327950288", "0.000000000000000000001",
+        "1.5abc", "1e", "1e+", "1e-", "1.e5", "0x1.8p1", "-0x10", "0x",
+        "inf", "-Infinity", "nan", "1E5", "123e-2",
+    };
+    for (const auto* str : cases) {
+        expectSameAsStrtod<double>(str);
+        expectSameAsStrtod<float>(str);
+    }
+    EXPECT_TRUE(std::signbit(parseReal<double>("-0")));
+}
+
+TEST(RealParserTest, testInvalid)
+{
+    const char* cases[] = {"", " ", "abc", "-", "+", "+-1", "-+1", ".", "e5"};
+    for (const auto* str : cases) {
+        EXPECT_THROW(parseReal<double>(str), std::invalid_argument) << str;
+        EXPECT_THROW(parseReal<float>(str), std::invalid_argument) << str;
+        EXPECT_THROW(parseReal<long double>(str), std::invalid_argument)
+            << str;
+    }
+}
+
+TEST(RealParserTest, testTryParse)
+{
+    double value = -1;
+    EXPECT_EQ(ParseError::None, tryParseReal(" 1.5x", value));
+    EXPECT_DOUBLE_EQ(1.5, value);
+    EXPECT_EQ(ParseError::None, tryParseReal("0x10", value));
+    EXPECT_DOUBLE_EQ(16, value);
+
+    // value is left alone
+    EXPECT_EQ(ParseError::NoConversion, tryParseReal("N/A", value));
+    EXPECT_EQ(ParseError::NoConversion, tryParseReal("-", value));
+    EXPECT_EQ(ParseError::OutOfRange, tryParseReal("1e999", value));
+    EXPECT_EQ(ParseError::OutOfRange, tryParseReal("1e-999", value));
+    EXPECT_DOUBLE_EQ(16, value);
+
+    float f;
+    EXPECT_EQ(ParseError::OutOfRange, tryParseReal("1e39", f));
+    long double ld;
+    EXPECT_EQ(ParseError::NoConversion, tryParseReal("e5", ld));
+}
+
+TEST(RealParserTest, testNotNullTerminated)
+{
+    const char buffer[] = "1.25e2|7";
+    EXPECT_DOUBLE_EQ(125.0, parseReal<double>(std::string_view(buffer, 6)));
+    EXPECT_DOUBLE_EQ(1.25, parseReal<double>(std::string_view(buffer, 4)));
+    EXPECT_DOUBLE_EQ(1.0, parseReal<double>(std::string_view(buffer, 1)));
+}
+
+TEST(RealParserTest, testShortDecimal)
+{
+    const auto shortDecimal = [](const char* str, double& value) {
+        return detail::parseShortDecimal(str, str + strlen(str), false, value);
+    };
+    double value = 0;
+    EXPECT_TRUE(shortDecimal("1234.5678", value));
+    EXPECT_EQ(1234.5678, value);
+    EXPECT_TRUE(shortDecimal("00000000", value));
+    EXPECT_EQ(0.0, value);
+    EXPECT_TRUE(shortDecimal(".5000000", value));
+    EXPECT_EQ(0.5, value);
+    EXPECT_TRUE(shortDecimal("5000000.", value));
+    EXPECT_EQ(5000000.0, value);
+    EXPECT_TRUE(shortDecimal("9007199254740992", value));
+    EXPECT_EQ(9007199254740992.0, value);
+    EXPECT_TRUE(shortDecimal("12345678.1234567", value));
+    EXPECT_EQ(12345678.1234567, value);
+
+    // left to the general parser
+    const char* others[] = {
+        "1.5", "1.2.3456", "12345e-5", "1234.567 ", "+1234.5678",
+        "12345678901234567", "1.000000000000001", "9007199254740993",
+        "0x1234567", "infinity"};
+    for (const auto* str : others) {
+        EXPECT_FALSE(shortDecimal(str, value)) << str;
+        expectSameAsStrtod<double>(str);
+        expectSameAsStrtod<float>(str);
+    }
+
+    std::mt19937_64 generator(8642);
+    for (int i = 0; i < 200000; ++i) {
+        // up to 16 chars with or without a '.', signed or not
+        const int digits = 1 + generator() % 16;
+        std::string str;
+        for (int d = 0; d < digits; ++d) {
+            str += static_cast<char>('0' + generator() % 10);
+        }
+        if (digits < 16 && generator() % 4) {
+            str.insert(generator() % (digits + 1), ".");
+        }
+        if (generator() % 2) {
+            str.insert(0, "-");
+        }
+        expectSameAsStrtod<double>(str);
+        expectSameAsStrtod<float>(str);
+    }
+}
+
+TEST(RealParserTest, testRandomDigits)
+{
+    std::mt19937_64 generator(12345);
+    for (int i = 0; i < 200000; ++i) {
+        // up to 20 digits, so the fallback is exercised too
+        const int digits = 1 + generator() % 20;
+        std::string str;
+        for (int d = 0; d < digits; ++d) {
+            str += static_cast<char>('0' + generator() % 10);
+        }
+        const int point = generator() % (digits + 1);
+        str.insert(point, ".");
+        str += "e" + std::to_string(static_cast<int>(generator() % 700) - 350);
+        expectSameAsStrtod<double>(str);
+        expectSameAsStrtod<float>(str);
+    }
+}
+
+TEST(RealParserTest, testRoundTrip)
+{
+    std::mt19937_64 generator(54321);
+    char buf[64];
+    for (int i = 0; i < 200000; ++i) {
+        // every finite double is equally likely
+        double d;
+        uint64_t bits = generator();
+        memcpy(&d, &bits, sizeof(d));
+        if (!std::isfinite(d)) {
+            continue;
+        }
+        snprintf(buf, sizeof(buf), "%.17g", d);
+        expectSameAsStrtod<double>(buf);
+        snprintf(buf, sizeof(buf), "%.*g", static_cast<int>(generator() % 17) + 1, d);
+        expectSameAsStrtod<double>(buf);
+        expectSameAsStrtod<float>(buf);
+    }
+}
+
+}
@@ -0,0 +1,109 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/seqlock_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+TEST(SeqLockCacheTest, testCast)
+{
+    SeqLockCache<double, 4> cache;
+    EXPECT_TRUE(cache.empty());
+
+    EXPECT_FLOAT_EQ(1.0, cache.castToReal("1.0"));
+    EXPECT_FLOAT_EQ(1.0, cache.castToReal("1.0"));
+    EXPECT_STREQ("2.5", cache.castToStr(2.5));
+    EXPECT_STREQ("2.5", cache.castToStr(2.5 + 1e-9));
+
+    EXPECT_EQ(1u, cache.size(String2Real));
+    EXPECT_EQ(1u, cache.size(Real2String));
+    EXPECT_EQ(2, cache.hitCount());
+    EXPECT_EQ(2, cache.missCount());
+
+    cache.clear(String2Real);
+    EXPECT_TRUE(cache.empty(String2Real));
+    EXPECT_FALSE(cache.empty());
+}
+
+TEST(SeqLockCacheTest, testClosestMatch)
+{
+    // 1e10's ulp is above FLT_EPSILON, reals match within 4 ulps. low and
+    // high are 6 apart, both cached, and a real between them matches both
+    const double low = 1e10;
+    double high = low;
+    for (int i = 0; i < 6; ++i) {
+        high = std::nextafter(high, 2e10);
+    }
+    const double nearHigh = std::nextafter(std::nextafter(high, 0.0), 0.0);
+    const double nearLow = std::nextafter(std::nextafter(low, 2e10), 2e10);
+
+    SeqLockCache<double, 4> cache;
+    const std::string lowStr = cache.castToStr(low);
+    const std::string highStr = cache.castToStr(high);
+    EXPECT_EQ(2u, cache.size(Real2String));
+
+    EXPECT_EQ(highStr, cache.castToStr(nearHigh));
+    EXPECT_EQ(lowStr, cache.castToStr(nearLow));
+    EXPECT_EQ(2, cache.hitCount());
+}
+
+TEST(SeqLockCacheTest, testCacheFull)
+{
+    constexpr int cacheSize = 4;
+    SeqLockCache<double, cacheSize> cache;
+
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_FLOAT_EQ(i, cache.castToReal(std::to_string(i)));
+        EXPECT_FLOAT_EQ(i, std::stod(cache.castToStr(i)));
+        EXPECT_GE(cacheSize, cache.size(String2Real));
+        EXPECT_GE(cacheSize, cache.size(Real2String));
+    }
+
+    // the most recent one survives the eviction
+    cache.resetStats();
+    cache.castToReal("99");
+    EXPECT_EQ(1, cache.hitCount());
+}
+
+TEST(SeqLockCacheTest, testLongStringNotCached)
+{
+    SeqLockCache<double, 4, 8> cache;
+    EXPECT_FLOAT_EQ(1.25, cache.castToReal("1.250000000000"));
+    EXPECT_TRUE(cache.empty(String2Real));
+
+    // doesn't fit in 8 chars either
+    EXPECT_STREQ("0.30000000000000004", cache.castToStr(0.1 + 0.2));
+    EXPECT_TRUE(cache.empty(Real2String));
+}
+
+TEST(SeqLockCacheTest, testConcurrentReadWrite)
+{
+    // fewer slots than keys, so readers race with evictions all the time
+    SeqLockCache<double, 16> cache;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&cache, t]() {
+            for (int i = 0; i < 20000; ++i) {
+                const int key = (i * (t + 1)) % 40;
+                ASSERT_EQ(key, cache.castToReal(std::to_string(key)));
+                ASSERT_EQ(key, std::stod(cache.castToStr(key)));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(8*20000*2, cache.hitCount() + cache.missCount());
+}
+
+}
@@ -0,0 +1,87 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/set_associative_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+TEST(SetAssociativeCacheTest, testCast)
+{
+    SetAssociativeCache<double, 16, 4> cache;
+    EXPECT_DOUBLE_EQ(1.25, cache.castToReal("1.25"));
+    EXPECT_DOUBLE_EQ(1.25, cache.castToReal("1.25"));
+    EXPECT_STREQ("1.25", cache.castToStr(1.25));
+    EXPECT_STREQ("1.25", cache.castToStr(1.25));
+    EXPECT_EQ(2, cache.hitCount());
+    EXPECT_EQ(2, cache.missCount());
+    EXPECT_EQ(1u, cache.size(String2Real));
+    EXPECT_EQ(1u, cache.size(Real2String));
+
+    cache.clear(String2Real);
+    EXPECT_TRUE(cache.empty(String2Real));
+    EXPECT_FALSE(cache.empty());
+}
+
+TEST(SetAssociativeCacheTest, testEvictionBoundedBySet)
+{
+    constexpr int ways = 4;
+    SetAssociativeCache<double, 1, ways> cache;
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_DOUBLE_EQ(i, cache.castToReal(std::to_string(i)));
+        EXPECT_STREQ(shortestString(i).c_str(), cache.castToStr(i));
+    }
+    EXPECT_EQ(static_cast<size_t>(ways), cache.size(String2Real));
+    EXPECT_EQ(static_cast<size_t>(ways), cache.size(Real2String));
+}
+
+TEST(SetAssociativeCacheTest, testLargeCapacity)
+{
+    constexpr int count = 4096;
+    // twice the room needed, so few sets overflow
+    static SetAssociativeCache<double, 2 * count / 8, 8> cache;
+    for (int i = 0; i < count; ++i) {
+        cache.castToReal(std::to_string(i));
+    }
+    cache.resetStats();
+    for (int i = 0; i < count; ++i) {
+        EXPECT_DOUBLE_EQ(i, cache.castToReal(std::to_string(i)));
+    }
+    // a set gets Poisson(4) keys, LRU misses all of a set that overflows
+    // when they're scanned in order: about 5% of them
+    EXPECT_LT(0.92 * count, cache.hitCount());
+}
+
+TEST(SetAssociativeCacheTest, testAlmostEqualHit)
+{
+    SetAssociativeCache<double, 64, 4> cache;
+    const double d = 1234.5678;
+    const auto* str = cache.castToStr(d);
+    EXPECT_EQ(str, cache.castToStr(std::nextafter(d, 1e300)));
+    EXPECT_EQ(str, cache.castToStr(std::nextafter(d, -1e300)));
+    EXPECT_EQ(2, cache.hitCount());
+}
+
+TEST(SetAssociativeCacheTest, testLongStringsNotCached)
+{
+    SetAssociativeCache<double, 4, 2, 8> cache;
+    EXPECT_DOUBLE_EQ(1.2345678, cache.castToReal("1.2345678"));
+    EXPECT_TRUE(cache.empty(String2Real));
+    EXPECT_STREQ("0.30000000000000004", cache.castToStr(0.1 + 0.2));
+    EXPECT_TRUE(cache.empty(Real2String));
+}
+
+TEST(SetAssociativeCacheTest, testThreadLocal)
+{
+    SetAssociativeCache<double, 16, 4, 32, ThreadLocal> cache;
+    EXPECT_DOUBLE_EQ(2.5, cache.castToReal("2.5"));
+    EXPECT_STREQ("2.5", cache.castToStr(2.5));
+    EXPECT_EQ(2u, cache.size());
+}
+
+}
@@ -0,0 +1,83 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/sharded_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+TEST(ShardedCacheTest, testCast)
+{
+    ShardedCache<double, 16, 4> cache;
+    EXPECT_FLOAT_EQ(1.0, cache.castToReal("1.0"));
+    EXPECT_FLOAT_EQ(1.0, cache.castToReal("1.0"));
+    EXPECT_STREQ("2.5", cache.castToStr(2.5));
+    EXPECT_STREQ("2.5", cache.castToStr(2.5));
+
+    EXPECT_EQ(1u, cache.size(String2Real));
+    EXPECT_EQ(1u, cache.size(Real2String));
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(2, stats.m_hits);
+    EXPECT_EQ(2, stats.m_misses);
+
+    // both "1.0" lookups went to the same shard
+    const auto shard = cache.shardOf(std::string("1.0"));
+    EXPECT_LE(1, cache.shardStats(shard).m_hits);
+    EXPECT_LE(1, cache.shardStats(shard).m_misses);
+
+    EXPECT_STREQ("2.500", cache.castToStr(2.5, RealFormat::fixed(3)));
+    EXPECT_EQ(2u, cache.size(Real2String));
+
+    cache.clear();
+    EXPECT_TRUE(cache.empty());
+}
+
+TEST(ShardedCacheTest, testCacheFull)
+{
+    constexpr int shards = 4;
+    ShardedCache<double, 8, shards> cache;
+
+    for (int i = 0; i < 100; ++i) {
+        cache.castToReal(std::to_string(i));
+    }
+
+    // never more than the per shard capacity in any shard
+    EXPECT_GE(8u, cache.size(String2Real));
+}
+
+TEST(ShardedCacheTest, testConcurrentCast)
+{
+    ShardedCache<double, 64, 8> cache;
+
+    std::vector< std::pair<std::string, double> > pairs;
+    for (int i = 0; i < 32; ++i) {
+        pairs.push_back(randomStringRealPair());
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&cache, &pairs, t]() {
+            for (int i = 0; i < 10000; ++i) {
+                const auto& p = pairs[(i + t) % pairs.size()];
+                EXPECT_NEAR(p.second, cache.castToReal(p.first), 0.001);
+                EXPECT_NEAR(p.second, std::stod(cache.castToStr(p.second)),
+                        0.001);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(8*10000*2, stats.m_hits + stats.m_misses);
+}
+
+}
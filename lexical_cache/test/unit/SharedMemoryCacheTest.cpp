@@ -0,0 +1,256 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/shared_memory_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+class SharedMemoryCacheTest : public ::testing::Test
+{
+protected:
+    using CacheType = SharedMemoryCache<double, 16>;
+
+    void SetUp() override
+    {
+        CacheType::remove(m_name);
+    }
+
+    void TearDown() override
+    {
+        CacheType::remove(m_name);
+    }
+
+    // runs f in a child process, true if it exited normally with 0
+    template <typename F>
+    static bool inChild(F f)
+    {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            _exit(f() ? 0 : 1);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    const std::string m_name =
+        "/lexical_cache_test_" + std::to_string(::getpid());
+};
+
+TEST_F(SharedMemoryCacheTest, testCast)
+{
+    CacheType cache(m_name);
+    EXPECT_TRUE(cache.empty());
+    EXPECT_FLOAT_EQ(1.5, cache.castToReal("1.5"));
+    EXPECT_FLOAT_EQ(1.5, cache.castToReal("1.5"));
+    EXPECT_STREQ("2.5", cache.castToStr(2.5));
+    EXPECT_STREQ("2.5", cache.castToStr(2.5 + 1e-9));
+    EXPECT_EQ(2, cache.hitCount());
+    EXPECT_EQ(2, cache.missCount());
+
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_FLOAT_EQ(i, cache.castToReal(std::to_string(i)));
+        EXPECT_FLOAT_EQ(i, std::stod(cache.castToStr(i)));
+    }
+    EXPECT_EQ(16u, cache.size(String2Real));
+    EXPECT_EQ(16u, cache.size(Real2String));
+
+    cache.clear(String2Real);
+    EXPECT_TRUE(cache.empty(String2Real));
+    EXPECT_FALSE(cache.empty());
+}
+
+TEST_F(SharedMemoryCacheTest, testSharedBetweenMappings)
+{
+    CacheType first(m_name);
+    CacheType second(m_name);
+    first.castToReal("1.5");
+    first.castToStr(2.5);
+
+    EXPECT_EQ(1u, second.size(String2Real));
+    EXPECT_FLOAT_EQ(1.5, second.castToReal("1.5"));
+    EXPECT_STREQ("2.5", second.castToStr(2.5));
+    EXPECT_EQ(2, second.hitCount());
+    EXPECT_EQ(0, second.missCount());
+}
+
+TEST_F(SharedMemoryCacheTest, testSharedBetweenProcesses)
+{
+    CacheType cache(m_name);
+    cache.castToReal("0.5");
+
+    // the child sees the parent's entry and warms the cache for it
+    EXPECT_TRUE(inChild([this]() {
+        CacheType child(m_name);
+        child.castToReal("0.5");
+        for (int i = 1; i < 10; ++i) {
+            child.castToReal(std::to_string(i) + ".5");
+        }
+        return child.hitCount() == 1;
+    }));
+
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_FLOAT_EQ(i + 0.5, cache.castToReal(std::to_string(i) + ".5"));
+    }
+    EXPECT_EQ(10, cache.hitCount());
+    EXPECT_EQ(1, cache.missCount());
+}
+
+TEST_F(SharedMemoryCacheTest, testConcurrentProcesses)
+{
+    // fewer slots than keys, so readers race with evictions all the time
+    std::vector<pid_t> children;
+    for (int p = 0; p < 4; ++p) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            CacheType cache(m_name);
+            for (int i = 0; i < 20000; ++i) {
+                const int key = (i * (p + 1)) % 40;
+                if (cache.castToReal(std::to_string(key)) != key
+                        || std::stod(cache.castToStr(key)) != key) {
+                    _exit(1);
+                }
+            }
+            _exit(0);
+        }
+        children.push_back(pid);
+    }
+    for (const auto pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    CacheType cache(m_name);
+    EXPECT_EQ(16u, cache.size(String2Real));
+    EXPECT_EQ(16u, cache.size(Real2String));
+}
+
+TEST_F(SharedMemoryCacheTest, testWriterDiedMidWrite)
+{
+    // the widest slots, so a fair part of a writer's time goes to writing
+    // them, and enough rounds for some kills to land half way through one
+    using Wide = SharedMemoryCache<double, 4, 248>;
+    for (int round = 0; round < 100; ++round) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            Wide cache(m_name);
+            for (int i = 0;; ++i) {
+                cache.castToReal(std::to_string(i));
+                cache.castToStr(i);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+
+        // the next writer clears what the child left, every slot must be
+        // readable again
+        Wide cache(m_name);
+        cache.clear();
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int i = 0; i < 4; ++i) {
+                EXPECT_FLOAT_EQ(i + 0.5,
+                        cache.castToReal(std::to_string(i) + ".5"));
+                EXPECT_STREQ(std::to_string(i).c_str(), cache.castToStr(i));
+            }
+        }
+        EXPECT_EQ(8, cache.hitCount());
+        EXPECT_EQ(8, cache.missCount());
+    }
+}
+
+TEST_F(SharedMemoryCacheTest, testSetterDied)
+{
+    // the child claims the new region and dies before it's set up
+    EXPECT_TRUE(inChild([this]() {
+        const int fd = shm_open(m_name.c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0 || ftruncate(fd, sizeof(uint64_t)) != 0) {
+            return false;
+        }
+        void* p = mmap(nullptr, sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        static_cast<std::atomic<uint64_t>*>(p)->store(
+                detail::regionState(getpid(), detail::SettingUp));
+        return true;
+    }));
+
+    // well within the time it'd wait for a live one
+    const auto start = std::chrono::steady_clock::now();
+    CacheType cache(m_name);
+    EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::seconds(1));
+    EXPECT_FLOAT_EQ(1.5, cache.castToReal("1.5"));
+    EXPECT_FLOAT_EQ(1.5, cache.castToReal("1.5"));
+    EXPECT_EQ(1, cache.hitCount());
+
+    CacheType other(m_name);
+    EXPECT_EQ(1u, other.size(String2Real));
+}
+
+TEST_F(SharedMemoryCacheTest, testOtherLayoutThrows)
+{
+    CacheType cache(m_name);
+    using Bigger = SharedMemoryCache<double, 32>;
+    EXPECT_THROW(Bigger other(m_name), std::runtime_error);
+    using Floats = SharedMemoryCache<float, 16>;
+    EXPECT_THROW(Floats other(m_name), std::runtime_error);
+
+    // still usable
+    EXPECT_FLOAT_EQ(1.5, cache.castToReal("1.5"));
+}
+
+TEST_F(SharedMemoryCacheTest, testMappedFile)
+{
+    const std::string path = "/tmp" + m_name;
+    {
+        CacheType cache(path, MappedFile);
+        cache.castToReal("1.5");
+    }
+    // the file keeps the entries when nobody has it mapped
+    CacheType cache(path, MappedFile);
+    EXPECT_FLOAT_EQ(1.5, cache.castToReal("1.5"));
+    EXPECT_EQ(1, cache.hitCount());
+    EXPECT_TRUE(CacheType::remove(path, MappedFile));
+    EXPECT_FALSE(CacheType::remove(path, MappedFile));
+}
+
+TEST(RobustMutexTest, testOwnerDied)
+{
+    void* p = mmap(nullptr, sizeof(detail::RobustMutex),
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(MAP_FAILED, p);
+    auto* mutex = new (p) detail::RobustMutex();
+    mutex->init();
+
+    EXPECT_FALSE(mutex->lock());
+    mutex->unlock();
+
+    // the child dies holding it
+    const pid_t pid = fork();
+    if (pid == 0) {
+        mutex->lock();
+        _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+
+    EXPECT_TRUE(mutex->lock());
+    mutex->unlock();
+    EXPECT_FALSE(mutex->lock());
+    mutex->unlock();
+    munmap(p, sizeof(detail::RobustMutex));
+}
+
+}
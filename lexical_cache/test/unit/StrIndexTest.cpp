@@ -0,0 +1,201 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+template <typename index_type>
+class StrIndexTest : public ::testing::Test
+{
+protected:
+    static constexpr int slotCount = 64;
+
+    // keys are owned by the caller, as in Cache
+    std::vector<std::string> makeKeys(int count) const
+    {
+        std::vector<std::string> keys;
+        for (int i = 0; i < count; ++i) {
+            keys.push_back(std::to_string(i * 1.25));
+        }
+        return keys;
+    }
+};
+
+using StrIndexes = ::testing::Types<
+    MapStrIndex<CstrHash>, TagStrIndex<64>, DenseStrIndex<64, CstrHash>,
+    FlatStrIndex<64> >;
+TYPED_TEST_CASE(StrIndexTest, StrIndexes);
+
+TYPED_TEST(StrIndexTest, testFindInsertErase)
+{
+    TypeParam index;
+    const auto keys = this->makeKeys(TestFixture::slotCount);
+    for (int i = 0; i < TestFixture::slotCount; ++i) {
+        EXPECT_EQ(-1, index.find(keys[i]));
+        index.insert(keys[i], i);
+    }
+    EXPECT_EQ(keys.size(), index.size());
+
+    // every key finds its own slot, a prefix or a longer string doesn't
+    for (int i = 0; i < TestFixture::slotCount; ++i) {
+        EXPECT_EQ(i, index.find(keys[i]));
+        const auto longer = keys[i] + "1";
+        EXPECT_EQ(-1, index.find(longer));
+        const auto prefix = keys[i].substr(0, keys[i].size() - 1);
+        EXPECT_EQ(-1, index.find(prefix));
+    }
+
+    index.erase(keys[3], 3);
+    EXPECT_EQ(-1, index.find(keys[3]));
+    EXPECT_EQ(keys.size() - 1, index.size());
+
+    const std::string other = "other";
+    index.insert(other, 3);
+    EXPECT_EQ(3, index.find(other));
+
+    int count = 0;
+    index.forEach([&](std::string_view key, int slot) {
+        EXPECT_EQ(slot, index.find(key));
+        ++count;
+    });
+    EXPECT_EQ(static_cast<int>(TestFixture::slotCount), count);
+
+    index.clear();
+    EXPECT_TRUE(index.empty());
+    EXPECT_EQ(-1, index.find(other));
+}
+
+TEST(TagStrIndexTest, testPartialVector)
+{
+    // fewer slots than a SIMD vector holds, the padding never matches
+    TagStrIndex<5> index;
+    const std::vector<std::string> keys = {"1", "2", "3", "4", "5"};
+    for (int i = 0; i < 5; ++i) {
+        index.insert(keys[i], i);
+    }
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(i, index.find(keys[i]));
+    }
+    EXPECT_EQ(-1, index.find(""));
+    EXPECT_EQ(-1, index.find("6"));
+}
+
+TEST(TagStrIndexTest, testCacheUsesTagsWhenSmall)
+{
+    EXPECT_TRUE((std::is_same<TagStrIndex<64>,
+                AutoIndex::StrIndex<64> >::value));
+    EXPECT_TRUE((std::is_same<FlatStrIndex<65>,
+                AutoIndex::StrIndex<65> >::value));
+
+    // a full small cache, evicting through the tag index
+    Cache<double, 64> cache;
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_DOUBLE_EQ(i, cache.castToReal(std::to_string(i)));
+    }
+    cache.resetStats();
+    for (int i = 136; i < 200; ++i) {
+        EXPECT_DOUBLE_EQ(i, cache.castToReal(std::to_string(i)));
+    }
+    EXPECT_EQ(64, cache.hitCount());
+}
+
+TEST(FlatTableTest, testEraseKeepsRunsReachable)
+{
+    struct Entry
+    {
+        uint32_t m_hash;
+        int m_slot;
+    };
+    constexpr int slotCount = 32;
+    detail::FlatTable<Entry, slotCount> table;
+
+    // few distinct hashes, so runs are long and wrap around the table
+    auto hashOf = [](int slot) { return static_cast<uint32_t>(slot % 5 + 60); };
+    std::vector<bool> present(slotCount, false);
+    std::mt19937 generator(42);
+    for (int i = 0; i < 10000; ++i) {
+        const int slot = generator() % slotCount;
+        if (present[slot]) {
+            EXPECT_TRUE(table.erase(hashOf(slot), slot));
+        }
+        else {
+            table.insert(Entry{hashOf(slot), slot});
+        }
+        present[slot] = !present[slot];
+
+        for (int s = 0; s < slotCount; ++s) {
+            const bool found = table.find(hashOf(s),
+                    [s](const Entry& e) { return e.m_slot == s; });
+            ASSERT_EQ(present[s], found) << i << ": " << s;
+        }
+    }
+}
+
+template <typename index_policy>
+class IndexPolicyTest : public ::testing::Test
+{
+};
+
+using IndexPolicies =
+    ::testing::Types<MapIndex, DenseIndex, FlatIndex, AutoIndex>;
+TYPED_TEST_CASE(IndexPolicyTest, IndexPolicies);
+
+TYPED_TEST(IndexPolicyTest, testCacheFull)
+{
+    constexpr int cacheSize = 100;
+    static Cache<double, cacheSize, NoLock, LruEviction, AdmitAll, 40,
+           TypeParam> cache;
+    cache.clear();
+    cache.resetStats();
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 2 * cacheSize; ++i) {
+            EXPECT_DOUBLE_EQ(i, cache.castToReal(std::to_string(i)));
+            EXPECT_STREQ(shortestString(i * 0.5).c_str(),
+                    cache.castToStr(i * 0.5));
+        }
+    }
+    EXPECT_EQ(static_cast<size_t>(cacheSize), cache.size(String2Real));
+    EXPECT_EQ(static_cast<size_t>(cacheSize), cache.size(Real2String));
+
+    // the most recent half is cached
+    cache.resetStats();
+    for (int i = cacheSize; i < 2 * cacheSize; ++i) {
+        EXPECT_DOUBLE_EQ(i, cache.castToReal(std::to_string(i)));
+        EXPECT_STREQ(shortestString(i * 0.5).c_str(), cache.castToStr(i * 0.5));
+    }
+    EXPECT_EQ(2 * cacheSize, cache.hitCount());
+}
+
+
+TYPED_TEST(IndexPolicyTest, testEmptyAndNullKeys)
+{
+    // what DenseStrIndex used as its empty and deleted keys, tryCastToReal
+    // caches both as strings that aren't numbers
+    Cache<double, 4, NoLock, LruEviction, AdmitAll, 40, TypeParam> cache;
+    const std::string_view empty;
+    const std::string_view null("\0", 1);
+    for (int round = 0; round < 2; ++round) {
+        EXPECT_EQ(ParseError::NoConversion, cache.tryCastToReal(empty).error());
+        EXPECT_EQ(ParseError::NoConversion, cache.tryCastToReal("").error());
+        EXPECT_EQ(ParseError::NoConversion, cache.tryCastToReal(null).error());
+    }
+    EXPECT_EQ(2u, cache.size(String2Real));
+    EXPECT_EQ(4, cache.hitCount());
+
+    // and evicted like the others
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_DOUBLE_EQ(i, cache.castToReal(std::to_string(i)));
+    }
+    EXPECT_THROW(cache.castToReal(null), std::invalid_argument);
+    EXPECT_THROW(cache.castToReal(empty), std::invalid_argument);
+    EXPECT_EQ(4u, cache.size(String2Real));
+}
+
+}
@@ -5,6 +5,12 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <fstream>
+#include <iterator>
+#include <cmath>
+#include <cstdio>
+#include <unistd.h>
+
 using namespace ::testing;
 
 namespace lexical_cache {
@@ -52,4 +58,488 @@ TEST(StringToRealTest, testCacheFull)
     EXPECT_EQ(cacheSize, cache.size(String2Real)) << cache;
 }
 
+TEST(RealToStringTest, testAlmostEqualHit)
+{
+    constexpr int cacheSize = 4;
+    Cache<double, cacheSize> cache;
+
+    const std::string str = cache.castToStr(1.0);
+    EXPECT_EQ(1u, cache.size(Real2String));
+
+    // within FLT_EPSILON
+    EXPECT_EQ(str, cache.castToStr(1.0 + 1e-9));
+    EXPECT_EQ(str, cache.castToStr(1.0 - 1e-9));
+    EXPECT_EQ(1u, cache.size(Real2String));
+
+    // a few ulps away
+    const double big = 1e12;
+    const std::string bigStr = cache.castToStr(big);
+    EXPECT_EQ(bigStr, cache.castToStr(std::nextafter(big, 2*big)));
+    EXPECT_EQ(2u, cache.size(Real2String));
+
+    cache.castToStr(2.0);
+    cache.castToStr(3.0);
+    cache.castToStr(4.0);
+    EXPECT_EQ(cacheSize, cache.size(Real2String)) << cache;
+}
+
+TEST(StringToRealTest, testSpanLookup)
+{
+    Cache<double, 4> cache;
+    // fields of a receive buffer, none of them null terminated
+    const char buffer[] = "1.25|2.5|1.25|2.5|1.2";
+    const char* fields[] = {buffer, buffer + 5, buffer + 9, buffer + 14};
+    const size_t lengths[] = {4, 3, 4, 3};
+    const double expected[] = {1.25, 2.5, 1.25, 2.5};
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_DOUBLE_EQ(expected[i], cache.castToReal(fields[i], lengths[i]));
+    }
+    EXPECT_EQ(2, cache.hitCount());
+    EXPECT_EQ(2u, cache.size(String2Real));
+
+    // a prefix of a cached string is a different key
+    EXPECT_DOUBLE_EQ(1.2, cache.castToReal(std::string_view(buffer, 3)));
+    EXPECT_EQ(3, cache.missCount());
+    EXPECT_DOUBLE_EQ(1.2, cache.castToReal(std::string("1.2")));
+    EXPECT_EQ(3, cache.hitCount());
+}
+
+TEST(StringToRealTest, testOverflowStrings)
+{
+    constexpr int cacheSize = 2;
+    constexpr int inlineSize = 8;
+    Cache<double, cacheSize, NoLock, LruEviction, AdmitAll, inlineSize> cache;
+
+    // inline, just fits, overflow, and a slot going back to inline
+    const std::vector<std::string> strs = {
+        "1.5", "1.234567", "1.2345678", "-98765.4321", "2.5", "3.25"};
+    for (const auto& str : strs) {
+        EXPECT_DOUBLE_EQ(std::stod(str), cache.castToReal(str));
+        EXPECT_DOUBLE_EQ(std::stod(str), cache.castToReal(str));
+    }
+    EXPECT_EQ(strs.size(), cache.hitCount());
+    EXPECT_EQ(strs.size(), cache.missCount());
+
+    const std::vector<std::pair<double, std::string>> reals = {
+        {1.5, "1.5"}, {0.1 + 0.2, "0.30000000000000004"}, {-123.0, "-123"},
+        {1234.5678, "1234.5678"}, {4.0, "4"}};
+    for (const auto& real : reals) {
+        EXPECT_STREQ(real.second.c_str(), cache.castToStr(real.first));
+        EXPECT_STREQ(real.second.c_str(), cache.castToStr(real.first));
+    }
+    EXPECT_EQ(strs.size() + reals.size(), cache.hitCount());
+}
+
+TEST(StringToRealTest, testLegacyFormat)
+{
+    constexpr int inlineSize = 8;
+    Cache<double, 2, NoLock, LruEviction, AdmitAll, inlineSize, AutoIndex,
+          LegacyFormat> cache;
+
+    // std::to_string's output, inline or not
+    for (const double real : {2.5, 1e20, 1e-3, -7.0}) {
+        EXPECT_STREQ(std::to_string(real).c_str(), cache.castToStr(real));
+        EXPECT_STREQ(std::to_string(real).c_str(), cache.castToStr(real));
+    }
+    EXPECT_EQ(4, cache.hitCount());
+}
+
+TEST(RealToStringTest, testFormatPerCall)
+{
+    Cache<double, 4> cache;
+
+    // one entry per format, each hit only in its own format
+    EXPECT_STREQ("1.5", cache.castToStr(1.5));
+    EXPECT_STREQ("1.50", cache.castToStr(1.5, RealFormat::fixed(2)));
+    EXPECT_STREQ("1.5000", cache.castToStr(1.5, RealFormat::fixed(4)));
+    EXPECT_EQ(3u, cache.size(Real2String));
+    EXPECT_EQ(0, cache.hitCount());
+
+    EXPECT_STREQ("1.50", cache.castToStr(1.5, RealFormat::fixed(2)));
+    EXPECT_STREQ("1.5", cache.castToStr(1.5, RealFormat::shortest()));
+    EXPECT_STREQ("1.5000", cache.castToStr(1.5, RealFormat::fixed(4)));
+    EXPECT_STREQ("1.5", cache.castToStr(1.5));
+    EXPECT_EQ(4, cache.hitCount());
+    EXPECT_EQ(3u, cache.size(Real2String));
+
+    // no scientific notation
+    EXPECT_STREQ("100000000000000000000",
+            cache.castToStr(1e20, RealFormat::plain()));
+    EXPECT_STREQ("0.00000015", cache.castToStr(1.5e-7, RealFormat::plain()));
+    EXPECT_EQ(4u, cache.size(Real2String));
+
+    // the policy sets the format of castToStr(real)
+    Cache<double, 4, NoLock, LruEviction, AdmitAll, 40, AutoIndex,
+          FixedFormat<2>> fixed;
+    EXPECT_STREQ("2.68", fixed.castToStr(2.675000001));
+    EXPECT_STREQ("2.68", fixed.castToStr(2.675000001,
+                RealFormat::of<FixedFormat<2>>()));
+    EXPECT_EQ(1, fixed.hitCount());
+}
+
+template <typename index_policy>
+void testBatchMatchesLoop()
+{
+    Cache<double, 16, NoLock, LruEviction, AdmitAll, 40, index_policy> batch;
+    Cache<double, 16, NoLock, LruEviction, AdmitAll, 40, index_policy> loop;
+
+    // repeats within and across chunks of the batch
+    std::vector<std::string> strs;
+    for (int i = 0; i < 300; ++i) {
+        strs.push_back(std::to_string(randomInt(0, 40) * 0.25));
+    }
+    const std::vector<std::string_view> views(strs.begin(), strs.end());
+    std::vector<double> reals(strs.size());
+    batch.castToRealBatch(views.data(), views.size(), reals.data());
+    for (size_t i = 0; i < strs.size(); ++i) {
+        EXPECT_EQ(loop.castToReal(strs[i]), reals[i]) << strs[i];
+    }
+    EXPECT_EQ(static_cast<long>(strs.size()),
+            batch.hitCount() + batch.missCount());
+    EXPECT_EQ(16u, batch.size(String2Real));
+
+    std::vector<std::string> results(reals.size());
+    batch.castToStrBatch(reals.data(), reals.size(), results.data());
+    for (size_t i = 0; i < reals.size(); ++i) {
+        EXPECT_EQ(loop.castToStr(reals[i]), results[i]);
+    }
+    EXPECT_EQ(16u, batch.size(Real2String));
+
+    batch.castToStrBatch(reals.data(), reals.size(), results.data(),
+            RealFormat::fixed(3));
+    char expected[64];
+    for (size_t i = 0; i < reals.size(); ++i) {
+        snprintf(expected, sizeof(expected), "%.3f", reals[i]);
+        EXPECT_EQ(expected, results[i]);
+    }
+}
+
+TEST(StringToRealTest, testBatch)
+{
+    testBatchMatchesLoop<AutoIndex>();
+    testBatchMatchesLoop<FlatIndex>();
+    testBatchMatchesLoop<MapIndex>();
+    testBatchMatchesLoop<DenseIndex>();
+
+    // a string missing twice in a batch is converted and cached once
+    Cache<double, 4> cache;
+    const std::string_view strs[] = {"1.5", "2.5", "1.5", "1.5"};
+    double reals[4];
+    cache.castToRealBatch(strs, 4, reals);
+    EXPECT_EQ(2, cache.missCount());
+    EXPECT_EQ(2, cache.hitCount());
+    EXPECT_EQ(2u, cache.size(String2Real));
+    EXPECT_DOUBLE_EQ(1.5, reals[3]);
+}
+
+TEST(StringToRealTest, testTryCastToReal)
+{
+    Cache<double, 4> cache;
+    auto result = cache.tryCastToReal("1.5");
+    ASSERT_TRUE(result.hasValue());
+    EXPECT_DOUBLE_EQ(1.5, result.value());
+
+    // a bad string is cached too, the second time it's a hit
+    result = cache.tryCastToReal("N/A");
+    EXPECT_FALSE(result.hasValue());
+    EXPECT_EQ(ParseError::NoConversion, result.error());
+    EXPECT_DOUBLE_EQ(-1, result.valueOr(-1));
+    EXPECT_THROW(result.value(), std::invalid_argument);
+    EXPECT_EQ(2u, cache.size(String2Real));
+    EXPECT_EQ(ParseError::NoConversion, cache.tryCastToReal("N/A").error());
+    EXPECT_EQ(1, cache.hitCount());
+
+    // castToReal still throws, from the negative entry
+    EXPECT_THROW(cache.castToReal("N/A"), std::invalid_argument);
+    EXPECT_EQ(2, cache.hitCount());
+    EXPECT_THROW(cache.castToReal("1e999"), std::out_of_range);
+    EXPECT_THROW(cache.castToReal("1e999"), std::out_of_range);
+    EXPECT_EQ(3, cache.hitCount());
+
+    // and batches, after the whole batch is done
+    std::string_view strs[] = {"-", "1.5", "1e999", "2.5"};
+    double out[4] = {};
+    EXPECT_THROW(cache.castToRealBatch(strs, 4, out), std::invalid_argument);
+    EXPECT_DOUBLE_EQ(1.5, out[1]);
+    EXPECT_DOUBLE_EQ(2.5, out[3]);
+    EXPECT_THROW(cache.castToRealBatch(strs, 4, out), std::invalid_argument);
+
+    // or an error per string
+    ParseError errors[4];
+    EXPECT_EQ(2u, cache.tryCastToRealBatch(strs, 4, out, errors));
+    EXPECT_EQ(ParseError::NoConversion, errors[0]);
+    EXPECT_TRUE(std::isnan(out[0]));
+    EXPECT_EQ(ParseError::None, errors[1]);
+    EXPECT_DOUBLE_EQ(1.5, out[1]);
+    EXPECT_EQ(ParseError::OutOfRange, errors[2]);
+    EXPECT_EQ(ParseError::None, errors[3]);
+    EXPECT_DOUBLE_EQ(2.5, out[3]);
+
+    // negative entries are evicted like the others
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_DOUBLE_EQ(i, *cache.tryCastToReal(std::to_string(i)));
+    }
+    cache.resetStats();
+    EXPECT_FALSE(cache.tryCastToReal("N/A").hasValue());
+    EXPECT_EQ(1, cache.missCount());
+}
+
+TEST(CacheStatsTest, testPerDirection)
+{
+    Cache<double, 2> cache;
+    cache.castToReal("1.5");
+    cache.castToReal("1.5");
+    cache.castToReal("2.5");
+    cache.castToReal("3.5");
+    cache.castToStr(1.5);
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(1, stats.m_strToReal.m_hits);
+    EXPECT_EQ(3, stats.m_strToReal.m_misses);
+    EXPECT_EQ(3, stats.m_strToReal.m_inserts);
+    EXPECT_EQ(1, stats.m_strToReal.m_evictions);
+    EXPECT_EQ(0, stats.m_realToStr.m_hits);
+    EXPECT_EQ(1, stats.m_realToStr.m_misses);
+    EXPECT_EQ(0, stats.m_realToStr.m_evictions);
+    // not timed by default
+    EXPECT_EQ(0, stats.m_strToReal.m_hitLatency.count());
+
+    EXPECT_DOUBLE_EQ(75.0, cache.missRatio(String2Real));
+    EXPECT_DOUBLE_EQ(100.0, cache.missRatio(Real2String));
+    EXPECT_DOUBLE_EQ(80.0, cache.missRatio());
+    EXPECT_EQ(1, cache.hitCount());
+    EXPECT_EQ(1, cache.missCount(Real2String));
+
+    cache.resetStats();
+    EXPECT_EQ(0, cache.hitCount());
+    EXPECT_EQ(0, cache.stats().m_strToReal.m_inserts);
+}
+
+TEST(CacheStatsTest, testLatencyHistograms)
+{
+    Cache<double, 4, NoLock, LruEviction, AdmitAll, 40, AutoIndex,
+          ShortestFormat, NeverBypass, LatencyStats> cache;
+    for (int i = 0; i < 100; ++i) {
+        cache.castToReal(std::to_string(i % 8));
+        cache.castToStr(i % 2);
+    }
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.m_strToReal.m_hits, stats.m_strToReal.m_hitLatency.count());
+    EXPECT_EQ(stats.m_strToReal.m_misses,
+            stats.m_strToReal.m_missLatency.count());
+    EXPECT_EQ(98, stats.m_realToStr.m_hitLatency.count());
+    EXPECT_GT(stats.m_strToReal.m_missLatency.percentile(0.5), 0u);
+    EXPECT_LE(stats.m_realToStr.m_hitLatency.percentile(0.5),
+            stats.m_realToStr.m_hitLatency.percentile(0.99));
+
+    // batches count, but their keys aren't timed
+    std::string_view strs[] = {"0", "1", "2"};
+    double out[3];
+    cache.castToRealBatch(strs, 3, out);
+    EXPECT_EQ(stats.m_strToReal.lookups() + 3,
+            cache.stats().m_strToReal.lookups());
+    EXPECT_EQ(stats.m_strToReal.m_hitLatency.count()
+            + stats.m_strToReal.m_missLatency.count(),
+            cache.stats().m_strToReal.m_hitLatency.count()
+            + cache.stats().m_strToReal.m_missLatency.count());
+}
+
+TEST(CacheStatsTest, testLatencyHistogramBuckets)
+{
+    LatencyHistogram histogram;
+    EXPECT_EQ(0u, histogram.percentile(0.5));
+    histogram.record(0);
+    histogram.record(1);
+    histogram.record(100);
+    histogram.record(100);
+    histogram.record(5000);
+    EXPECT_EQ(5, histogram.count());
+    EXPECT_EQ(1, histogram.bucket(0));
+    EXPECT_EQ(2, histogram.bucket(7));
+    EXPECT_EQ(127u, histogram.percentile(0.5));
+    EXPECT_EQ(8191u, histogram.percentile(0.99));
+    EXPECT_EQ(0u, histogram.percentile(0.1));
+}
+
+TEST(CacheStatsTest, testHistogramsOnlyWhenTimed)
+{
+    EXPECT_EQ(sizeof(DirectionCounts), sizeof(CountStats::State));
+    EXPECT_GE(sizeof(LatencyStats::State),
+            sizeof(DirectionCounts) + 2*sizeof(LatencyHistogram));
+}
+
+TEST(CacheStatsTest, testNoStats)
+{
+    Cache<double, 4, NoLock, LruEviction, AdmitAll, 40, AutoIndex,
+          ShortestFormat, NeverBypass, NoStats> cache;
+    EXPECT_DOUBLE_EQ(1.5, cache.castToReal("1.5"));
+    EXPECT_DOUBLE_EQ(1.5, cache.castToReal("1.5"));
+    EXPECT_STREQ("2.5", cache.castToStr(2.5));
+    EXPECT_EQ(0, cache.hitCount());
+    EXPECT_EQ(0, cache.missCount());
+    EXPECT_EQ(0, cache.stats().m_strToReal.m_inserts);
+}
+
+class SnapshotTest : public ::testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        std::remove(m_path.c_str());
+    }
+
+    std::string readFile() const
+    {
+        std::ifstream in(m_path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const std::string& content) const
+    {
+        std::ofstream(m_path, std::ios::binary) << content;
+    }
+
+    const std::string m_path = "/tmp/lexical_cache_"
+        + std::to_string(::getpid()) + ".snapshot";
+};
+
+TEST_F(SnapshotTest, testSaveAndLoad)
+{
+    Cache<double, 8> cache;
+    const std::string longStr = "1." + std::string(100, '5');
+    cache.castToReal("1.5");
+    cache.castToReal(longStr);
+    cache.castToStr(2.5);
+    cache.castToStr(2.5, RealFormat::fixed(3));
+    cache.tryCastToReal("N/A");
+    cache.tryCastToReal("1e999");
+    ASSERT_TRUE(cache.saveSnapshot(m_path));
+
+    Cache<double, 8> loaded;
+    loaded.castToReal("7");
+    ASSERT_TRUE(loaded.loadSnapshot(m_path));
+    EXPECT_EQ(4u, loaded.size(String2Real));
+    EXPECT_EQ(2u, loaded.size(Real2String));
+    loaded.resetStats();
+    EXPECT_DOUBLE_EQ(1.5, loaded.castToReal("1.5"));
+    EXPECT_DOUBLE_EQ(std::stod(longStr), loaded.castToReal(longStr));
+    EXPECT_STREQ("2.5", loaded.castToStr(2.5));
+    EXPECT_STREQ("2.500", loaded.castToStr(2.5, RealFormat::fixed(3)));
+    // negative entries keep their error
+    EXPECT_EQ(ParseError::NoConversion, loaded.tryCastToReal("N/A").error());
+    EXPECT_EQ(ParseError::OutOfRange, loaded.tryCastToReal("1e999").error());
+    EXPECT_EQ(6, loaded.hitCount());
+    // what was there before is gone
+    EXPECT_DOUBLE_EQ(7, loaded.castToReal("7"));
+    EXPECT_EQ(1, loaded.missCount());
+}
+
+TEST_F(SnapshotTest, testLoadIntoSmallerCache)
+{
+    Cache<double, 8> cache;
+    for (int i = 0; i < 8; ++i) {
+        cache.castToReal(std::to_string(i));
+    }
+    ASSERT_TRUE(cache.saveSnapshot(m_path));
+
+    // the most recently used are kept
+    Cache<double, 3> loaded;
+    ASSERT_TRUE(loaded.loadSnapshot(m_path));
+    EXPECT_EQ(3u, loaded.size(String2Real));
+    for (int i = 5; i < 8; ++i) {
+        loaded.castToReal(std::to_string(i));
+    }
+    EXPECT_EQ(3, loaded.hitCount());
+}
+
+TEST_F(SnapshotTest, testRejected)
+{
+    Cache<double, 4> cache;
+    cache.castToReal("1.5");
+    cache.castToStr(2.5);
+    ASSERT_TRUE(cache.saveSnapshot(m_path));
+    const std::string good = readFile();
+
+    Cache<double, 4> other;
+    other.castToReal("3.5");
+
+    // a flipped bit anywhere
+    for (size_t i = 0; i < good.size(); ++i) {
+        std::string bad = good;
+        bad[i] ^= 0x10;
+        writeFile(bad);
+        EXPECT_FALSE(other.loadSnapshot(m_path)) << i;
+    }
+    // cut short
+    writeFile(good.substr(0, good.size() - 1));
+    EXPECT_FALSE(other.loadSnapshot(m_path));
+    // another real type
+    writeFile(good);
+    Cache<float, 4> floats;
+    EXPECT_FALSE(floats.loadSnapshot(m_path));
+    EXPECT_FALSE(other.loadSnapshot(m_path + ".missing"));
+
+    // and the cache is as it was
+    EXPECT_EQ(1u, other.size());
+    other.castToReal("3.5");
+    EXPECT_EQ(1, other.hitCount());
+}
+
+TEST(StringToRealTest, testCachedItemLayout)
+{
+    using Item = Cache<double>::CachedItem;
+    EXPECT_EQ(64u, alignof(Item));
+    EXPECT_EQ(64u, sizeof(Item));
+    EXPECT_EQ(64u, sizeof(Cache<long double>::CachedItem));
+}
+
+template <typename index_type>
+void testMatchesLinearScan(index_type& index)
+{
+    std::vector<double> reals;
+    for (int i = 0; i < 1000; ++i) {
+        // mix of tiny, ordinary and huge magnitudes
+        const double scale = std::pow(10.0, randomInt(-10, 12));
+        const double d = randomReal(-1.0, 1.0) * scale;
+        if (index.find(d) < 0) {
+            index.insert(d, reals.size());
+            reals.push_back(d);
+        }
+    }
+
+    for (int i = 0; i < 10000; ++i) {
+        const auto& base = reals[randomInt(0, reals.size() - 1)];
+        const double d = randomInt(0, 1)
+            ? std::nextafter(base, randomInt(0, 1) ? 1e300 : -1e300)
+            : base + randomReal(-2e-7, 2e-7);
+
+        const bool expected = std::any_of(reals.begin(), reals.end(),
+                [d](double r) { return useful::almostEqual(r, d); });
+        const auto found = index.find(d);
+        ASSERT_EQ(expected, found >= 0) << d;
+        if (found >= 0) {
+            EXPECT_TRUE(useful::almostEqual(reals[found], d));
+        }
+    }
+
+    EXPECT_TRUE(index.erase(reals[0], 0));
+    EXPECT_FALSE(index.erase(reals[0], 0));
+    EXPECT_EQ(reals.size() - 1, index.size());
+}
+
+TEST(UlpBucketIndexTest, testMatchesLinearScan)
+{
+    UlpBucketIndex<double> index;
+    testMatchesLinearScan(index);
+}
+
+TEST(UlpBucketIndexTest, testFlatMatchesLinearScan)
+{
+    // too big for the stack
+    static FlatUlpBucketIndex<double, 1000> index;
+    testMatchesLinearScan(index);
+}
+
 }
@@ -2,6 +2,7 @@
 #define LEXICAL_CACHE_TESTUTILS_H_INCLUDED
 
 #include <string>
+#include <charconv>
 #include <random>
 #include <algorithm>
 #include <sstream>
@@ -40,6 +41,13 @@ inline std::string realToString(double d)
     return oss.str();
 }
 
+// what castToStr returns by default, std::to_chars' shortest round trip
+inline std::string shortestString(double d)
+{
+    char buf[32];
+    return std::string(buf, std::to_chars(buf, buf + sizeof(buf), d).ptr);
+}
+
 inline std::string randomString(double min=0.0, double max=1000.0)
 {
     return realToString(randomReal(min, max));
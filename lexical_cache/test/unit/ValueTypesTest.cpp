@@ -0,0 +1,308 @@
+#include "TestUtils.h"
+
+#include <lexical_cache/lexical_cache.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace ::testing;
+
+namespace lexical_cache {
+
+using Price = Decimal<int64_t, 2>;
+
+template <typename real_type>
+ParseError parse(std::string_view str, real_type& value)
+{
+    return tryParseReal(str, value);
+}
+
+template <typename real_type>
+std::string format(const real_type& real, int decimals=-1)
+{
+    char buf[128];
+    if (decimals < 0) {
+        formatReal(real, buf, sizeof(buf));
+    }
+    else {
+        formatFixed(real, decimals, buf, sizeof(buf));
+    }
+    return buf;
+}
+
+TEST(IntegerParserTest, testParse)
+{
+    int64_t value = 0;
+    EXPECT_EQ(ParseError::None, parse("42", value));
+    EXPECT_EQ(42, value);
+    EXPECT_EQ(ParseError::None, parse("  -42abc", value));
+    EXPECT_EQ(-42, value);
+    EXPECT_EQ(ParseError::None, parse("+7", value));
+    EXPECT_EQ(7, value);
+    // no fraction, like std::stol
+    EXPECT_EQ(ParseError::None, parse("1.9", value));
+    EXPECT_EQ(1, value);
+    EXPECT_EQ(ParseError::None, parse("9223372036854775807", value));
+    EXPECT_EQ(std::numeric_limits<int64_t>::max(), value);
+    EXPECT_EQ(ParseError::None, parse("-9223372036854775808", value));
+    EXPECT_EQ(std::numeric_limits<int64_t>::min(), value);
+
+    // value is left alone on errors
+    EXPECT_EQ(ParseError::OutOfRange, parse("9223372036854775808", value));
+    EXPECT_EQ(ParseError::OutOfRange, parse("-9223372036854775809", value));
+    EXPECT_EQ(ParseError::NoConversion, parse("", value));
+    EXPECT_EQ(ParseError::NoConversion, parse("-", value));
+    EXPECT_EQ(ParseError::NoConversion, parse("+-1", value));
+    EXPECT_EQ(ParseError::NoConversion, parse("N/A", value));
+    EXPECT_EQ(std::numeric_limits<int64_t>::min(), value);
+
+    uint64_t u = 0;
+    EXPECT_EQ(ParseError::None, parse("18446744073709551615", u));
+    EXPECT_EQ(std::numeric_limits<uint64_t>::max(), u);
+    EXPECT_EQ(ParseError::OutOfRange, parse("18446744073709551616", u));
+    EXPECT_EQ(ParseError::NoConversion, parse("-1", u));
+
+    int32_t i = 0;
+    EXPECT_EQ(ParseError::None, parse("-2147483648", i));
+    EXPECT_EQ(std::numeric_limits<int32_t>::min(), i);
+    EXPECT_EQ(ParseError::OutOfRange, parse("2147483648", i));
+
+    EXPECT_EQ(123, parseReal<int>("123"));
+    EXPECT_THROW(parseReal<int>("x"), std::invalid_argument);
+    EXPECT_THROW(parseReal<int>("99999999999"), std::out_of_range);
+}
+
+TEST(IntegerFormatterTest, testFormat)
+{
+    EXPECT_EQ("0", format(0));
+    EXPECT_EQ("-42", format(-42));
+    EXPECT_EQ("-9223372036854775808",
+            format(std::numeric_limits<int64_t>::min()));
+    EXPECT_EQ("18446744073709551615",
+            format(std::numeric_limits<uint64_t>::max()));
+    EXPECT_EQ("5.00", format(5, 2));
+    EXPECT_EQ("-5", format(-5, 0));
+
+    char buf[4];
+    EXPECT_EQ(6, formatReal(123456, buf, sizeof(buf)));
+    EXPECT_STREQ("123", buf);
+    char plain[32];
+    EXPECT_EQ(4, LegacyFormat::format(1234, plain, sizeof(plain)));
+    EXPECT_STREQ("1234", plain);
+}
+
+TEST(DecimalTest, testParse)
+{
+    Price price;
+    EXPECT_EQ(ParseError::None, parse("101.25", price));
+    EXPECT_EQ(10125, price.ticks());
+    EXPECT_EQ(ParseError::None, parse("101.5", price));
+    EXPECT_EQ(10150, price.ticks());
+    EXPECT_EQ(ParseError::None, parse(" -0.05", price));
+    EXPECT_EQ(-5, price.ticks());
+    EXPECT_EQ(ParseError::None, parse(".5", price));
+    EXPECT_EQ(50, price.ticks());
+    EXPECT_EQ(ParseError::None, parse("5.", price));
+    EXPECT_EQ(500, price.ticks());
+    // no exponent, it's a trailing character
+    EXPECT_EQ(ParseError::None, parse("1e5", price));
+    EXPECT_EQ(100, price.ticks());
+
+    // more decimals than the scale, rounded half to even
+    EXPECT_EQ(ParseError::None, parse("1.005", price));
+    EXPECT_EQ(100, price.ticks());
+    EXPECT_EQ(ParseError::None, parse("1.015", price));
+    EXPECT_EQ(102, price.ticks());
+    EXPECT_EQ(ParseError::None, parse("1.00500001", price));
+    EXPECT_EQ(101, price.ticks());
+    EXPECT_EQ(ParseError::None, parse("-1.0149", price));
+    EXPECT_EQ(-101, price.ticks());
+
+    EXPECT_EQ(ParseError::None, parse("-92233720368547758.08", price));
+    EXPECT_EQ(std::numeric_limits<Price>::min(), price);
+    EXPECT_EQ(ParseError::OutOfRange, parse("92233720368547758.08", price));
+    EXPECT_EQ(ParseError::OutOfRange, parse("92233720368547758.075", price));
+    EXPECT_EQ(ParseError::NoConversion, parse(".", price));
+    EXPECT_EQ(ParseError::NoConversion, parse("-.e", price));
+    EXPECT_EQ(ParseError::NoConversion, parse("abc", price));
+
+    Decimal<int32_t, 0> whole;
+    EXPECT_EQ(ParseError::None, parse("2.5", whole));
+    EXPECT_EQ(2, whole.ticks());
+    EXPECT_EQ(ParseError::None, parse("3.5", whole));
+    EXPECT_EQ(4, whole.ticks());
+}
+
+TEST(DecimalTest, testFormat)
+{
+    EXPECT_EQ("101.25", format(Price::fromTicks(10125)));
+    EXPECT_EQ("101.5", format(Price::fromTicks(10150)));
+    EXPECT_EQ("-3", format(Price::fromTicks(-300)));
+    EXPECT_EQ("0", format(Price()));
+    EXPECT_EQ("-0.05", format(Price::fromTicks(-5)));
+    EXPECT_EQ("-92233720368547758.08",
+            format(std::numeric_limits<Price>::min()));
+
+    EXPECT_EQ("101.2500", format(Price::fromTicks(10125), 4));
+    EXPECT_EQ("101.2", format(Price::fromTicks(10125), 1));
+    EXPECT_EQ("101.4", format(Price::fromTicks(10135), 1));
+    EXPECT_EQ("101", format(Price::fromTicks(10125), 0));
+    EXPECT_EQ("-0.0", format(Price::fromTicks(-4), 1));
+    EXPECT_EQ("1.000000", format(Decimal<int64_t, 18>::fromTicks(
+                    999999999999999999), 6));
+
+    char buf[4];
+    EXPECT_EQ(6, formatReal(Price::fromTicks(10125), buf, sizeof(buf)));
+    EXPECT_STREQ("101", buf);
+    char legacy[32];
+    EXPECT_EQ(10, LegacyFormat::format(Price::fromTicks(10125),
+                legacy, sizeof(legacy)));
+    EXPECT_STREQ("101.250000", legacy);
+
+    std::ostringstream os;
+    os << Price::fromTicks(-125);
+    EXPECT_EQ("-1.25", os.str());
+}
+
+template <typename int_type>
+class IntegerCacheTest : public ::testing::Test
+{
+};
+
+using IntegerTypes = ::testing::Types<int32_t, int64_t, uint64_t>;
+TYPED_TEST_CASE(IntegerCacheTest, IntegerTypes);
+
+TYPED_TEST(IntegerCacheTest, testCast)
+{
+    Cache<TypeParam, 16> cache;
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < 16; ++i) {
+            const TypeParam value = static_cast<TypeParam>(1000 + i);
+            EXPECT_EQ(value, cache.castToReal(std::to_string(value)));
+            EXPECT_EQ(std::to_string(value), cache.castToStr(value));
+        }
+    }
+    EXPECT_EQ(32, cache.hitCount());
+    EXPECT_EQ(32, cache.missCount());
+
+    const TypeParam max = std::numeric_limits<TypeParam>::max();
+    EXPECT_EQ(max, cache.castToReal(std::to_string(max)));
+    EXPECT_EQ(std::to_string(max), cache.castToStr(max));
+    EXPECT_THROW(cache.castToReal("N/A"), std::invalid_argument);
+    EXPECT_EQ(ParseError::OutOfRange,
+            cache.tryCastToReal(std::to_string(max) + "0").error());
+}
+
+TYPED_TEST(IntegerCacheTest, testExactKeys)
+{
+    // no tolerance: neighbours and huge values a double can't tell apart
+    // are all different keys
+    Cache<TypeParam, 16> cache;
+    const TypeParam big = std::numeric_limits<TypeParam>::max() - 8;
+    for (TypeParam i = 0; i < 4; ++i) {
+        EXPECT_EQ(std::to_string(i), cache.castToStr(i));
+        EXPECT_EQ(std::to_string(big + i), cache.castToStr(big + i));
+    }
+    EXPECT_EQ(0, cache.hitCount());
+    EXPECT_EQ(8u, cache.size(Real2String));
+    EXPECT_EQ("2.00", std::string(cache.castToStr(2, RealFormat::fixed(2))));
+    EXPECT_EQ("2", std::string(cache.castToStr(2)));
+    EXPECT_EQ(1, cache.hitCount());
+}
+
+template <typename index_policy>
+class ExactIndexTest : public ::testing::Test
+{
+};
+
+using IndexPolicies =
+    ::testing::Types<MapIndex, DenseIndex, FlatIndex, AutoIndex>;
+TYPED_TEST_CASE(ExactIndexTest, IndexPolicies);
+
+TYPED_TEST(ExactIndexTest, testSameAsDoubles)
+{
+    // integers far apart enough that doubles hit on the same keys
+    Cache<int64_t, 32, NoLock, LruEviction, AdmitAll, 40, TypeParam> integers;
+    Cache<double, 32, NoLock, LruEviction, AdmitAll, 40, TypeParam> doubles;
+    std::mt19937 generator(2024);
+    for (int i = 0; i < 20000; ++i) {
+        const int64_t key = generator() % 48 - 24;
+        const std::string str = std::to_string(key);
+        EXPECT_EQ(key, integers.castToReal(str));
+        EXPECT_EQ(str, integers.castToStr(key));
+        doubles.castToReal(str);
+        doubles.castToStr(key);
+    }
+    EXPECT_EQ(doubles.hitCount(), integers.hitCount());
+    EXPECT_EQ(32u, integers.size(Real2String));
+}
+
+TEST(DecimalCacheTest, testCast)
+{
+    Cache<Price, 16> cache;
+    EXPECT_EQ(Price::fromTicks(10125), cache.castToReal("101.25"));
+    EXPECT_EQ(Price::fromTicks(10125), cache.castToReal("101.25"));
+    EXPECT_STREQ("101.25", cache.castToStr(Price::fromTicks(10125)));
+    EXPECT_STREQ("101.26", cache.castToStr(Price::fromTicks(10126)));
+    EXPECT_STREQ("101.25", cache.castToStr(Price::fromTicks(10125)));
+    EXPECT_STREQ("101.250", cache.castToStr(Price::fromTicks(10125),
+                RealFormat::fixed(3)));
+    EXPECT_EQ(2, cache.hitCount());
+    EXPECT_EQ(4, cache.missCount());
+
+    // the string is cached as it was, not as the ticks would be written
+    EXPECT_EQ(Price::fromTicks(150), cache.castToReal("1.50"));
+    EXPECT_EQ(Price::fromTicks(150), cache.castToReal("1.5"));
+    EXPECT_EQ(3u, cache.size(String2Real));
+
+    const auto bad = cache.tryCastToReal("N/A");
+    EXPECT_FALSE(bad.hasValue());
+    EXPECT_EQ(ParseError::NoConversion, bad.error());
+    EXPECT_EQ(Price::fromTicks(-1), bad.valueOr(Price::fromTicks(-1)));
+    EXPECT_THROW(cache.castToReal("N/A"), std::invalid_argument);
+
+    std::ostringstream os;
+    os << cache;
+    EXPECT_NE(std::string::npos, os.str().find("101.25"));
+}
+
+TEST(DecimalCacheTest, testSnapshot)
+{
+    Cache<Price, 16> cache;
+    for (int i = 0; i < 10; ++i) {
+        cache.castToReal(std::to_string(i) + ".25");
+        cache.castToStr(Price::fromTicks(i * 10));
+    }
+    std::stringstream snapshot;
+    ASSERT_TRUE(cache.writeSnapshot(&snapshot));
+    const std::string bytes = snapshot.str();
+
+    Cache<Price, 16> loaded;
+    ASSERT_TRUE(loaded.readSnapshot(&snapshot));
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(Price::fromTicks(i * 100 + 25),
+                loaded.castToReal(std::to_string(i) + ".25"));
+        EXPECT_STREQ(cache.castToStr(Price::fromTicks(i * 10)),
+                loaded.castToStr(Price::fromTicks(i * 10)));
+    }
+    EXPECT_EQ(20, loaded.hitCount());
+
+    // same size, but not the same type or scale
+    std::stringstream other(bytes);
+    Cache<int64_t, 16> integers;
+    EXPECT_FALSE(integers.readSnapshot(&other));
+    other.clear();
+    other.str(bytes);
+    Cache<Decimal<int64_t, 4>, 16> finer;
+    EXPECT_FALSE(finer.readSnapshot(&other));
+    other.clear();
+    other.str(bytes);
+    Cache<double, 16> doubles;
+    EXPECT_FALSE(doubles.readSnapshot(&other));
+}
+
+}